@@ -0,0 +1,106 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
+#include "llvm/MC/MCCodeEmitter.h"
+#include "llvm/MC/MCContext.h"
+#include "llvm/MC/MCInstrInfo.h"
+#include "llvm/MC/MCObjectFileInfo.h"
+#include "llvm/MC/MCObjectWriter.h"
+#include "llvm/MC/MCParser/MCAsmParser.h"
+#include "llvm/MC/MCParser/MCTargetAsmParser.h"
+#include "llvm/MC/MCRegisterInfo.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/MC/MCTargetOptions.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static const char *TripleName = "x86_64-unknown-linux-gnu";
+
+// Generate a function with NumBlocks basic blocks, each of which ends with a
+// conditional branch halfway across the function. Most branches start out
+// short and only some of them end up out of range, so relaxation takes
+// several passes over the section.
+static std::string makeBranchyFunction(unsigned NumBlocks) {
+  std::string Asm;
+  raw_string_ostream OS(Asm);
+  OS << "\t.text\n\t.globl\tf\nf:\n";
+  for (unsigned I = 0; I < NumBlocks; ++I) {
+    OS << ".LBB" << I << ":\n";
+    for (unsigned J = 0; J < I % 8; ++J)
+      OS << "\taddq\t$" << J << ", %rax\n";
+    OS << "\tcmpq\t%rdi, %rax\n";
+    OS << "\tjne\t.LBB" << (I + NumBlocks / 2) % NumBlocks << "\n";
+  }
+  OS << "\tretq\n";
+  return OS.str();
+}
+
+// Assemble Asm to an ELF object in memory; returns the object size.
+static size_t assemble(const Target &T, const std::string &Asm) {
+  SourceMgr SrcMgr;
+  SrcMgr.AddNewSourceBuffer(MemoryBuffer::getMemBuffer(Asm, "<bench>"), SMLoc());
+
+  MCTargetOptions Opts;
+  std::unique_ptr<MCRegisterInfo> MRI(T.createMCRegInfo(TripleName));
+  std::unique_ptr<MCAsmInfo> MAI(T.createMCAsmInfo(*MRI, TripleName, Opts));
+  std::unique_ptr<MCInstrInfo> MII(T.createMCInstrInfo());
+  std::unique_ptr<MCSubtargetInfo> STI(
+      T.createMCSubtargetInfo(TripleName, "", ""));
+
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr, &Opts);
+  MOFI.InitMCObjectFileInfo(Triple(TripleName), /*PIC*/ false, Ctx);
+
+  SmallString<0> Obj;
+  raw_svector_ostream OS(Obj);
+  MCAsmBackend *MAB = T.createMCAsmBackend(*STI, *MRI, Opts);
+  std::unique_ptr<MCStreamer> Str(T.createMCObjectStreamer(
+      Triple(TripleName), Ctx, std::unique_ptr<MCAsmBackend>(MAB),
+      MAB->createObjectWriter(OS),
+      std::unique_ptr<MCCodeEmitter>(T.createMCCodeEmitter(*MII, *MRI, Ctx)),
+      *STI, /*RelaxAll*/ false, /*IncrementalLinkerCompatible*/ false,
+      /*DWARFMustBeAtTheEnd*/ false));
+
+  std::unique_ptr<MCAsmParser> Parser(
+      createMCAsmParser(SrcMgr, Ctx, *Str, *MAI));
+  std::unique_ptr<MCTargetAsmParser> TAP(
+      T.createMCAsmParser(*STI, *Parser, *MII, Opts));
+  Parser->setTargetParser(*TAP);
+  if (Parser->Run(/*NoInitialTextSection*/ false))
+    report_fatal_error("failed to assemble benchmark input");
+  return Obj.size();
+}
+
+static void BM_MCRelaxBranches(benchmark::State &State) {
+  std::string Error;
+  const Target *T = TargetRegistry::lookupTarget(TripleName, Error);
+  if (!T) {
+    State.SkipWithError(Error.c_str());
+    return;
+  }
+  std::string Asm = makeBranchyFunction(State.range(0));
+  size_t Size = 0;
+  for (auto _ : State)
+    benchmark::DoNotOptimize(Size = assemble(*T, Asm));
+  State.counters["ObjSize"] = Size;
+}
+BENCHMARK(BM_MCRelaxBranches)->Arg(1 << 10)->Arg(1 << 13)->Arg(1 << 16);
+
+int main(int argc, char **argv) {
+  LLVMInitializeX86TargetInfo();
+  LLVMInitializeX86TargetMC();
+  LLVMInitializeX86AsmParser();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
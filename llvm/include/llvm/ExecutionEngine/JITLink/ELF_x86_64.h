@@ -0,0 +1,59 @@
+//===----- ELF_x86_64.h - JIT link functions for ELF/x86-64 -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// jit-link functions for ELF/x86-64.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_JITLINK_ELF_X86_64_H
+#define LLVM_EXECUTIONENGINE_JITLINK_ELF_X86_64_H
+
+#include "llvm/ExecutionEngine/JITLink/JITLink.h"
+
+namespace llvm {
+namespace jitlink {
+
+namespace ELF_x86_64_Edges {
+
+/// ELF relocations use explicit addends, so (unlike the MachO edge kinds) the
+/// PC-relative kinds compute Target + Addend - Fixup.
+enum ELFX86RelocationKind : Edge::Kind {
+  Branch32 = Edge::FirstRelocation, // R_X86_64_PLT32
+  Pointer32,                        // R_X86_64_32
+  Pointer32Signed,                  // R_X86_64_32S
+  Pointer64,                        // R_X86_64_64
+  PCRel32,                          // R_X86_64_PC32
+  Delta64,                          // R_X86_64_PC64
+  PCRel32GOTLoad,                   // R_X86_64_GOTPCREL
+  PCRel32GOTLoadRelaxable,          // R_X86_64_[REX_]GOTPCRELX
+  PCRel32GOTLoadRelaxed,            // a relaxable GOT load of a defined symbol
+                                    // that has been rewritten from a `mov` to
+                                    // a `lea`
+};
+
+} // namespace ELF_x86_64_Edges
+
+/// jit-link the given object buffer, which must be an ELF x86-64 relocatable
+/// object file.
+///
+/// If the context's shouldAddDefaultTargetPasses returns true, then the
+/// default passes are added before the context's modifyPassConfig is called:
+/// the context's mark-live pass (or, if it has none, a pass that marks all
+/// symbols live) is added to PrePrunePasses, and a GOT-load relaxation pass
+/// followed by a GOT-and-stubs insertion pass are added to PostPrunePasses.
+/// Otherwise, the context is responsible for adding passes that mark symbols
+/// as live and that insert GOT and stub edges.
+void jitLink_ELF_x86_64(std::unique_ptr<JITLinkContext> Ctx);
+
+/// Return the string name of the given ELF x86-64 edge kind.
+StringRef getELFX86RelocationKindName(Edge::Kind R);
+
+} // end namespace jitlink
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_JITLINK_ELF_X86_64_H
@@ -36,6 +36,25 @@ void reportAndResetTimings(raw_ostream *OutStream = nullptr);
 /// Request the timer for this legacy-pass-manager's pass instance.
 Timer *getPassTimer(Pass *);
 
+/// A source of timers for the legacy-pass-manager passes that are run by a
+/// thread. Clients that run several compilations at once use this interface
+/// to time each compilation separately, instead of accumulating the times of
+/// all threads in the -time-passes report.
+class PassTimerSource {
+public:
+  virtual ~PassTimerSource();
+
+  /// Returns the timer for pass instance \p P, or null if \p P should not be
+  /// timed. \p P is never a pass manager.
+  virtual Timer *getPassTimer(Pass *P) = 0;
+};
+
+/// Make \p Source the source of the pass timers for the calling thread and
+/// return the previous source. While a thread has a source, its passes are
+/// timed by the source's timers, whether or not -time-passes is enabled. A
+/// null \p Source restores the -time-passes behavior.
+PassTimerSource *setThreadPassTimerSource(PassTimerSource *Source);
+
 /// If the user specifies the -time-passes argument on an LLVM tool command line
 /// then the value of this boolean will be true, otherwise false.
 /// This is the storage for the -time-passes option.
@@ -174,23 +174,42 @@ private:
                      uint64_t &Value, bool &WasForced) const;
 
   /// Check whether a fixup can be satisfied, or whether it needs to be relaxed
-  /// (increased in size, in order to hold its value correctly).
+  /// (increased in size, in order to hold its value correctly). A non-zero
+  /// \p Margin moves the value of a resolved PC-relative fixup that many
+  /// bytes further from zero, so that fixups that are close to the limit of
+  /// their range are relaxed early.
   bool fixupNeedsRelaxation(const MCFixup &Fixup, const MCRelaxableFragment *DF,
-                            const MCAsmLayout &Layout) const;
+                            const MCAsmLayout &Layout,
+                            uint64_t Margin = 0) const;
 
   /// Check whether the given fragment needs relaxation.
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
-                               const MCAsmLayout &Layout) const;
+                               const MCAsmLayout &Layout,
+                               uint64_t Margin = 0) const;
+
+  /// The per-section state of incremental relaxation (see layoutSectionOnce).
+  struct SectionRelaxState;
+
+  /// Return the fragment that holds the target of the fixup of \p F, if the
+  /// value of the fixup only depends on the distance between \p F and that
+  /// fragment, which must be in \p Sec. Otherwise return null.
+  const MCFragment *getRelaxationTarget(const MCAsmLayout &Layout,
+                                        const MCRelaxableFragment &F,
+                                        const MCSection &Sec) const;
 
   /// Perform one layout iteration and return true if any offsets
   /// were adjusted.
   bool layoutOnce(MCAsmLayout &Layout);
 
   /// Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec);
-
-  bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
+  /// if any offsets were adjusted. \p State records the offsets and
+  /// relaxations of the previous iteration, which are used to skip the
+  /// relaxable fragments whose fixup values cannot have changed.
+  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                         SectionRelaxState &State);
+
+  bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF,
+                        uint64_t Margin = 0);
   bool relaxLEB(MCAsmLayout &Layout, MCLEBFragment &IF);
   bool relaxBoundaryAlign(MCAsmLayout &Layout, MCBoundaryAlignFragment &BF);
   bool relaxDwarfLineAddr(MCAsmLayout &Layout, MCDwarfLineAddrFragment &DF);
@@ -241,6 +260,15 @@ public:
   void writeSectionData(raw_ostream &OS, const MCSection *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the contents of the fragments in [\p Begin, \p End) of a
+  /// non-virtual section to \p OS. Once layout is complete, the contents of a
+  /// fragment only depend on the fragment and the layout, so disjoint ranges
+  /// of fragments may be written concurrently, provided that the layout of
+  /// the section has been completed beforehand.
+  void writeFragmentData(raw_ostream &OS, const MCAsmLayout &Layout,
+                         MCSection::const_iterator Begin,
+                         MCSection::const_iterator End) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const;
 
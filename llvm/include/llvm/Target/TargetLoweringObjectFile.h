@@ -119,6 +119,11 @@ public:
   virtual bool shouldPutJumpTableInFunctionSection(bool UsesLabelDifference,
                                                    const Function &F) const;
 
+  /// Return true if the constant pool of \p F should be emitted in the
+  /// function's own section instead of the sections chosen by
+  /// getSectionForConstant.
+  virtual bool shouldPutConstantPoolInFunctionSection(const Function &F) const;
+
   /// Targets should implement this method to assign a section to globals with
   /// an explicit section specfied. The implementation of this method can
   /// assume that GO->hasSection() is true.
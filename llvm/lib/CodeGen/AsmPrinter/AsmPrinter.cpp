@@ -284,7 +284,8 @@ bool AsmPrinter::doInitialization(Module &M) {
 
   // Very minimal debug info. It is ignored if we emit actual debug info. If we
   // don't, this at least helps the user find where a global came from.
-  if (MAI->hasSingleParameterDotFile()) {
+  // An empty source file name is not worth a file symbol.
+  if (MAI->hasSingleParameterDotFile() && !M.getSourceFileName().empty()) {
     // .file "foo.c"
     OutStreamer->EmitFileDirective(
         llvm::sys::path::filename(M.getSourceFileName()));
@@ -1748,6 +1749,11 @@ void AsmPrinter::EmitConstantPool() {
   const std::vector<MachineConstantPoolEntry> &CP = MCP->getConstants();
   if (CP.empty()) return;
 
+  const TargetLoweringObjectFile &TLOF = getObjFileLowering();
+  MCSection *FnSection = nullptr;
+  if (TLOF.shouldPutConstantPoolInFunctionSection(MF->getFunction()))
+    FnSection = TLOF.SectionForGlobal(&MF->getFunction(), TM);
+
   // Calculate sections for constant pool entries. We collect entries to go into
   // the same section together to reduce amount of section switch statements.
   SmallVector<SectionCPs, 4> CPSections;
@@ -1761,8 +1767,9 @@ void AsmPrinter::EmitConstantPool() {
     if (!CPE.isMachineConstantPoolEntry())
       C = CPE.Val.ConstVal;
 
-    MCSection *S = getObjFileLowering().getSectionForConstant(getDataLayout(),
-                                                              Kind, C, Align);
+    MCSection *S =
+        FnSection ? FnSection
+                  : TLOF.getSectionForConstant(getDataLayout(), Kind, C, Align);
 
     // The number of sections are small, just do a linear search from the
     // last section to the first.
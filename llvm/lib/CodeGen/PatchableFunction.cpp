@@ -7,7 +7,8 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements edits function bodies in place to support the
-// "patchable-function" attribute.
+// "patchable-function", "patchable-function-entry", and "jwa-entry-sled"
+// attributes.
 //
 //===----------------------------------------------------------------------===//
 
@@ -55,7 +56,15 @@ static bool doesNotGeneratecode(const MachineInstr &MI) {
 }
 
 bool PatchableFunction::runOnMachineFunction(MachineFunction &MF) {
-  if (MF.getFunction().hasFnAttribute("patchable-function-entry")) {
+  // A JWA entry sled is a NOP at the function entry that the runtime patches
+  // into a call with a single atomic store, so the function must be aligned
+  // such that the sled does not cross an 8-byte boundary.
+  bool HasJWASled = MF.getFunction().hasFnAttribute("jwa-entry-sled");
+  if (HasJWASled)
+    MF.ensureAlignment(Align(8));
+
+  if (HasJWASled ||
+      MF.getFunction().hasFnAttribute("patchable-function-entry")) {
     MachineBasicBlock &FirstMBB = *MF.begin();
     const TargetInstrInfo *TII = MF.getSubtarget().getInstrInfo();
     if (FirstMBB.empty()) {
@@ -84,6 +84,9 @@
 #include "llvm/CodeGen/TargetOpcodes.h"
 #include "llvm/CodeGen/TargetRegisterInfo.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/IR/CallingConv.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/InitializePasses.h"
 #include "llvm/MC/LaneBitmask.h"
 #include "llvm/MC/MCInstrDesc.h"
@@ -145,6 +148,8 @@ STATISTIC(NumSelects, "Number of selects optimized");
 STATISTIC(NumUncoalescableCopies, "Number of uncoalescable copies optimized");
 STATISTIC(NumRewrittenCopies, "Number of copies rewritten");
 STATISTIC(NumNAPhysCopies, "Number of non-allocatable physical copies removed");
+STATISTIC(NumNAPhysUpdates,
+          "Number of non-allocatable physical registers updated in place");
 
 namespace {
 
@@ -158,6 +163,10 @@ namespace {
     MachineDominatorTree *DT;  // Machine dominator tree
     MachineLoopInfo *MLI;
 
+    /// True for a JWA function whose module pins registers (the "jwa.pinned"
+    /// module flag).
+    bool HasPinnedRegs;
+
   public:
     static char ID; // Pass identification
 
@@ -229,6 +238,20 @@ namespace {
     bool foldRedundantNAPhysCopy(MachineInstr &MI,
         DenseMap<unsigned, MachineInstr *> &NAPhysToVirtMIs);
 
+    /// If copy instruction \p MI writes back a non-allocatable physical
+    /// register that was updated by a two-address instruction, i.e.,
+    /// \code
+    ///   %a = COPY %physreg
+    ///   %b = OP %a(tied-def 0), ...
+    ///   %physreg = COPY %b
+    /// \endcode
+    /// then rewrite OP to update %physreg in place and delete \p MI. The
+    /// register coalescer cannot join %b with a reserved register, because
+    /// the two-address form of %b has more than one value. This is only done
+    /// for the pinned registers of JWA functions.
+    bool foldNAPhysUpdate(MachineInstr &MI,
+        DenseMap<unsigned, MachineInstr *> &NAPhysToVirtMIs);
+
     bool isLoadFoldable(MachineInstr &MI,
                         SmallSet<unsigned, 16> &FoldAsLoadDefCandidates);
 
@@ -1484,6 +1507,106 @@ bool PeepholeOptimizer::foldRedundantNAPhysCopy(
   return false;
 }
 
+bool PeepholeOptimizer::foldNAPhysUpdate(
+    MachineInstr &MI, DenseMap<unsigned, MachineInstr *> &NAPhysToVirtMIs) {
+  assert(MI.isCopy() && "expected a COPY machine instruction");
+
+  if (DisableNAPhysCopyOpt || !HasPinnedRegs)
+    return false;
+
+  Register DstReg = MI.getOperand(0).getReg();
+  Register SrcReg = MI.getOperand(1).getReg();
+  if (!(Register::isVirtualRegister(SrcReg) && isNAPhysCopy(DstReg)) ||
+      MI.getOperand(1).getSubReg() || !MRI->hasOneNonDBGUse(SrcReg))
+    return false;
+
+  MachineInstr *UpdateMI = MRI->getUniqueVRegDef(SrcReg);
+  if (!UpdateMI || UpdateMI->getParent() != MI.getParent() ||
+      UpdateMI->getNumExplicitDefs() != 1 ||
+      !UpdateMI->getOperand(0).isReg() ||
+      UpdateMI->getOperand(0).getReg() != SrcReg ||
+      UpdateMI->getOperand(0).getSubReg() ||
+      !UpdateMI->getOperand(0).isTied())
+    return false;
+  unsigned UseIdx = UpdateMI->findTiedOperandIdx(0);
+  MachineOperand &UseMO = UpdateMI->getOperand(UseIdx);
+  if (!Register::isVirtualRegister(UseMO.getReg()) || UseMO.getSubReg())
+    return false;
+
+  // The tied operand must be a copy of %physreg.
+  MachineInstr *CopyMI = MRI->getUniqueVRegDef(UseMO.getReg());
+  if (!CopyMI || !CopyMI->isCopy() ||
+      CopyMI->getOperand(1).getReg() != DstReg ||
+      CopyMI->getOperand(1).getSubReg())
+    return false;
+
+  // Both tied operands must accept the physical register.
+  MachineFunction &MF = *MI.getMF();
+  const TargetRegisterClass *DefRC =
+      TII->getRegClass(UpdateMI->getDesc(), 0, TRI, MF);
+  const TargetRegisterClass *UseRC =
+      TII->getRegClass(UpdateMI->getDesc(), UseIdx, TRI, MF);
+  if (!DefRC || !UseRC || !DefRC->contains(DstReg) ||
+      !UseRC->contains(DstReg))
+    return false;
+
+  // The value of %physreg must not change between the copy and the update.
+  // The copy may be in an earlier block that reaches the update through a
+  // chain of single-predecessor blocks (e.g., past a heap-limit check).
+  auto ChangesReg = [&](MachineBasicBlock::iterator I,
+                        MachineBasicBlock::iterator E) {
+    for (; I != E; ++I) {
+      if (I->modifiesRegister(DstReg, TRI) || I->isInlineAsm() ||
+          I->hasUnmodeledSideEffects())
+        return true;
+    }
+    return false;
+  };
+  SmallPtrSet<MachineBasicBlock *, 4> Visited;
+  MachineBasicBlock *MBB = UpdateMI->getParent();
+  MachineBasicBlock::iterator E = UpdateMI->getIterator();
+  while (MBB != CopyMI->getParent()) {
+    if (ChangesReg(MBB->begin(), E) || MBB->pred_size() != 1 ||
+        !Visited.insert(MBB).second)
+      return false;
+    MBB = *MBB->pred_begin();
+    E = MBB->end();
+  }
+  if (ChangesReg(std::next(CopyMI->getIterator()), E))
+    return false;
+
+  // Nothing between the update and the write-back may access %physreg. The
+  // update is sunk to the write-back when possible, so that the other uses of
+  // the copied value precede it and the copy can still be coalesced with
+  // %physreg.
+  bool CanSink = !UpdateMI->mayLoadOrStore() && !UpdateMI->isCall() &&
+                 !UpdateMI->hasUnmodeledSideEffects();
+  for (auto I = std::next(UpdateMI->getIterator()), E = MI.getIterator();
+       I != E; ++I) {
+    if (I->readsRegister(DstReg, TRI) || I->modifiesRegister(DstReg, TRI))
+      return false;
+    for (const MachineOperand &MO : UpdateMI->operands()) {
+      if (MO.isReg() && Register::isPhysicalRegister(MO.getReg()) &&
+          (I->modifiesRegister(MO.getReg(), TRI) ||
+           (MO.isDef() && I->readsRegister(MO.getReg(), TRI))))
+        CanSink = false;
+    }
+  }
+
+  LLVM_DEBUG(dbgs() << "NAPhysCopy: updating in place " << *UpdateMI);
+  UpdateMI->getOperand(0).setReg(DstReg);
+  UseMO.setReg(DstReg);
+  UseMO.setIsKill(false);
+  MRI->markUsesInDebugValueAsUndef(SrcReg);
+  if (CanSink)
+    MI.getParent()->splice(MI.getIterator(), MI.getParent(),
+                           UpdateMI->getIterator());
+  // %physreg no longer holds the copied value.
+  NAPhysToVirtMIs.erase(DstReg);
+  ++NumNAPhysUpdates;
+  return true;
+}
+
 /// \bried Returns true if \p MO is a virtual register operand.
 static bool isVirtualRegisterOperand(MachineOperand &MO) {
   if (!MO.isReg())
@@ -1607,6 +1730,10 @@ bool PeepholeOptimizer::runOnMachineFunction(MachineFunction &MF) {
   DT  = Aggressive ? &getAnalysis<MachineDominatorTree>() : nullptr;
   MLI = &getAnalysis<MachineLoopInfo>();
 
+  const Function &F = MF.getFunction();
+  HasPinnedRegs = F.getCallingConv() == CallingConv::JWA &&
+                  F.getParent()->getModuleFlag("jwa.pinned");
+
   bool Changed = false;
 
   for (MachineBasicBlock &MBB : MF) {
@@ -1722,6 +1849,7 @@ bool PeepholeOptimizer::runOnMachineFunction(MachineFunction &MF) {
 
       if (MI->isCopy() &&
           (foldRedundantCopy(*MI, CopySrcRegs, CopySrcMIs) ||
+           foldNAPhysUpdate(*MI, NAPhysToVirtMIs) ||
            foldRedundantNAPhysCopy(*MI, NAPhysToVirtMIs))) {
         LocalMIs.erase(MI);
         MI->eraseFromParent();
@@ -122,6 +122,7 @@ private:
   MachineOptimizationRemarkEmitter *ORE = nullptr;
 
   void calculateCallFrameInfo(MachineFunction &MF);
+  void checkJWASpillBudget(MachineFunction &MF, uint64_t StackSize);
   void calculateSaveRestoreBlocks(MachineFunction &MF);
   void spillCalleeSavedRegs(MachineFunction &MF);
 
@@ -277,6 +278,11 @@ bool PEI::runOnMachineFunction(MachineFunction &MF) {
     DiagnosticInfoStackSize DiagStackSize(F, StackSize);
     F.getContext().diagnose(DiagStackSize);
   }
+  // The frame of a naked JWA function is not allocated by the function; its
+  // spill slots live in a fixed-size area that the runtime system reserves at
+  // the base of the stack frame, so the frame must fit in that area.
+  if (F.hasFnAttribute("jwa-spill-budget"))
+    checkJWASpillBudget(MF, StackSize);
   ORE->emit([&]() {
     return MachineOptimizationRemarkAnalysis(DEBUG_TYPE, "StackSize",
                                              MF.getFunction().getSubprogram(),
@@ -292,6 +298,31 @@ bool PEI::runOnMachineFunction(MachineFunction &MF) {
   return true;
 }
 
+/// Check the frame size of a naked JWA function against the budget given by
+/// its "jwa-spill-budget" attribute.  Exceeding the budget is an error, since
+/// the spill slots would overwrite the runtime system's part of the frame.
+/// The size is also reported as an analysis remark so that clients can track
+/// the high-water mark of the spill area.
+void PEI::checkJWASpillBudget(MachineFunction &MF, uint64_t StackSize) {
+  const Function &F = MF.getFunction();
+  uint64_t Budget;
+  if (F.getFnAttribute("jwa-spill-budget").getValueAsString().getAsInteger(
+          10, Budget))
+    return;
+
+  if (StackSize > Budget) {
+    DiagnosticInfoStackSize DiagStackSize(F, StackSize, DS_Error, Budget);
+    F.getContext().diagnose(DiagStackSize);
+  }
+  if (ORE->allowExtraAnalysis(DEBUG_TYPE)) {
+    MachineOptimizationRemarkAnalysis R(DEBUG_TYPE, "JWASpillArea",
+                                        DiagnosticLocation(), &MF.front());
+    R << ore::NV("NumSpillBytes", StackSize) << " of "
+      << ore::NV("SpillBudget", Budget) << " spill-area bytes in function";
+    ORE->emit(R);
+  }
+}
+
 /// Calculate the MaxCallFrameSize and AdjustsStack
 /// variables for the function's frame information and eliminate call frame
 /// pseudo instructions.
@@ -627,6 +658,11 @@ void PEI::spillCalleeSavedRegs(MachineFunction &MF) {
       for (MachineBasicBlock *RestoreBlock : RestoreBlocks)
         insertCSRRestores(*RestoreBlock, CSI);
     }
+  } else if (MFI.getCalleeSavedInfo().empty()) {
+    // A naked function without callee-saved registers (e.g., a JWA function)
+    // can still have spill slots, and targets such as AArch64 consult the
+    // (empty) callee-saved information when they resolve frame indices.
+    MFI.setCalleeSavedInfoValid(true);
   }
 }
 
@@ -59,6 +59,7 @@
 #include "llvm/CodeGen/VirtRegMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCRegisterInfo.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/BlockFrequency.h"
@@ -84,6 +85,8 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumJWABudgetFallbacks,
+          "Number of JWA functions allocated without live-range splitting");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -142,6 +145,14 @@ static cl::opt<bool> ConsiderLocalIntervalCost(
              "candidate when choosing the best split candidate."),
     cl::init(false));
 
+// The "jwa-regalloc" function attribute enables the JWA-aware allocation mode
+// for a function; its value is the instruction budget for the full greedy
+// strategy (zero means no budget).  This option overrides the budget.
+static cl::opt<unsigned> JWARegAllocBudget(
+    "jwa-regalloc-budget", cl::Hidden,
+    cl::desc("Maximum number of instructions in a JWA function for which "
+             "live-range splitting is attempted (0 = no limit)"));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -408,6 +419,10 @@ class RAGreedy : public MachineFunctionPass,
   /// by a split candidate when choosing the best split candidate.
   bool EnableAdvancedRASplitCost;
 
+  /// The function exceeded its JWA allocation budget, so live ranges that
+  /// cannot be assigned are spilled without trying to split them first.
+  bool SkipSplitting;
+
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
@@ -553,6 +568,19 @@ private:
                                    FoldedSpills);
     }
   }
+
+  /// Report the number of spills and reloads in the whole function as an
+  /// analysis remark, which lets clients collect allocation statistics
+  /// without enabling LLVM's statistics.
+  void reportFunctionSpillsReloads();
+
+  /// Configure the JWA-aware allocation mode for functions that have the
+  /// "jwa-regalloc" attribute.
+  void initializeJWAMode();
+
+  /// Hint the copies of the heap-pointer arguments of a JWA function to the
+  /// argument registers.
+  void hintJWAHeapPointers();
 };
 
 } // end anonymous namespace
@@ -3093,7 +3121,7 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
     return 0;
   }
 
-  if (Stage < RS_Spill) {
+  if (Stage < RS_Spill && !SkipSplitting) {
     // Try splitting VirtReg or interferences.
     unsigned NewVRegSizeBefore = NewVRegs.size();
     unsigned PhysReg = trySplit(VirtReg, Order, NewVRegs, FixedRegisters);
@@ -3212,6 +3240,131 @@ void RAGreedy::reportNumberOfSplillsReloads(MachineLoop *L, unsigned &Reloads,
   }
 }
 
+void RAGreedy::reportFunctionSpillsReloads() {
+  if (!ORE->allowExtraAnalysis(DEBUG_TYPE))
+    return;
+
+  const MachineFrameInfo &MFI = MF->getFrameInfo();
+  unsigned Reloads = 0, FoldedReloads = 0, Spills = 0, FoldedSpills = 0;
+  int FI;
+
+  for (MachineBasicBlock &MBB : *MF)
+    for (MachineInstr &MI : MBB) {
+      SmallVector<const MachineMemOperand *, 2> Accesses;
+      auto isSpillSlotAccess = [&MFI](const MachineMemOperand *A) {
+        return MFI.isSpillSlotObjectIndex(
+            cast<FixedStackPseudoSourceValue>(A->getPseudoValue())
+                ->getFrameIndex());
+      };
+
+      if (TII->isLoadFromStackSlot(MI, FI) && MFI.isSpillSlotObjectIndex(FI))
+        ++Reloads;
+      else if (TII->hasLoadFromStackSlot(MI, Accesses) &&
+               llvm::any_of(Accesses, isSpillSlotAccess))
+        ++FoldedReloads;
+      else if (TII->isStoreToStackSlot(MI, FI) &&
+               MFI.isSpillSlotObjectIndex(FI))
+        ++Spills;
+      else if (TII->hasStoreToStackSlot(MI, Accesses) &&
+               llvm::any_of(Accesses, isSpillSlotAccess))
+        ++FoldedSpills;
+    }
+
+  using namespace ore;
+
+  MachineOptimizationRemarkAnalysis R(DEBUG_TYPE, "FunctionSpillReload",
+                                      DiagnosticLocation(), &MF->front());
+  R << NV("NumSpills", Spills) << " spills "
+    << NV("NumFoldedSpills", FoldedSpills) << " folded spills "
+    << NV("NumReloads", Reloads) << " reloads "
+    << NV("NumFoldedReloads", FoldedReloads) << " folded reloads "
+    << "generated in function";
+  if (SkipSplitting)
+    R << "; allocation budget exceeded: " << NV("BudgetExceeded", true);
+  ORE->emit(R);
+}
+
+void RAGreedy::initializeJWAMode() {
+  SkipSplitting = false;
+
+  const Function &F = MF->getFunction();
+  if (!F.hasFnAttribute("jwa-regalloc"))
+    return;
+
+  unsigned Budget = 0;
+  if (JWARegAllocBudget.getNumOccurrences())
+    Budget = JWARegAllocBudget;
+  else
+    F.getFnAttribute("jwa-regalloc").getValueAsString().getAsInteger(0, Budget);
+
+  if (Budget) {
+    unsigned NumInstrs = 0;
+    for (const MachineBasicBlock &MBB : *MF)
+      NumInstrs += MBB.size();
+    if (NumInstrs > Budget) {
+      LLVM_DEBUG(dbgs() << "JWA allocation budget exceeded (" << NumInstrs
+                        << " > " << Budget << "); splitting disabled\n");
+      SkipSplitting = true;
+      ++NumJWABudgetFallbacks;
+    }
+  }
+
+  // When the heap pointers are pinned (see the "jwa.pinned" module flag), they
+  // are reserved registers and are not arguments.
+  if (F.getCallingConv() == CallingConv::JWA &&
+      !F.getParent()->getModuleFlag("jwa.pinned"))
+    hintJWAHeapPointers();
+}
+
+// By convention, the first three arguments of a JWA function are the SML
+// allocation, limit, and store pointers, which are threaded through every
+// function and across every jump.  After PHI elimination, each of them is a
+// web of virtual registers that are connected by copies, but only the ends of
+// the web (the copies from the incoming and to the outgoing argument
+// registers) have physical hints.  Hinting the whole web to the argument
+// register keeps the pointers in place, instead of shuffling them between
+// registers at the block boundaries of large functions.
+void RAGreedy::hintJWAHeapPointers() {
+  const unsigned NumHeapPtrs = 3;
+
+  SmallVector<unsigned, NumHeapPtrs> ArgRegs;
+  for (auto &LI : MRI->liveins()) {
+    if (ArgRegs.size() == NumHeapPtrs)
+      break;
+    ArgRegs.push_back(LI.first);
+  }
+
+  SmallPtrSet<MachineInstr *, 32> Visited;
+  SmallVector<unsigned, 32> Worklist;
+  for (MachineInstr &MI : MF->front()) {
+    if (!MI.isFullCopy())
+      continue;
+    Register Dst = MI.getOperand(0).getReg();
+    Register Src = MI.getOperand(1).getReg();
+    if (!Dst.isVirtual() || !is_contained(ArgRegs, Src))
+      continue;
+
+    Worklist.push_back(Dst);
+    while (!Worklist.empty()) {
+      Register Reg = Worklist.pop_back_val();
+      // Keep hints that come from a direct copy to or from a physical
+      // register.
+      if (!Register::isPhysicalRegister(MRI->getSimpleHint(Reg)) &&
+          MRI->getRegClass(Reg)->contains(Src))
+        MRI->setRegAllocationHint(Reg, 0, Src);
+      for (MachineInstr &UseMI : MRI->reg_nodbg_instructions(Reg)) {
+        if (!UseMI.isFullCopy() || !Visited.insert(&UseMI).second)
+          continue;
+        Register Other = UseMI.getOperand(0).getReg() == Reg
+                             ? UseMI.getOperand(1).getReg()
+                             : UseMI.getOperand(0).getReg();
+        if (Other.isVirtual())
+          Worklist.push_back(Other);
+      }
+    }
+  }
+}
+
 bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   LLVM_DEBUG(dbgs() << "********** GREEDY REGISTER ALLOCATION **********\n"
                     << "********** Function: " << mf.getName() << '\n');
@@ -3250,6 +3403,7 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   initializeCSRCost();
 
   calculateSpillWeightsAndHints(*LIS, mf, VRM, *Loops, *MBFI);
+  initializeJWAMode();
 
   LLVM_DEBUG(LIS->dump());
 
@@ -3267,6 +3421,7 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   tryHintsRecoloring();
   postOptimization();
   reportNumberOfSplillsReloads();
+  reportFunctionSpillsReloads();
 
   releaseMemory();
   return true;
@@ -726,6 +726,12 @@ MCSection *TargetLoweringObjectFileELF::getSectionForJumpTable(
 
 bool TargetLoweringObjectFileELF::shouldPutJumpTableInFunctionSection(
     bool UsesLabelDifference, const Function &F) const {
+  // JWA code is loaded from the text section alone, so we keep its
+  // label-relative jump tables in the code, where the entries (and the
+  // reference to the table) are resolved by the assembler.
+  if (UsesLabelDifference && F.getCallingConv() == CallingConv::JWA)
+    return true;
+
   // We can always create relative relocations, so use another section
   // that can be marked non-executable.
   return false;
@@ -49,6 +49,9 @@
 #include "llvm/CodeGen/TargetOpcodes.h"
 #include "llvm/CodeGen/TargetRegisterInfo.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/IR/CallingConv.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCInstrDesc.h"
 #include "llvm/MC/MCInstrItineraries.h"
 #include "llvm/Pass.h"
@@ -100,6 +103,10 @@ class TwoAddressInstructionPass : public MachineFunctionPass {
   AliasAnalysis *AA;
   CodeGenOpt::Level OptLevel;
 
+  // True for a JWA function whose module pins registers (the "jwa.pinned"
+  // module flag), i.e., whose reserved registers include pinned values.
+  bool HasPinnedRegs;
+
   // The current basic block being processed.
   MachineBasicBlock *MBB;
 
@@ -716,6 +723,18 @@ TwoAddressInstructionPass::isProfitableToConv3Addr(unsigned RegA,unsigned RegB){
   // %reg1026 = ADD %reg1024, %reg1025
   // r2            = MOV %reg1026
   // Turn ADD into a 3-address instruction to avoid a copy.
+  //
+  // The same holds in a JWA function when RegB is a copy of a pinned register:
+  // the register coalescer joins RegB with the reserved register, which stays
+  // live, so the 2-address form needs a copy.
+  if (HasPinnedRegs && Register::isVirtualRegister(RegB)) {
+    MachineInstr *DefMI = MRI->getUniqueVRegDef(RegB);
+    if (DefMI && DefMI->isCopy() && !DefMI->getOperand(1).getSubReg()) {
+      Register SrcReg = DefMI->getOperand(1).getReg();
+      if (Register::isPhysicalRegister(SrcReg) && !MRI->isAllocatable(SrcReg))
+        return true;
+    }
+  }
   unsigned FromRegB = getMappedReg(RegB, SrcRegMap);
   if (!FromRegB)
     return false;
@@ -1681,6 +1700,9 @@ bool TwoAddressInstructionPass::runOnMachineFunction(MachineFunction &Func) {
   // fixups are necessary for correctness.
   if (skipFunction(Func.getFunction()))
     OptLevel = CodeGenOpt::None;
+  const Function &F = Func.getFunction();
+  HasPinnedRegs = F.getCallingConv() == CallingConv::JWA &&
+                  F.getParent()->getModuleFlag("jwa.pinned");
 
   bool MadeChange = false;
 
@@ -0,0 +1,534 @@
+//===----- ELF_x86_64.cpp - JIT linker implementation for ELF/x86-64 ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// ELF/x86-64 jit-link implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITLink/ELF_x86_64.h"
+
+#include "BasicGOTAndStubsBuilder.h"
+#include "JITLinkGeneric.h"
+#include "llvm/Object/ELFObjectFile.h"
+
+#define DEBUG_TYPE "jitlink"
+
+using namespace llvm;
+using namespace llvm::jitlink;
+using namespace llvm::jitlink::ELF_x86_64_Edges;
+
+static const char *CommonSectionName = "__common";
+
+namespace {
+
+/// Builds a LinkGraph from an ELF x86-64 relocatable object. Each allocated
+/// section becomes a single block, so dead-stripping works at section
+/// granularity. Local symbols are kept (as Local scope symbols) so that
+/// relocations against them can be resolved, and section symbols become
+/// anonymous symbols at the start of their section's block.
+class ELFLinkGraphBuilder_x86_64 {
+  using ELFT = object::ELF64LE;
+  using Elf_Shdr = ELFT::Shdr;
+  using Elf_Sym = ELFT::Sym;
+  using Elf_Rela = ELFT::Rela;
+
+public:
+  ELFLinkGraphBuilder_x86_64(const object::ELFFile<ELFT> &Obj, StringRef Name)
+      : Obj(Obj),
+        G(std::make_unique<LinkGraph>(Name, 8, support::little)) {}
+
+  Expected<std::unique_ptr<LinkGraph>> buildGraph() {
+    if (Obj.getHeader()->e_type != ELF::ET_REL)
+      return make_error<JITLinkError>("Object is not a relocatable ELF");
+
+    auto Sections = Obj.sections();
+    if (!Sections)
+      return Sections.takeError();
+    ELFSections = *Sections;
+
+    if (auto Err = graphifySections())
+      return std::move(Err);
+
+    if (auto Err = graphifySymbols())
+      return std::move(Err);
+
+    if (auto Err = addRelocations())
+      return std::move(Err);
+
+    return std::move(G);
+  }
+
+private:
+  static Expected<ELFX86RelocationKind> getRelocationKind(uint32_t Type) {
+    switch (Type) {
+    case ELF::R_X86_64_PLT32:
+      return Branch32;
+    case ELF::R_X86_64_32:
+      return Pointer32;
+    case ELF::R_X86_64_32S:
+      return Pointer32Signed;
+    case ELF::R_X86_64_64:
+      return Pointer64;
+    case ELF::R_X86_64_PC32:
+      return PCRel32;
+    case ELF::R_X86_64_PC64:
+      return Delta64;
+    case ELF::R_X86_64_GOTPCREL:
+      return PCRel32GOTLoad;
+    case ELF::R_X86_64_GOTPCRELX:
+    case ELF::R_X86_64_REX_GOTPCRELX:
+      return PCRel32GOTLoadRelaxable;
+    }
+    return make_error<JITLinkError>("Unsupported x86-64 relocation type " +
+                                    Twine(Type));
+  }
+
+  /// Should the given section be included in the graph? We include all of
+  /// the allocated sections except for the .eh_frame section, since the
+  /// generic EH-frame passes expect MachO-style (relocation-free) frames.
+  bool isIncluded(const Elf_Shdr &Sec) const {
+    if (!(Sec.sh_flags & ELF::SHF_ALLOC) || Sec.sh_type == ELF::SHT_NULL)
+      return false;
+    auto Name = Obj.getSectionName(&Sec);
+    return !Name || *Name != ".eh_frame";
+  }
+
+  Error graphifySections() {
+    JITTargetAddress NextAddr = 0;
+    for (auto &Sec : ELFSections) {
+      if (!isIncluded(Sec)) {
+        Blocks.push_back(nullptr);
+        continue;
+      }
+
+      auto Name = Obj.getSectionName(&Sec);
+      if (!Name)
+        return Name.takeError();
+
+      unsigned Prot = sys::Memory::MF_READ;
+      if (Sec.sh_flags & ELF::SHF_WRITE)
+        Prot |= sys::Memory::MF_WRITE;
+      if (Sec.sh_flags & ELF::SHF_EXECINSTR)
+        Prot |= sys::Memory::MF_EXEC;
+      auto &GraphSec = G->createSection(
+          *Name, static_cast<sys::Memory::ProtectionFlags>(Prot));
+
+      // Relocatable ELF sections all have address zero, so we assign
+      // non-overlapping addresses to keep the blocks distinct.
+      uint64_t Align = std::max<uint64_t>(Sec.sh_addralign, 1);
+      NextAddr = alignTo(NextAddr, Align);
+
+      Block *B;
+      if (Sec.sh_type == ELF::SHT_NOBITS) {
+        B = &G->createZeroFillBlock(GraphSec, Sec.sh_size, NextAddr, Align, 0);
+      } else {
+        auto Data = Obj.getSectionContents(&Sec);
+        if (!Data)
+          return Data.takeError();
+        B = &G->createContentBlock(
+            GraphSec,
+            StringRef(reinterpret_cast<const char *>(Data->data()),
+                      Data->size()),
+            NextAddr, Align, 0);
+      }
+      Blocks.push_back(B);
+      NextAddr += Sec.sh_size;
+    }
+    CommonAddr = NextAddr;
+    return Error::success();
+  }
+
+  Section &getCommonSection() {
+    if (!CommonSection) {
+      auto Prot = static_cast<sys::Memory::ProtectionFlags>(
+          sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+      CommonSection = &G->createSection(CommonSectionName, Prot);
+    }
+    return *CommonSection;
+  }
+
+  Error graphifySymbols() {
+    const Elf_Shdr *SymTab = nullptr;
+    for (auto &Sec : ELFSections)
+      if (Sec.sh_type == ELF::SHT_SYMTAB) {
+        SymTab = &Sec;
+        break;
+      }
+    if (!SymTab)
+      return Error::success();
+
+    auto Syms = Obj.symbols(SymTab);
+    if (!Syms)
+      return Syms.takeError();
+    auto StrTab = Obj.getStringTableForSymtab(*SymTab, ELFSections);
+    if (!StrTab)
+      return StrTab.takeError();
+
+    Symbols.resize(Syms->size(), nullptr);
+    for (unsigned I = 1, E = Syms->size(); I < E; ++I) {
+      const Elf_Sym &Sym = (*Syms)[I];
+      auto Name = Sym.getName(*StrTab);
+      if (!Name)
+        return Name.takeError();
+
+      if (Sym.getType() == ELF::STT_FILE)
+        continue;
+
+      Linkage L = Sym.getBinding() == ELF::STB_WEAK ? Linkage::Weak
+                                                    : Linkage::Strong;
+      Scope S = Scope::Default;
+      if (Sym.getBinding() == ELF::STB_LOCAL)
+        S = Scope::Local;
+      else if (Sym.getVisibility() == ELF::STV_HIDDEN ||
+               Sym.getVisibility() == ELF::STV_INTERNAL)
+        S = Scope::Hidden;
+
+      if (Sym.isUndefined()) {
+        if (!Name->empty())
+          Symbols[I] = &G->addExternalSymbol(*Name, Sym.st_size, L);
+        continue;
+      }
+      if (Sym.isAbsolute()) {
+        Symbols[I] = &G->addAbsoluteSymbol(*Name, Sym.st_value, Sym.st_size,
+                                           L, S, false);
+        continue;
+      }
+      if (Sym.isCommon()) {
+        uint64_t Align = std::max<uint64_t>(Sym.st_value, 1);
+        CommonAddr = alignTo(CommonAddr, Align);
+        Symbols[I] = &G->addCommonSymbol(*Name, S, getCommonSection(),
+                                         CommonAddr, Sym.st_size, Align, false);
+        CommonAddr += Sym.st_size;
+        continue;
+      }
+      if (Sym.st_shndx >= ELF::SHN_LORESERVE)
+        return make_error<JITLinkError>("Unsupported section index for " +
+                                        *Name);
+
+      // Symbols in sections that are not included (e.g., debug info) are
+      // dropped; a relocation that refers to one is an error.
+      if (Sym.st_shndx >= Blocks.size())
+        return make_error<JITLinkError>("Invalid section index for " + *Name);
+      Block *B = Blocks[Sym.st_shndx];
+      if (!B)
+        continue;
+
+      if (Sym.getType() == ELF::STT_SECTION || Name->empty())
+        Symbols[I] =
+            &G->addAnonymousSymbol(*B, Sym.st_value, 0, false, false);
+      else
+        Symbols[I] = &G->addDefinedSymbol(
+            *B, Sym.st_value, *Name, Sym.st_size, L, S,
+            Sym.getType() == ELF::STT_FUNC, false);
+    }
+    return Error::success();
+  }
+
+  Error addRelocations() {
+    for (auto &RelSec : ELFSections) {
+      if (RelSec.sh_type == ELF::SHT_REL)
+        return make_error<JITLinkError>(
+            "SHT_REL relocation sections are not supported for x86-64");
+      if (RelSec.sh_type != ELF::SHT_RELA)
+        continue;
+      if (RelSec.sh_info >= Blocks.size())
+        return make_error<JITLinkError>("Invalid relocation section target");
+      Block *BlockToFix = Blocks[RelSec.sh_info];
+      if (!BlockToFix)
+        continue;
+
+      auto Relocs = Obj.relas(&RelSec);
+      if (!Relocs)
+        return Relocs.takeError();
+      for (const Elf_Rela &R : *Relocs) {
+        auto Kind = getRelocationKind(R.getType(false));
+        if (!Kind)
+          return Kind.takeError();
+        uint32_t SymIdx = R.getSymbol(false);
+        if (SymIdx >= Symbols.size() || !Symbols[SymIdx])
+          return make_error<JITLinkError>(
+              "Relocation refers to a symbol that is not in the graph");
+        uint64_t FixupSize = (*Kind == Pointer64 || *Kind == Delta64) ? 8 : 4;
+        if (R.r_offset + FixupSize > BlockToFix->getSize())
+          return make_error<JITLinkError>("Relocation offset out of range");
+        if ((*Kind == PCRel32GOTLoad || *Kind == PCRel32GOTLoadRelaxable) &&
+            !Symbols[SymIdx]->hasName())
+          return make_error<JITLinkError>(
+              "GOT relocation refers to an anonymous symbol");
+
+        LLVM_DEBUG({
+          dbgs() << "Processing relocation at "
+                 << format("0x%016" PRIx64,
+                           BlockToFix->getAddress() + R.r_offset)
+                 << ": " << getELFX86RelocationKindName(*Kind)
+                 << ", addend = " << (int64_t)R.r_addend << "\n";
+        });
+        BlockToFix->addEdge(*Kind, R.r_offset, *Symbols[SymIdx], R.r_addend);
+      }
+    }
+    return Error::success();
+  }
+
+  const object::ELFFile<ELFT> &Obj;
+  std::unique_ptr<LinkGraph> G;
+  ArrayRef<Elf_Shdr> ELFSections;
+  std::vector<Block *> Blocks;   // indexed by ELF section index
+  std::vector<Symbol *> Symbols; // indexed by ELF symbol index
+  Section *CommonSection = nullptr;
+  JITTargetAddress CommonAddr = 0;
+};
+
+/// Rewrite relaxable GOT loads of symbols that are defined in the graph into
+/// direct address computations, so that they do not need GOT entries. The
+/// only relaxation that we perform is `mov foo@GOTPCREL(%rip), %reg` to
+/// `lea foo(%rip), %reg`; the opcode byte is patched when the fixup is applied.
+Error optimizeELFx86_64GOTLoads(LinkGraph &G) {
+  for (auto *B : G.blocks())
+    for (auto &E : B->edges()) {
+      if (E.getKind() != PCRel32GOTLoadRelaxable)
+        continue;
+      auto &Target = E.getTarget();
+      if (!Target.isDefined() || B->isZeroFill() || E.getOffset() < 2)
+        continue;
+      const uint8_t Opcode =
+          static_cast<uint8_t>(B->getContent()[E.getOffset() - 2]);
+      if (Opcode != 0x8b)
+        continue;
+      E.setKind(PCRel32GOTLoadRelaxed);
+    }
+  return Error::success();
+}
+
+class ELF_x86_64_GOTAndStubsBuilder
+    : public BasicGOTAndStubsBuilder<ELF_x86_64_GOTAndStubsBuilder> {
+public:
+  ELF_x86_64_GOTAndStubsBuilder(LinkGraph &G)
+      : BasicGOTAndStubsBuilder<ELF_x86_64_GOTAndStubsBuilder>(G) {}
+
+  bool isGOTEdge(Edge &E) const {
+    return E.getKind() == PCRel32GOTLoad ||
+           E.getKind() == PCRel32GOTLoadRelaxable;
+  }
+
+  Symbol &createGOTEntry(Symbol &Target) {
+    auto &GOTEntryBlock = G.createContentBlock(
+        getGOTSection(), getGOTEntryBlockContent(), 0, 8, 0);
+    GOTEntryBlock.addEdge(Pointer64, 0, Target, 0);
+    return G.addAnonymousSymbol(GOTEntryBlock, 0, 8, false, false);
+  }
+
+  void fixGOTEdge(Edge &E, Symbol &GOTEntry) {
+    assert(isGOTEdge(E) && "Not a GOT edge?");
+    E.setKind(PCRel32);
+    E.setTarget(GOTEntry);
+    // Leave the edge addend as-is.
+  }
+
+  bool isExternalBranchEdge(Edge &E) {
+    return E.getKind() == Branch32 && !E.getTarget().isDefined();
+  }
+
+  Symbol &createStub(Symbol &Target) {
+    auto &StubContentBlock =
+        G.createContentBlock(getStubsSection(), getStubBlockContent(), 0, 1, 0);
+    // Re-use GOT entries for stub targets.
+    auto &GOTEntrySymbol = getGOTEntrySymbol(Target);
+    StubContentBlock.addEdge(PCRel32, 2, GOTEntrySymbol, -4);
+    return G.addAnonymousSymbol(StubContentBlock, 0, 6, true, false);
+  }
+
+  void fixExternalBranchEdge(Edge &E, Symbol &Stub) {
+    assert(E.getKind() == Branch32 && "Not a Branch32 edge?");
+    // Leave the edge addend (normally -4) as-is.
+    E.setTarget(Stub);
+  }
+
+private:
+  Section &getGOTSection() {
+    if (!GOTSection)
+      GOTSection = &G.createSection("$__GOT", sys::Memory::MF_READ);
+    return *GOTSection;
+  }
+
+  Section &getStubsSection() {
+    if (!StubsSection) {
+      auto StubsProt = static_cast<sys::Memory::ProtectionFlags>(
+          sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+      StubsSection = &G.createSection("$__STUBS", StubsProt);
+    }
+    return *StubsSection;
+  }
+
+  StringRef getGOTEntryBlockContent() {
+    return StringRef(reinterpret_cast<const char *>(NullGOTEntryContent),
+                     sizeof(NullGOTEntryContent));
+  }
+
+  StringRef getStubBlockContent() {
+    return StringRef(reinterpret_cast<const char *>(StubContent),
+                     sizeof(StubContent));
+  }
+
+  static const uint8_t NullGOTEntryContent[8];
+  static const uint8_t StubContent[6];
+  Section *GOTSection = nullptr;
+  Section *StubsSection = nullptr;
+};
+
+const uint8_t ELF_x86_64_GOTAndStubsBuilder::NullGOTEntryContent[8] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+const uint8_t ELF_x86_64_GOTAndStubsBuilder::StubContent[6] = {
+    0xFF, 0x25, 0x00, 0x00, 0x00, 0x00};
+} // namespace
+
+namespace llvm {
+namespace jitlink {
+
+class ELFJITLinker_x86_64 : public JITLinker<ELFJITLinker_x86_64> {
+  friend class JITLinker<ELFJITLinker_x86_64>;
+
+public:
+  ELFJITLinker_x86_64(std::unique_ptr<JITLinkContext> Ctx,
+                      PassConfiguration PassConfig)
+      : JITLinker(std::move(Ctx), std::move(PassConfig)) {}
+
+private:
+  StringRef getEdgeKindName(Edge::Kind R) const override {
+    return getELFX86RelocationKindName(R);
+  }
+
+  Expected<std::unique_ptr<LinkGraph>>
+  buildGraph(MemoryBufferRef ObjBuffer) override {
+    auto ELFObj = object::ELFFile<object::ELF64LE>::create(ObjBuffer.getBuffer());
+    if (!ELFObj)
+      return ELFObj.takeError();
+    return ELFLinkGraphBuilder_x86_64(*ELFObj, ObjBuffer.getBufferIdentifier())
+        .buildGraph();
+  }
+
+  static Error targetOutOfRangeError(const Block &B, const Edge &E) {
+    std::string ErrMsg;
+    {
+      raw_string_ostream ErrStream(ErrMsg);
+      ErrStream << "Relocation target out of range: ";
+      printEdge(ErrStream, B, E, getELFX86RelocationKindName(E.getKind()));
+      ErrStream << "\n";
+    }
+    return make_error<JITLinkError>(std::move(ErrMsg));
+  }
+
+  Error applyFixup(Block &B, const Edge &E, char *BlockWorkingMem) const {
+
+    using namespace support;
+
+    char *FixupPtr = BlockWorkingMem + E.getOffset();
+    JITTargetAddress FixupAddress = B.getAddress() + E.getOffset();
+
+    switch (E.getKind()) {
+    case PCRel32GOTLoadRelaxed:
+      // mov foo@GOTPCREL(%rip), %reg  ==>  lea foo(%rip), %reg
+      FixupPtr[-2] = static_cast<char>(0x8d);
+      LLVM_FALLTHROUGH;
+    case Branch32:
+    case PCRel32: {
+      int64_t Value =
+          E.getTarget().getAddress() + E.getAddend() - FixupAddress;
+      if (Value < std::numeric_limits<int32_t>::min() ||
+          Value > std::numeric_limits<int32_t>::max())
+        return targetOutOfRangeError(B, E);
+      *(little32_t *)FixupPtr = Value;
+      break;
+    }
+    case Delta64: {
+      int64_t Value =
+          E.getTarget().getAddress() + E.getAddend() - FixupAddress;
+      *(little64_t *)FixupPtr = Value;
+      break;
+    }
+    case Pointer64: {
+      uint64_t Value = E.getTarget().getAddress() + E.getAddend();
+      *(ulittle64_t *)FixupPtr = Value;
+      break;
+    }
+    case Pointer32: {
+      uint64_t Value = E.getTarget().getAddress() + E.getAddend();
+      if (Value > std::numeric_limits<uint32_t>::max())
+        return targetOutOfRangeError(B, E);
+      *(ulittle32_t *)FixupPtr = Value;
+      break;
+    }
+    case Pointer32Signed: {
+      int64_t Value = E.getTarget().getAddress() + E.getAddend();
+      if (Value < std::numeric_limits<int32_t>::min() ||
+          Value > std::numeric_limits<int32_t>::max())
+        return targetOutOfRangeError(B, E);
+      *(little32_t *)FixupPtr = Value;
+      break;
+    }
+    default:
+      llvm_unreachable("Unrecognized edge kind");
+    }
+
+    return Error::success();
+  }
+};
+
+void jitLink_ELF_x86_64(std::unique_ptr<JITLinkContext> Ctx) {
+  PassConfiguration Config;
+  Triple TT("x86_64-unknown-linux");
+
+  if (Ctx->shouldAddDefaultTargetPasses(TT)) {
+    // Add a mark-live pass.
+    if (auto MarkLive = Ctx->getMarkLivePass(TT))
+      Config.PrePrunePasses.push_back(std::move(MarkLive));
+    else
+      Config.PrePrunePasses.push_back(markAllSymbolsLive);
+
+    // Relax GOT loads of defined symbols, then add an in-place GOT/Stubs pass
+    // for the remaining GOT loads and external branches.
+    Config.PostPrunePasses.push_back(optimizeELFx86_64GOTLoads);
+    Config.PostPrunePasses.push_back([](LinkGraph &G) -> Error {
+      ELF_x86_64_GOTAndStubsBuilder(G).run();
+      return Error::success();
+    });
+  }
+
+  if (auto Err = Ctx->modifyPassConfig(TT, Config))
+    return Ctx->notifyFailed(std::move(Err));
+
+  // Construct a JITLinker and run the link function.
+  ELFJITLinker_x86_64::link(std::move(Ctx), std::move(Config));
+}
+
+StringRef getELFX86RelocationKindName(Edge::Kind R) {
+  switch (R) {
+  case Branch32:
+    return "Branch32";
+  case Pointer32:
+    return "Pointer32";
+  case Pointer32Signed:
+    return "Pointer32Signed";
+  case Pointer64:
+    return "Pointer64";
+  case PCRel32:
+    return "PCRel32";
+  case Delta64:
+    return "Delta64";
+  case PCRel32GOTLoad:
+    return "PCRel32GOTLoad";
+  case PCRel32GOTLoadRelaxable:
+    return "PCRel32GOTLoadRelaxable";
+  case PCRel32GOTLoadRelaxed:
+    return "PCRel32GOTLoadRelaxed";
+  default:
+    return getGenericEdgeKindName(static_cast<Edge::Kind>(R));
+  }
+}
+
+} // end namespace jitlink
+} // end namespace llvm
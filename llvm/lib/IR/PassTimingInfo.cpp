@@ -147,7 +147,21 @@ PassTimingInfo *PassTimingInfo::TheTimeInfo;
 } // namespace legacy
 } // namespace
 
+/// The pass-timer source of the current thread, if any.
+static LLVM_THREAD_LOCAL PassTimerSource *ThreadTimerSource = nullptr;
+
+PassTimerSource::~PassTimerSource() = default;
+
+PassTimerSource *setThreadPassTimerSource(PassTimerSource *Source) {
+  PassTimerSource *Prev = ThreadTimerSource;
+  ThreadTimerSource = Source;
+  return Prev;
+}
+
 Timer *getPassTimer(Pass *P) {
+  if (PassTimerSource *Source = ThreadTimerSource)
+    return P->getAsPMDataManager() ? nullptr : Source->getPassTimer(P);
+
   legacy::PassTimingInfo::init();
   if (legacy::PassTimingInfo::TheTimeInfo)
     return legacy::PassTimingInfo::TheTimeInfo->getPassTimer(P, P);
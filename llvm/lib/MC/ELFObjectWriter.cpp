@@ -15,6 +15,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/BinaryFormat/ELF.h"
@@ -39,6 +40,7 @@
 #include "llvm/Support/Alignment.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
@@ -46,6 +48,7 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/SwapByteOrder.h"
@@ -65,8 +68,28 @@ using namespace llvm;
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+STATISTIC(NumOmittedSymbolTables, "Number of objects without a symbol table");
+
+// The contents and relocations of a section are encoded in parallel chunks
+// when they are at least this large. Chunks are concatenated in order, so the
+// output does not depend on the number of threads.
+static cl::opt<unsigned> ParallelWriteThreshold(
+    "elf-parallel-write-threshold", cl::Hidden, cl::init(1024 * 1024),
+    cl::desc("Minimum size in bytes of a section's contents or relocations "
+             "for encoding them in parallel (0 = never)"));
+
+static cl::opt<unsigned> ParallelWriteChunkSize(
+    "elf-parallel-write-chunk-size", cl::Hidden, cl::init(256 * 1024),
+    cl::desc("Target size in bytes of the chunks of a section that are "
+             "encoded in parallel"));
+
 namespace {
 
+bool shouldWriteInParallel(uint64_t Size) {
+  return LLVM_ENABLE_THREADS && ParallelWriteThreshold &&
+         Size >= ParallelWriteThreshold;
+}
+
 using SectionIndexMapTy = DenseMap<const MCSectionELF *, uint32_t>;
 
 class ELFObjectWriter;
@@ -196,10 +219,11 @@ public:
   /// \param Asm - The assembler.
   /// \param SectionIndexMap - Maps a section to its index.
   /// \param RevGroupMap - Maps a signature symbol to the group section.
+  /// \param NeedsSymtab - Emit the symbol table even if it has no symbols.
   void computeSymbolTable(MCAssembler &Asm, const MCAsmLayout &Layout,
                           const SectionIndexMapTy &SectionIndexMap,
                           const RevGroupMapTy &RevGroupMap,
-                          SectionOffsetsTy &SectionOffsets);
+                          SectionOffsetsTy &SectionOffsets, bool NeedsSymtab);
 
   void writeAddrsigSection();
 
@@ -214,6 +238,9 @@ public:
 
   void writeSectionData(const MCAssembler &Asm, MCSection &Sec,
                         const MCAsmLayout &Layout);
+  void writeSectionDataInParallel(const MCAssembler &Asm,
+                                  const MCSection &Sec,
+                                  const MCAsmLayout &Layout);
 
   void WriteSecHdrEntry(uint32_t Name, uint32_t Type, uint64_t Flags,
                         uint64_t Address, uint64_t Offset, uint64_t Size,
@@ -221,6 +248,9 @@ public:
                         uint64_t EntrySize);
 
   void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec);
+  void writeRelocations(support::endian::Writer &RW,
+                        ArrayRef<ELFRelocationEntry> Relocs, size_t Begin,
+                        size_t End);
 
   uint64_t writeObject(MCAssembler &Asm, const MCAsmLayout &Layout);
   void writeSection(const SectionIndexMapTy &SectionIndexMap,
@@ -607,22 +637,8 @@ bool ELFWriter::isInSymtab(const MCAsmLayout &Layout, const MCSymbolELF &Symbol,
 void ELFWriter::computeSymbolTable(
     MCAssembler &Asm, const MCAsmLayout &Layout,
     const SectionIndexMapTy &SectionIndexMap, const RevGroupMapTy &RevGroupMap,
-    SectionOffsetsTy &SectionOffsets) {
+    SectionOffsetsTy &SectionOffsets, bool NeedsSymtab) {
   MCContext &Ctx = Asm.getContext();
-  SymbolTableWriter Writer(*this, is64Bit());
-
-  // Symbol table
-  unsigned EntrySize = is64Bit() ? ELF::SYMENTRY_SIZE64 : ELF::SYMENTRY_SIZE32;
-  MCSectionELF *SymtabSection =
-      Ctx.getELFSection(".symtab", ELF::SHT_SYMTAB, 0, EntrySize, "");
-  SymtabSection->setAlignment(is64Bit() ? Align(8) : Align(4));
-  SymbolTableIndex = addToSectionTable(SymtabSection);
-
-  align(SymtabSection->getAlignment());
-  uint64_t SecStart = W.OS.tell();
-
-  // The first entry is the undefined symbol entry.
-  Writer.writeSymbol(0, 0, 0, 0, 0, 0, false);
 
   std::vector<ELFSymbolData> LocalSymbolData;
   std::vector<ELFSymbolData> ExternalSymbolData;
@@ -706,6 +722,34 @@ void ELFWriter::computeSymbolTable(
       ExternalSymbolData.push_back(MSD);
   }
 
+  ArrayRef<std::string> FileNames = Asm.getFileNames();
+
+  // An object without symbols (e.g., code that is loaded into memory by a JIT
+  // and that only uses assembler-resolved labels) does not need a symbol
+  // table, in which case the string table only holds the section names.
+  if (LocalSymbolData.empty() && ExternalSymbolData.empty() &&
+      FileNames.empty() && !NeedsSymtab) {
+    ++NumOmittedSymbolTables;
+    SymbolTableIndex = 0;
+    StrTabBuilder.finalize();
+    return;
+  }
+
+  SymbolTableWriter Writer(*this, is64Bit());
+
+  // Symbol table
+  unsigned EntrySize = is64Bit() ? ELF::SYMENTRY_SIZE64 : ELF::SYMENTRY_SIZE32;
+  MCSectionELF *SymtabSection =
+      Ctx.getELFSection(".symtab", ELF::SHT_SYMTAB, 0, EntrySize, "");
+  SymtabSection->setAlignment(is64Bit() ? Align(8) : Align(4));
+  SymbolTableIndex = addToSectionTable(SymtabSection);
+
+  align(SymtabSection->getAlignment());
+  uint64_t SecStart = W.OS.tell();
+
+  // The first entry is the undefined symbol entry.
+  Writer.writeSymbol(0, 0, 0, 0, 0, 0, false);
+
   // This holds the .symtab_shndx section index.
   unsigned SymtabShndxSectionIndex = 0;
 
@@ -716,7 +760,6 @@ void ELFWriter::computeSymbolTable(
     SymtabShndxSection->setAlignment(Align(4));
   }
 
-  ArrayRef<std::string> FileNames = Asm.getFileNames();
   for (const std::string &Name : FileNames)
     StrTabBuilder.add(Name);
 
@@ -855,7 +898,10 @@ void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
       MAI->compressDebugSections() != DebugCompressionType::None;
   if (!CompressionEnabled || !SectionName.startswith(".debug_") ||
       SectionName == ".debug_frame") {
-    Asm.writeSectionData(W.OS, &Section, Layout);
+    if (shouldWriteInParallel(Layout.getSectionFileSize(&Section)))
+      writeSectionDataInParallel(Asm, Section, Layout);
+    else
+      Asm.writeSectionData(W.OS, &Section, Layout);
     return;
   }
 
@@ -896,6 +942,37 @@ void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
   W.OS << CompressedContents;
 }
 
+void ELFWriter::writeSectionDataInParallel(const MCAssembler &Asm,
+                                           const MCSection &Sec,
+                                           const MCAsmLayout &Layout) {
+  // Split the fragments into chunks of roughly equal size. Computing the
+  // offsets also completes the layout of the section, so that the concurrent
+  // writers only read it.
+  SmallVector<MCSection::const_iterator, 16> ChunkStarts;
+  uint64_t ChunkOffset = 0;
+  for (auto I = Sec.begin(), E = Sec.end(); I != E; ++I) {
+    uint64_t Offset = Layout.getFragmentOffset(&*I);
+    if (ChunkStarts.empty() || Offset - ChunkOffset >= ParallelWriteChunkSize) {
+      ChunkStarts.push_back(I);
+      ChunkOffset = Offset;
+    }
+  }
+  ChunkStarts.push_back(Sec.end());
+
+  size_t NumChunks = ChunkStarts.size() - 1;
+  std::vector<SmallVector<char, 0>> Chunks(NumChunks);
+  parallel::for_each_n(parallel::par, size_t(0), NumChunks, [&](size_t I) {
+    raw_svector_ostream OS(Chunks[I]);
+    Asm.writeFragmentData(OS, Layout, ChunkStarts[I], ChunkStarts[I + 1]);
+  });
+
+  uint64_t Start = W.OS.tell();
+  (void)Start;
+  for (const SmallVector<char, 0> &Chunk : Chunks)
+    W.OS << StringRef(Chunk.data(), Chunk.size());
+  assert(W.OS.tell() - Start == Layout.getSectionAddressSize(&Sec));
+}
+
 void ELFWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type, uint64_t Flags,
                                  uint64_t Address, uint64_t Offset,
                                  uint64_t Size, uint32_t Link, uint32_t Info,
@@ -925,52 +1002,83 @@ void ELFWriter::writeRelocations(const MCAssembler &Asm,
   // Sort the relocation entries. MIPS needs this.
   OWriter.TargetObjectWriter->sortRelocs(Asm, Relocs);
 
-  for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
+  uint64_t EntrySize;
+  if (hasRelocationAddend())
+    EntrySize = is64Bit() ? sizeof(ELF::Elf64_Rela) : sizeof(ELF::Elf32_Rela);
+  else
+    EntrySize = is64Bit() ? sizeof(ELF::Elf64_Rel) : sizeof(ELF::Elf32_Rel);
+
+  if (!shouldWriteInParallel(Relocs.size() * EntrySize)) {
+    writeRelocations(W, Relocs, 0, Relocs.size());
+    return;
+  }
+
+  // Encode chunks of the relocations concurrently. The symbol indices have
+  // been assigned by this point, so the entries are independent.
+  size_t ChunkLen = std::max<size_t>(ParallelWriteChunkSize / EntrySize, 1);
+  size_t NumChunks = divideCeil(Relocs.size(), ChunkLen);
+  std::vector<SmallVector<char, 0>> Chunks(NumChunks);
+  parallel::for_each_n(parallel::par, size_t(0), NumChunks, [&](size_t I) {
+    raw_svector_ostream OS(Chunks[I]);
+    support::endian::Writer RW(OS, W.Endian);
+    writeRelocations(RW, Relocs, I * ChunkLen,
+                     std::min((I + 1) * ChunkLen, Relocs.size()));
+  });
+  for (const SmallVector<char, 0> &Chunk : Chunks)
+    W.OS << StringRef(Chunk.data(), Chunk.size());
+}
+
+// Encode the entries [Begin, End) of the relocations for a section, which are
+// written in the reverse order of \p Relocs.
+void ELFWriter::writeRelocations(support::endian::Writer &RW,
+                                 ArrayRef<ELFRelocationEntry> Relocs,
+                                 size_t Begin, size_t End) {
+  for (size_t i = Begin, e = Relocs.size(); i != End; ++i) {
     const ELFRelocationEntry &Entry = Relocs[e - i - 1];
     unsigned Index = Entry.Symbol ? Entry.Symbol->getIndex() : 0;
 
     if (is64Bit()) {
-      write(Entry.Offset);
+      RW.write(Entry.Offset);
       if (OWriter.TargetObjectWriter->getEMachine() == ELF::EM_MIPS) {
-        write(uint32_t(Index));
+        RW.write(uint32_t(Index));
 
-        write(OWriter.TargetObjectWriter->getRSsym(Entry.Type));
-        write(OWriter.TargetObjectWriter->getRType3(Entry.Type));
-        write(OWriter.TargetObjectWriter->getRType2(Entry.Type));
-        write(OWriter.TargetObjectWriter->getRType(Entry.Type));
+        RW.write(OWriter.TargetObjectWriter->getRSsym(Entry.Type));
+        RW.write(OWriter.TargetObjectWriter->getRType3(Entry.Type));
+        RW.write(OWriter.TargetObjectWriter->getRType2(Entry.Type));
+        RW.write(OWriter.TargetObjectWriter->getRType(Entry.Type));
       } else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(Index, Entry.Type);
-        write(ERE64.r_info);
+        RW.write(ERE64.r_info);
       }
       if (hasRelocationAddend())
-        write(Entry.Addend);
+        RW.write(Entry.Addend);
     } else {
-      write(uint32_t(Entry.Offset));
+      RW.write(uint32_t(Entry.Offset));
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(Index, Entry.Type);
-      write(ERE32.r_info);
+      RW.write(ERE32.r_info);
 
       if (hasRelocationAddend())
-        write(uint32_t(Entry.Addend));
+        RW.write(uint32_t(Entry.Addend));
 
       if (OWriter.TargetObjectWriter->getEMachine() == ELF::EM_MIPS) {
         if (uint32_t RType =
                 OWriter.TargetObjectWriter->getRType2(Entry.Type)) {
-          write(uint32_t(Entry.Offset));
+          RW.write(uint32_t(Entry.Offset));
 
           ERE32.setSymbolAndType(0, RType);
-          write(ERE32.r_info);
-          write(uint32_t(0));
+          RW.write(ERE32.r_info);
+          RW.write(uint32_t(0));
         }
         if (uint32_t RType =
                 OWriter.TargetObjectWriter->getRType3(Entry.Type)) {
-          write(uint32_t(Entry.Offset));
+          RW.write(uint32_t(Entry.Offset));
 
           ERE32.setSymbolAndType(0, RType);
-          write(ERE32.r_info);
-          write(uint32_t(0));
+          RW.write(ERE32.r_info);
+          RW.write(uint32_t(0));
         }
       }
     }
@@ -1170,8 +1278,12 @@ uint64_t ELFWriter::writeObject(MCAssembler &Asm, const MCAsmLayout &Layout) {
     }
 
     // Compute symbol table information.
+    // Relocation, group, and address-significance sections refer to the
+    // symbol table by its index.
     computeSymbolTable(Asm, Layout, SectionIndexMap, RevGroupMap,
-                       SectionOffsets);
+                       SectionOffsets,
+                       !Relocations.empty() || !Groups.empty() ||
+                           OWriter.EmitAddrsigSection || CGProfileSection);
 
     for (MCSectionELF *RelSection : Relocations) {
       align(RelSection->getAlignment());
@@ -8,6 +8,8 @@
 
 #include "llvm/MC/MCAssembler.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
@@ -32,6 +34,7 @@
 #include "llvm/MC/MCValue.h"
 #include "llvm/Support/Alignment.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
@@ -68,10 +71,21 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SkippedRelaxationChecks,
+          "Number of relaxable fragments skipped because their fixup "
+          "distance did not change");
+STATISTIC(EarlyRelaxedInstructions,
+          "Number of instructions relaxed early by the size estimate");
 
 } // end namespace stats
 } // end anonymous namespace
 
+static cl::opt<unsigned> EarlyRelaxMargin(
+    "mc-early-relax-margin", cl::Hidden, cl::init(0),
+    cl::desc("In the first layout pass, relax PC-relative instructions whose "
+             "distance to the target is within this many bytes of the limit "
+             "of the short form's range (0 = disabled)"));
+
 // FIXME FIXME FIXME: There are number of places in this file where we convert
 // what is a 64-bit assembler value used for computation into a value in the
 // object file, which may truncate it. We should detect that truncation where
@@ -720,6 +734,18 @@ void MCAssembler::writeSectionData(raw_ostream &OS, const MCSection *Sec,
   assert(OS.tell() - Start == Layout.getSectionAddressSize(Sec));
 }
 
+void MCAssembler::writeFragmentData(raw_ostream &OS, const MCAsmLayout &Layout,
+                                    MCSection::const_iterator Begin,
+                                    MCSection::const_iterator End) const {
+  assert(getBackendPtr() && "Expected assembler backend");
+
+  for (; Begin != End; ++Begin) {
+    assert(!Begin->getParent()->isVirtualSection() &&
+           "Cannot write fragments of a virtual section");
+    writeFragment(OS, *this, Layout, *Begin);
+  }
+}
+
 std::tuple<MCValue, uint64_t, bool>
 MCAssembler::handleFixup(const MCAsmLayout &Layout, MCFragment &F,
                          const MCFixup &Fixup) {
@@ -873,7 +899,8 @@ void MCAssembler::Finish() {
 
 bool MCAssembler::fixupNeedsRelaxation(const MCFixup &Fixup,
                                        const MCRelaxableFragment *DF,
-                                       const MCAsmLayout &Layout) const {
+                                       const MCAsmLayout &Layout,
+                                       uint64_t Margin) const {
   assert(getBackendPtr() && "Expected assembler backend");
   MCValue Target;
   uint64_t Value;
@@ -883,12 +910,17 @@ bool MCAssembler::fixupNeedsRelaxation(const MCFixup &Fixup,
       Target.getSymA()->getKind() == MCSymbolRefExpr::VK_X86_ABS8 &&
       Fixup.getKind() == FK_Data_1)
     return false;
+  if (Margin && Resolved &&
+      (getBackend().getFixupKindInfo(Fixup.getKind()).Flags &
+       MCFixupKindInfo::FKF_IsPCRel))
+    Value = int64_t(Value) < 0 ? Value - Margin : Value + Margin;
   return getBackend().fixupNeedsRelaxationAdvanced(Fixup, Resolved, Value, DF,
                                                    Layout, WasForced);
 }
 
 bool MCAssembler::fragmentNeedsRelaxation(const MCRelaxableFragment *F,
-                                          const MCAsmLayout &Layout) const {
+                                          const MCAsmLayout &Layout,
+                                          uint64_t Margin) const {
   assert(getBackendPtr() && "Expected assembler backend");
   // If this inst doesn't ever need relaxation, ignore it. This occurs when we
   // are intentionally pushing out inst fragments, or because we relaxed a
@@ -897,20 +929,22 @@ bool MCAssembler::fragmentNeedsRelaxation(const MCRelaxableFragment *F,
     return false;
 
   for (const MCFixup &Fixup : F->getFixups())
-    if (fixupNeedsRelaxation(Fixup, F, Layout))
+    if (fixupNeedsRelaxation(Fixup, F, Layout, Margin))
       return true;
 
   return false;
 }
 
 bool MCAssembler::relaxInstruction(MCAsmLayout &Layout,
-                                   MCRelaxableFragment &F) {
+                                   MCRelaxableFragment &F, uint64_t Margin) {
   assert(getEmitterPtr() &&
          "Expected CodeEmitter defined for relaxInstruction");
-  if (!fragmentNeedsRelaxation(&F, Layout))
+  if (!fragmentNeedsRelaxation(&F, Layout, Margin))
     return false;
 
   ++stats::RelaxedInstructions;
+  if (Margin && !fragmentNeedsRelaxation(&F, Layout))
+    ++stats::EarlyRelaxedInstructions;
 
   // FIXME-PERF: We could immediately lower out instructions if we can tell
   // they are fully resolved, to avoid retesting on later passes.
@@ -1108,13 +1142,79 @@ bool MCAssembler::relaxCVDefRange(MCAsmLayout &Layout,
   return OldSize != F.getContents().size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
+// Relaxation is repeated until no fragment changes, but a pass typically only
+// relaxes a few instructions, which move the fragments that follow them. The
+// value of a PC-relative fixup only depends on the distance between its
+// fragment and the target fragment, so a relaxable fragment that did not need
+// relaxation in the previous pass does not need to be checked again unless
+// the two fragments moved by different amounts.
+struct MCAssembler::SectionRelaxState {
+  /// The first pass checks every fragment.
+  bool FirstPass = true;
+
+  /// The fragment offsets at the start of the previous and current passes,
+  /// indexed by layout order.
+  std::vector<uint64_t> PrevOffsets;
+  std::vector<uint64_t> Offsets;
+
+  /// The fragments that were relaxed in the previous pass.
+  BitVector Relaxed;
+
+  /// The fragment that holds the fixup target of a relaxable fragment, or null
+  /// if the fragment must always be checked.
+  DenseMap<const MCRelaxableFragment *, const MCFragment *> Targets;
+
+  /// Can the check of \p F be skipped in this pass?
+  bool canSkip(const MCRelaxableFragment &F) const {
+    if (FirstPass || Relaxed.test(F.getLayoutOrder()))
+      return false;
+    const MCFragment *T = Targets.lookup(&F);
+    if (!T)
+      return false;
+    unsigned FI = F.getLayoutOrder(), TI = T->getLayoutOrder();
+    return Offsets[FI] - PrevOffsets[FI] == Offsets[TI] - PrevOffsets[TI];
+  }
+};
+
+const MCFragment *
+MCAssembler::getRelaxationTarget(const MCAsmLayout &Layout,
+                                 const MCRelaxableFragment &F,
+                                 const MCSection &Sec) const {
+  if (F.getFixups().size() != 1)
+    return nullptr;
+  const MCFixup &Fixup = F.getFixups()[0];
+  if (!(getBackend().getFixupKindInfo(Fixup.getKind()).Flags &
+        MCFixupKindInfo::FKF_IsPCRel))
+    return nullptr;
+
+  MCValue Target;
+  if (!Fixup.getValue()->evaluateAsRelocatable(Target, &Layout, &Fixup) ||
+      !Target.getSymA() || Target.getSymB() ||
+      Target.getSymA()->getKind() != MCSymbolRefExpr::VK_None)
+    return nullptr;
+
+  const MCSymbol &Sym = Target.getSymA()->getSymbol();
+  if (Sym.isVariable() || !Sym.getFragment() ||
+      Sym.getFragment()->getParent() != &Sec)
+    return nullptr;
+  return Sym.getFragment();
+}
+
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                                    SectionRelaxState &State) {
   // Holds the first fragment which needed relaxing during this layout. It will
   // remain NULL if none were relaxed.
   // When a fragment is relaxed, all the fragments following it should get
   // invalidated because their offset is going to change.
   MCFragment *FirstRelaxedFragment = nullptr;
 
+  // Record the offsets at the start of this pass.
+  std::swap(State.PrevOffsets, State.Offsets);
+  State.Offsets.clear();
+  for (MCFragment &F : Sec)
+    State.Offsets.push_back(Layout.getFragmentOffset(&F));
+  BitVector Relaxed(State.Offsets.size());
+
   // Attempt to relax all the fragments in the section.
   for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
     // Check if this is a fragment that needs relaxation.
@@ -1122,11 +1222,21 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
     switch(I->getKind()) {
     default:
       break;
-    case MCFragment::FT_Relaxable:
+    case MCFragment::FT_Relaxable: {
       assert(!getRelaxAll() &&
              "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
+      auto &RF = *cast<MCRelaxableFragment>(I);
+      if (State.canSkip(RF)) {
+        ++stats::SkippedRelaxationChecks;
+        break;
+      }
+      RelaxedFrag = relaxInstruction(Layout, RF,
+                                     State.FirstPass ? EarlyRelaxMargin : 0);
+      State.Targets[&RF] = getRelaxationTarget(Layout, RF, Sec);
+      if (RelaxedFrag)
+        Relaxed.set(RF.getLayoutOrder());
       break;
+    }
     case MCFragment::FT_Dwarf:
       RelaxedFrag = relaxDwarfLineAddr(Layout,
                                        *cast<MCDwarfLineAddrFragment>(I));
@@ -1154,6 +1264,8 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
     if (RelaxedFrag && !FirstRelaxedFragment)
       FirstRelaxedFragment = &*I;
   }
+  State.FirstPass = false;
+  State.Relaxed = std::move(Relaxed);
   if (FirstRelaxedFragment) {
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
@@ -1167,7 +1279,8 @@ bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
   bool WasRelaxed = false;
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSection &Sec = *it;
-    while (layoutSectionOnce(Layout, Sec))
+    SectionRelaxState State;
+    while (layoutSectionOnce(Layout, Sec, State))
       WasRelaxed = true;
   }
 
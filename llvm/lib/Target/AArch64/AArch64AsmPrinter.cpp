@@ -186,6 +186,13 @@ void AArch64AsmPrinter::EmitStartOfAsmFile(Module &M) {
   if (!TM.getTargetTriple().isOSBinFormatELF())
     return;
 
+  // The objects of modules with the "jwa.symbol-free" flag must not have a
+  // symbol table, so they do not get mapping symbols. The streamer is reused
+  // when the pass manager is, so the setting is made for every module.
+  if (auto *TS = static_cast<AArch64TargetStreamer *>(
+          OutStreamer->getTargetStreamer()))
+    TS->setEmitMappingSymbols(!M.getModuleFlag("jwa.symbol-free"));
+
   // Assemble feature flags that may require creation of a note section.
   unsigned Flags = ELF::GNU_PROPERTY_AARCH64_FEATURE_1_BTI |
                    ELF::GNU_PROPERTY_AARCH64_FEATURE_1_PAC;
@@ -244,6 +251,14 @@ void AArch64AsmPrinter::EmitStartOfAsmFile(Module &M) {
 void AArch64AsmPrinter::LowerPATCHABLE_FUNCTION_ENTER(const MachineInstr &MI)
 {
   const Function &F = MF->getFunction();
+  if (F.hasFnAttribute("jwa-entry-sled")) {
+    // A JWA entry sled is a NOP that the runtime replaces with a BL to a
+    // trampoline that preserves every register. The BL only clobbers X30,
+    // which is not a JWA argument register and is dead on entry to a JWA
+    // function, since JWA functions never return.
+    emitNops(1);
+    return;
+  }
   if (F.hasFnAttribute("patchable-function-entry")) {
     unsigned Num;
     if (F.getFnAttribute("patchable-function-entry")
@@ -763,11 +778,15 @@ void AArch64AsmPrinter::EmitJumpTableInfo() {
 
   const Function &F = MF->getFunction();
   const TargetLoweringObjectFile &TLOF = getObjFileLowering();
+  // JWA jump tables are kept in the function's section (their entries are
+  // relative to a label in the function and the table is addressed with ADR;
+  // see AArch64TargetLowering::LowerJumpTable).
   bool JTInDiffSection =
-      !STI->isTargetCOFF() ||
-      !TLOF.shouldPutJumpTableInFunctionSection(
-          MJTI->getEntryKind() == MachineJumpTableInfo::EK_LabelDifference32,
-          F);
+      F.getCallingConv() != CallingConv::JWA &&
+      (!STI->isTargetCOFF() ||
+       !TLOF.shouldPutJumpTableInFunctionSection(
+           MJTI->getEntryKind() == MachineJumpTableInfo::EK_LabelDifference32,
+           F));
   if (JTInDiffSection) {
       // Drop it in the readonly section.
       MCSection *ReadOnlySec = TLOF.getSectionForJumpTable(F, TM);
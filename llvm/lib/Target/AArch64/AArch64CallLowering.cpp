@@ -447,6 +447,10 @@ bool AArch64CallLowering::lowerFormalArguments(
 
   AArch64FunctionInfo *FuncInfo = MF.getInfo<AArch64FunctionInfo>();
   uint64_t StackOffset = Handler.StackUsed;
+  // JWA functions are naked and only receive arguments in registers.
+  if (F.getCallingConv() == CallingConv::JWA && StackOffset != 0)
+    return false;
+
   if (F.isVarArg()) {
     auto &Subtarget = MF.getSubtarget<AArch64Subtarget>();
     if (!Subtarget.isTargetDarwin()) {
@@ -496,7 +500,7 @@ bool AArch64CallLowering::lowerFormalArguments(
 
 /// Return true if the calling convention is one that we can guarantee TCO for.
 static bool canGuaranteeTCO(CallingConv::ID CC) {
-  return CC == CallingConv::Fast;
+  return (CC == CallingConv::Fast) || (CC == CallingConv::JWA);
 }
 
 /// Return true if we might ever do TCO for calls with this calling convention.
@@ -734,6 +738,26 @@ bool AArch64CallLowering::isEligibleForTailCallOptimization(
   if (MF.getTarget().Options.GuaranteedTailCallOpt)
     return canGuaranteeTCO(CalleeCC) && CalleeCC == CallerF.getCallingConv();
 
+  // A JWA-to-JWA call is always a tail call: neither function has a frame and
+  // the arguments are only passed in registers, so all that we need to check
+  // is that the outgoing arguments do not need any stack.
+  if (CalleeCC == CallingConv::JWA &&
+      CallerF.getCallingConv() == CallingConv::JWA) {
+    const AArch64TargetLowering &TLI = *getTLI<AArch64TargetLowering>();
+    CCAssignFn *AssignFnFixed;
+    CCAssignFn *AssignFnVarArg;
+    std::tie(AssignFnFixed, AssignFnVarArg) = getAssignFnsForCC(CalleeCC, TLI);
+
+    SmallVector<CCValAssign, 16> OutLocs;
+    CCState OutInfo(CalleeCC, false, MF, OutLocs, CallerF.getContext());
+    if (!analyzeArgInfo(OutInfo, OutArgs, *AssignFnFixed, *AssignFnVarArg) ||
+        OutInfo.getNextStackOffset() != 0) {
+      LLVM_DEBUG(dbgs() << "... JWA call needs stack arguments.\n");
+      return false;
+    }
+    return true;
+  }
+
   // We don't have -tailcallopt, so we're allowed to change the ABI (sibcall).
   // Try to find cases where we can do that.
 
@@ -942,8 +966,11 @@ bool AArch64CallLowering::lowerCall(MachineIRBuilder &MIRBuilder,
   bool CanTailCallOpt =
       isEligibleForTailCallOptimization(MIRBuilder, Info, InArgs, OutArgs);
 
-  // We must emit a tail call if we have musttail.
-  if (Info.IsMustTailCall && !CanTailCallOpt) {
+  // We must emit a tail call if we have musttail or if this is a JWA call in
+  // tail position, since JWA functions do not have a frame to return to.
+  if ((Info.IsMustTailCall ||
+       (Info.IsTailCall && Info.CallConv == CallingConv::JWA)) &&
+      !CanTailCallOpt) {
     // There are types of incoming/outgoing arguments we can't handle yet, so
     // it doesn't make sense to actually die here like in ISelLowering. Instead,
     // fall back to SelectionDAG and let it try to handle this.
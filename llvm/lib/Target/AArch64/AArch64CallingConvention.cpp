@@ -151,6 +151,22 @@ static bool CC_AArch64_Custom_Block(unsigned &ValNo, MVT &ValVT, MVT &LocVT,
   return finishStackBlock(PendingMembers, LocVT, ArgFlags, State, SlotAlign);
 }
 
+/// The registers that are pinned in a JWA function (see the "jwa.pinned"
+/// module flag) are never used for arguments, so the remaining arguments keep
+/// the registers that they would have if the pinned values were passed as
+/// arguments.  This function marks the pinned registers as allocated and then
+/// defers to the register sequence of the convention.
+static bool CC_AArch64_JWA_SkipPinned(unsigned &ValNo, MVT &ValVT, MVT &LocVT,
+                                      CCValAssign::LocInfo &LocInfo,
+                                      ISD::ArgFlagsTy &ArgFlags,
+                                      CCState &State) {
+  const MachineFunction &MF = State.getMachineFunction();
+  const auto &TRI = *MF.getSubtarget<AArch64Subtarget>().getRegisterInfo();
+  for (MCPhysReg Reg : TRI.getJWAPinnedRegs(MF))
+    State.AllocateReg(Reg);
+  return false;
+}
+
 // TableGen provides definitions of the calling convention analysis entry
 // points.
 #include "AArch64GenCallingConv.inc"
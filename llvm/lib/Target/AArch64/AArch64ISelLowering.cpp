@@ -4569,10 +4569,19 @@ SDValue AArch64TargetLowering::LowerGlobalAddress(SDValue Op,
     return getGOT(GN, DAG, OpFlags);
   }
 
+  // The local functions (and the aliases of label expressions) referenced by
+  // JWA code are in the same text section, so an ADR is resolved by the
+  // assembler instead of needing ADRP/ADD page relocations, as long as the
+  // module is small enough.
+  bool IsJWACodeRef =
+      Subtarget->useADRForJWACodeRefs(DAG.getMachineFunction().getFunction()) &&
+      GV->hasLocalLinkage() && !isa<GlobalVariable>(GV);
+
   SDValue Result;
   if (getTargetMachine().getCodeModel() == CodeModel::Large) {
     Result = getAddrLarge(GN, DAG, OpFlags);
-  } else if (getTargetMachine().getCodeModel() == CodeModel::Tiny) {
+  } else if (IsJWACodeRef ||
+             getTargetMachine().getCodeModel() == CodeModel::Tiny) {
     Result = getAddrTiny(GN, DAG, OpFlags);
   } else {
     Result = getAddr(GN, DAG, OpFlags);
@@ -5547,6 +5556,11 @@ SDValue AArch64TargetLowering::LowerJumpTable(SDValue Op,
   // is necessary here. Just get the address of the jump table.
   JumpTableSDNode *JT = cast<JumpTableSDNode>(Op);
 
+  // JWA jump tables are emitted in the function's text section, so an ADR
+  // needs no relocation when the module is small enough.
+  if (Subtarget->useADRForJWACodeRefs(DAG.getMachineFunction().getFunction()))
+    return getAddrTiny(JT, DAG);
+
   if (getTargetMachine().getCodeModel() == CodeModel::Large &&
       !Subtarget->isTargetMachO()) {
     return getAddrLarge(JT, DAG);
@@ -5576,6 +5590,11 @@ SDValue AArch64TargetLowering::LowerConstantPool(SDValue Op,
                                                  SelectionDAG &DAG) const {
   ConstantPoolSDNode *CP = cast<ConstantPoolSDNode>(Op);
 
+  // The constant pool of a JWA function is emitted in its text section (see
+  // TargetLoweringObjectFile::shouldPutConstantPoolInFunctionSection).
+  if (Subtarget->useADRForJWACodeRefs(DAG.getMachineFunction().getFunction()))
+    return getAddrTiny(CP, DAG);
+
   if (getTargetMachine().getCodeModel() == CodeModel::Large) {
     // Use the GOT for the large code model on iOS.
     if (Subtarget->isTargetMachO()) {
@@ -5834,9 +5853,11 @@ Register AArch64TargetLowering::
 getRegisterByName(const char* RegName, LLT VT, const MachineFunction &MF) const {
   Register Reg = MatchRegisterName(RegName);
   if (AArch64::X1 <= Reg && Reg <= AArch64::X28) {
-    const MCRegisterInfo *MRI = Subtarget->getRegisterInfo();
-    unsigned DwarfRegNum = MRI->getDwarfRegNum(Reg, false);
-    if (!Subtarget->isXRegisterReserved(DwarfRegNum))
+    const AArch64RegisterInfo *TRI = Subtarget->getRegisterInfo();
+    unsigned DwarfRegNum = TRI->getDwarfRegNum(Reg, false);
+    // The pinned registers of a JWA function are also reserved.
+    if (!Subtarget->isXRegisterReserved(DwarfRegNum) &&
+        !is_contained(TRI->getJWAPinnedRegs(MF), Reg))
       Reg = 0;
   }
   if (Reg)
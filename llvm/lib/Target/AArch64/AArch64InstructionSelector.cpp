@@ -1796,7 +1796,11 @@ bool AArch64InstructionSelector::select(MachineInstr &I) {
       materializeLargeCMVal(I, GV, OpFlags);
       I.eraseFromParent();
       return true;
-    } else if (TM.getCodeModel() == CodeModel::Tiny) {
+    } else if (TM.getCodeModel() == CodeModel::Tiny ||
+               (STI.useADRForJWACodeRefs(MF.getFunction()) &&
+                GV->hasLocalLinkage() && !isa<GlobalVariable>(GV))) {
+      // JWA code in small modules references local functions in its own text
+      // section with an ADR, which is resolved by the assembler.
       I.setDesc(TII.get(AArch64::ADR));
       I.getOperand(1).setTargetFlags(OpFlags);
     } else {
@@ -2452,8 +2456,18 @@ bool AArch64InstructionSelector::selectJumpTable(
 
   Register DstReg = I.getOperand(0).getReg();
   unsigned JTI = I.getOperand(1).getIndex();
-  // We generate a MOVaddrJT which will get expanded to an ADRP + ADD later.
   MachineIRBuilder MIB(I);
+
+  // JWA jump tables are in the function's text section, so they are in ADR
+  // range when the module is small enough.
+  if (STI.useADRForJWACodeRefs(MIB.getMF().getFunction())) {
+    auto AdrMI = MIB.buildInstr(AArch64::ADR, {DstReg}, {})
+                     .addJumpTableIndex(JTI);
+    I.eraseFromParent();
+    return constrainSelectedInstRegOperands(*AdrMI, TII, TRI, RBI);
+  }
+
+  // We generate a MOVaddrJT which will get expanded to an ADRP + ADD later.
   auto MovMI =
     MIB.buildInstr(AArch64::MOVaddrJT, {DstReg}, {})
           .addJumpTableIndex(JTI, AArch64II::MO_PAGE)
@@ -3173,24 +3187,32 @@ MachineInstr *AArch64InstructionSelector::emitLoadFromConstantPool(
     Constant *CPVal, MachineIRBuilder &MIRBuilder) const {
   unsigned CPIdx = emitConstantPoolEntry(CPVal, MIRBuilder.getMF());
 
+  // The constant pool of a JWA function is in its text section, so in small
+  // modules the address is computed by an ADR and the load has a zero offset.
+  bool InTextSection =
+      STI.useADRForJWACodeRefs(MIRBuilder.getMF().getFunction());
   auto Adrp =
-      MIRBuilder.buildInstr(AArch64::ADRP, {&AArch64::GPR64RegClass}, {})
-          .addConstantPoolIndex(CPIdx, 0, AArch64II::MO_PAGE);
+      InTextSection
+          ? MIRBuilder.buildInstr(AArch64::ADR, {&AArch64::GPR64RegClass}, {})
+                .addConstantPoolIndex(CPIdx)
+          : MIRBuilder.buildInstr(AArch64::ADRP, {&AArch64::GPR64RegClass}, {})
+                .addConstantPoolIndex(CPIdx, 0, AArch64II::MO_PAGE);
+  auto addOffset = [&](MachineInstrBuilder MIB) -> MachineInstrBuilder {
+    if (InTextSection)
+      return MIB.addImm(0);
+    return MIB.addConstantPoolIndex(CPIdx, 0,
+                                    AArch64II::MO_PAGEOFF | AArch64II::MO_NC);
+  };
 
   MachineInstr *LoadMI = nullptr;
   switch (MIRBuilder.getDataLayout().getTypeStoreSize(CPVal->getType())) {
   case 16:
-    LoadMI =
-        &*MIRBuilder
-              .buildInstr(AArch64::LDRQui, {&AArch64::FPR128RegClass}, {Adrp})
-              .addConstantPoolIndex(CPIdx, 0,
-                                    AArch64II::MO_PAGEOFF | AArch64II::MO_NC);
+    LoadMI = &*addOffset(MIRBuilder.buildInstr(
+        AArch64::LDRQui, {&AArch64::FPR128RegClass}, {Adrp}));
     break;
   case 8:
-    LoadMI = &*MIRBuilder
-                 .buildInstr(AArch64::LDRDui, {&AArch64::FPR64RegClass}, {Adrp})
-                 .addConstantPoolIndex(
-                     CPIdx, 0, AArch64II::MO_PAGEOFF | AArch64II::MO_NC);
+    LoadMI = &*addOffset(MIRBuilder.buildInstr(
+        AArch64::LDRDui, {&AArch64::FPR64RegClass}, {Adrp}));
     break;
   default:
     LLVM_DEBUG(dbgs() << "Could not load from constant pool of type "
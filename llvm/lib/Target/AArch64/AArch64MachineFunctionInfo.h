@@ -13,6 +13,7 @@
 #ifndef LLVM_LIB_TARGET_AARCH64_AARCH64MACHINEFUNCTIONINFO_H
 #define LLVM_LIB_TARGET_AARCH64_AARCH64MACHINEFUNCTIONINFO_H
 
+#include "AArch64RegisterInfo.h"
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallPtrSet.h"
@@ -20,6 +21,7 @@
 #include "llvm/CodeGen/CallingConvLower.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/TargetFrameLowering.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/MC/MCLinkerOptimizationHint.h"
 #include <cassert>
@@ -126,6 +128,10 @@ class AArch64FunctionInfo final : public MachineFunctionInfo {
   // stack slot.
   unsigned TaggedBasePointerOffset = 0;
 
+  /// The registers that are pinned in a JWA function, which are given by the
+  /// module's "jwa.pinned" flag (see AArch64RegisterInfo::getJWAPinnedRegs).
+  SmallVector<MCPhysReg, 8> JWAPinnedRegs;
+
 public:
   AArch64FunctionInfo() = default;
 
@@ -136,6 +142,10 @@ public:
     // HasRedZone here.
     if (MF.getFunction().hasFnAttribute(Attribute::NoRedZone))
       HasRedZone = false;
+
+    static_cast<const AArch64RegisterInfo *>(
+        MF.getSubtarget().getRegisterInfo())
+        ->parseJWAPinnedRegs(MF.getFunction(), JWAPinnedRegs);
   }
 
   unsigned getBytesInStackArgArea() const { return BytesInStackArgArea; }
@@ -325,6 +335,8 @@ public:
     TaggedBasePointerOffset = Offset;
   }
 
+  ArrayRef<MCPhysReg> getJWAPinnedRegs() const { return JWAPinnedRegs; }
+
 private:
   // Hold the lists of LOHs.
   MILOHContainer LOHContainerSet;
@@ -27,6 +27,7 @@
 #include "llvm/CodeGen/TargetFrameLowering.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetOptions.h"
 
@@ -221,10 +222,46 @@ AArch64RegisterInfo::getReservedRegs(const MachineFunction &MF) const {
   if (MF.getFunction().hasFnAttribute(Attribute::SpeculativeLoadHardening))
     markSuperRegs(Reserved, AArch64::W16);
 
+  // Reserve the pinned registers of JWA functions.
+  for (MCPhysReg Reg : getJWAPinnedRegs(MF))
+    markSuperRegs(Reserved, getSubReg(Reg, AArch64::sub_32));
+
   assert(checkAllSuperRegsMarked(Reserved));
   return Reserved;
 }
 
+ArrayRef<MCPhysReg>
+AArch64RegisterInfo::getJWAPinnedRegs(const MachineFunction &MF) const {
+  return MF.getInfo<AArch64FunctionInfo>()->getJWAPinnedRegs();
+}
+
+void AArch64RegisterInfo::parseJWAPinnedRegs(
+    const Function &F, SmallVectorImpl<MCPhysReg> &Regs) const {
+  if (F.getCallingConv() != CallingConv::JWA)
+    return;
+  auto *MD = dyn_cast_or_null<MDNode>(
+      F.getParent()->getModuleFlag("jwa.pinned"));
+  if (!MD)
+    return;
+
+  for (const MDOperand &Op : MD->operands()) {
+    auto *Name = dyn_cast_or_null<MDString>(Op.get());
+    if (!Name)
+      report_fatal_error("jwa.pinned: expected a register name");
+    // only X19-X28, which are preserved by the standard convention, can be
+    // pinned
+    const MCPhysReg *It =
+        llvm::find_if(AArch64::GPR64RegClass, [&](MCPhysReg R) {
+          return Name->getString().equals_lower(getName(R));
+        });
+    if (It == AArch64::GPR64RegClass.end() || *It < AArch64::X19 ||
+        *It > AArch64::X28)
+      report_fatal_error("jwa.pinned: '" + Name->getString() +
+                         "' cannot be pinned");
+    Regs.push_back(*It);
+  }
+}
+
 bool AArch64RegisterInfo::isReservedReg(const MachineFunction &MF,
                                       unsigned Reg) const {
   return getReservedRegs(MF)[Reg];
@@ -82,6 +82,18 @@ public:
   const uint32_t *getWindowsStackProbePreservedMask() const;
 
   BitVector getReservedRegs(const MachineFunction &MF) const override;
+
+  /// Get the registers that are pinned in the JWA function \p MF, which are
+  /// given by the module's "jwa.pinned" flag.  The pinned registers hold the
+  /// CMachine registers of SML/NJ; they are reserved and are accessed with
+  /// the llvm.read_register and llvm.write_register intrinsics.  The list is
+  /// computed once per function (see AArch64FunctionInfo).
+  ArrayRef<MCPhysReg> getJWAPinnedRegs(const MachineFunction &MF) const;
+
+  /// Parse the "jwa.pinned" module flag for the function \p F into \p Regs,
+  /// which is left empty when \p F is not a JWA function.
+  void parseJWAPinnedRegs(const Function &F,
+                          SmallVectorImpl<MCPhysReg> &Regs) const;
   bool isAsmClobberable(const MachineFunction &MF,
                        unsigned PhysReg) const override;
   bool isConstantPhysReg(unsigned PhysReg) const override;
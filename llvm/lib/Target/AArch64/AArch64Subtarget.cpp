@@ -23,6 +23,7 @@
 #include "llvm/CodeGen/GlobalISel/InstructionSelect.h"
 #include "llvm/CodeGen/MachineScheduler.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/TargetParser.h"
 
 using namespace llvm;
@@ -273,6 +274,13 @@ unsigned AArch64Subtarget::classifyGlobalFunctionReference(
   return AArch64II::MO_NO_FLAG;
 }
 
+bool AArch64Subtarget::useADRForJWACodeRefs(const Function &F) const {
+  if (F.getCallingConv() != CallingConv::JWA)
+    return false;
+  Optional<CodeModel::Model> CM = F.getParent()->getCodeModel();
+  return CM && *CM == CodeModel::Tiny;
+}
+
 void AArch64Subtarget::overrideSchedPolicy(MachineSchedPolicy &Policy,
                                            unsigned NumRegionInstrs) const {
   // LNT run (at least on Cyclone) showed reasonably significant gains for
@@ -475,6 +475,15 @@ public:
   unsigned classifyGlobalFunctionReference(const GlobalValue *GV,
                                            const TargetMachine &TM) const;
 
+  /// Return true if the JWA function \p F addresses its jump tables and
+  /// constant pool, and the local functions of its module, with a single ADR.
+  /// These are all in the text section, so the ADR is resolved by the
+  /// assembler, but ADR only has a range of +/-1MB. Hence this is only done
+  /// when the module's code model is tiny (see Module::setCodeModel), which
+  /// says that the module's code fits in that range; otherwise, we use
+  /// ADRP/ADD like other code.
+  bool useADRForJWACodeRefs(const Function &F) const;
+
   void overrideSchedPolicy(MachineSchedPolicy &Policy,
                            unsigned NumRegionInstrs) const override;
 
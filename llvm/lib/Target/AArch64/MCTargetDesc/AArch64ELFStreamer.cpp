@@ -79,7 +79,8 @@ public:
                      std::unique_ptr<MCCodeEmitter> Emitter)
       : MCELFStreamer(Context, std::move(TAB), std::move(OW),
                       std::move(Emitter)),
-        MappingSymbolCounter(0), LastEMS(EMS_None) {}
+        MappingSymbolCounter(0), LastEMS(EMS_None),
+        MappingSymbolsEnabled(true) {}
 
   void ChangeSection(MCSection *Section, const MCExpr *Subsection) override {
     // We have to keep track of the mapping symbol state of any sections we
@@ -91,6 +92,10 @@ public:
     MCELFStreamer::ChangeSection(Section, Subsection);
   }
 
+  /// Mapping symbols are only needed by tools such as disassemblers, so
+  /// objects that must not have a symbol table can omit them.
+  void setEmitMappingSymbols(bool Enable) { MappingSymbolsEnabled = Enable; }
+
   // Reset state between object emissions
   void reset() override {
     MappingSymbolCounter = 0;
@@ -168,6 +173,8 @@ private:
   }
 
   void EmitMappingSymbol(StringRef Name) {
+    if (!MappingSymbolsEnabled)
+      return;
     auto *Symbol = cast<MCSymbolELF>(getContext().getOrCreateSymbol(
         Name + "." + Twine(MappingSymbolCounter++)));
     EmitLabel(Symbol);
@@ -180,6 +187,7 @@ private:
 
   DenseMap<const MCSection *, ElfMappingSymbol> LastMappingSymbols;
   ElfMappingSymbol LastEMS;
+  bool MappingSymbolsEnabled;
 };
 
 } // end anonymous namespace
@@ -194,6 +202,10 @@ void AArch64TargetELFStreamer::emitInst(uint32_t Inst) {
   getStreamer().emitInst(Inst);
 }
 
+void AArch64TargetELFStreamer::setEmitMappingSymbols(bool Enable) {
+  getStreamer().setEmitMappingSymbols(Enable);
+}
+
 MCTargetStreamer *createAArch64AsmTargetStreamer(MCStreamer &S,
                                                  formatted_raw_ostream &OS,
                                                  MCInstPrinter *InstPrint,
@@ -291,6 +291,14 @@ bool TargetLoweringObjectFile::shouldPutJumpTableInFunctionSection(
   return F.isWeakForLinker();
 }
 
+bool TargetLoweringObjectFile::shouldPutConstantPoolInFunctionSection(
+    const Function &F) const {
+  // JWA code is loaded from the text section alone, so its constants are
+  // kept with the code, where the PC-relative references to them are
+  // resolved by the assembler.
+  return F.getCallingConv() == CallingConv::JWA;
+}
+
 /// Given a mergable constant with the specified size and relocation
 /// information, return a section that it should be placed in.
 MCSection *TargetLoweringObjectFile::getSectionForConstant(
@@ -12,10 +12,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "X86CallingConv.h"
+#include "X86MachineFunctionInfo.h"
 #include "X86Subtarget.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/CodeGen/CallingConvLower.h"
 #include "llvm/IR/CallingConv.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
 
 using namespace llvm;
 
@@ -330,5 +333,72 @@ static bool CC_X86_Intr(unsigned &ValNo, MVT &ValVT, MVT &LocVT,
   return true;
 }
 
+/// The default JWA sequence of integer registers, which must agree with the
+/// i64 register list in CC_X86_64_JWA.
+static const MCPhysReg JWADefaultGPRs[] = {
+    X86::RDI, X86::R14, X86::R15, X86::R8,  X86::R9,  X86::RSI, X86::RBX,
+    X86::RCX, X86::RDX, X86::RBP, X86::R10, X86::R11, X86::R12, X86::R13};
+
+/// Parse and validate a "jwa.regs" module flag, which is a tuple of register
+/// names (e.g., !{!"rdi", !"r14", ...}).  The registers must be distinct
+/// members of the default sequence; they may be given in a different order and
+/// there may be fewer of them, in which case the remaining arguments are
+/// assigned from the default sequence.
+static void parseJWARegs(const MDNode *MD, const TargetRegisterInfo *TRI,
+                         SmallVectorImpl<MCPhysReg> &Regs) {
+  for (const MDOperand &Op : MD->operands()) {
+    auto *Name = dyn_cast_or_null<MDString>(Op.get());
+    if (!Name)
+      report_fatal_error("jwa.regs: expected a register name");
+    const MCPhysReg *It = llvm::find_if(JWADefaultGPRs, [&](MCPhysReg R) {
+      return Name->getString().equals_lower(TRI->getName(R));
+    });
+    if (It == std::end(JWADefaultGPRs))
+      report_fatal_error("jwa.regs: '" + Name->getString() +
+                         "' is not a JWA argument register");
+    if (is_contained(Regs, *It))
+      report_fatal_error("jwa.regs: duplicate register '" +
+                         Name->getString() + "'");
+    Regs.push_back(*It);
+  }
+}
+
+/// Assign an i64 JWA argument according to the module's "jwa.regs" flag.
+/// Returns false (i.e., defers to the default sequence) when the module does
+/// not have the flag or when the registers in the flag are used up.  The
+/// registers that are pinned in the function (see the "jwa.pinned" flag) are
+/// never used for arguments, so the remaining arguments keep the registers
+/// that they would have if the pinned values were passed as arguments.  The
+/// flag is parsed for the first argument that is assigned in a function and
+/// kept in its X86MachineFunctionInfo.
+static bool CC_X86_64_JWA_AssignReg(unsigned &ValNo, MVT &ValVT, MVT &LocVT,
+                                    CCValAssign::LocInfo &LocInfo,
+                                    ISD::ArgFlagsTy &ArgFlags,
+                                    CCState &State) {
+  MachineFunction &MF = State.getMachineFunction();
+  const auto &TRI = *MF.getSubtarget<X86Subtarget>().getRegisterInfo();
+  for (MCPhysReg Reg : TRI.getJWAPinnedRegs(MF))
+    State.AllocateReg(Reg);
+
+  auto *FuncInfo = MF.getInfo<X86MachineFunctionInfo>();
+  if (!FuncInfo->hasJWAArgRegs()) {
+    SmallVector<MCPhysReg, 16> Regs;
+    if (auto *MD = dyn_cast_or_null<MDNode>(
+            MF.getFunction().getParent()->getModuleFlag("jwa.regs")))
+      parseJWARegs(MD, &TRI, Regs);
+    FuncInfo->setJWAArgRegs(Regs);
+  }
+
+  ArrayRef<MCPhysReg> Regs = FuncInfo->getJWAArgRegs();
+  if (Regs.empty())
+    return false;
+
+  if (unsigned Reg = State.AllocateReg(Regs)) {
+    State.addLoc(CCValAssign::getReg(ValNo, ValVT, Reg, LocVT, LocInfo));
+    return true;
+  }
+  return false;
+}
+
 // Provides entry points of CC_X86 and RetCC_X86.
 #include "X86GenCallingConv.inc"
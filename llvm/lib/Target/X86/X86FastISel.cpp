@@ -21,6 +21,7 @@
 #include "X86Subtarget.h"
 #include "X86TargetMachine.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/CodeGen/Analysis.h"
 #include "llvm/CodeGen/FastISel.h"
 #include "llvm/CodeGen/FunctionLoweringInfo.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
@@ -100,6 +101,9 @@ private:
   bool X86SelectAddress(const Value *V, X86AddressMode &AM);
   bool X86SelectCallAddress(const Value *V, X86AddressMode &AM);
 
+  bool X86FastLowerJWATailCall(CallLoweringInfo &CLI, const GlobalValue *GV,
+                               unsigned CalleeOp);
+
   bool X86SelectLoad(const Instruction *I);
 
   bool X86SelectStore(const Instruction *I);
@@ -1141,6 +1145,25 @@ bool X86FastISel::X86SelectStore(const Instruction *I) {
   return X86FastEmitStore(VT, Val, AM, createMachineMemOperandFor(I), Aligned);
 }
 
+/// Return true if \p Ret is the return that follows a JWA tail call.  JWA
+/// functions never return normally, so such a return is subsumed by the
+/// TCRETURN that fastLowerCall emits for the call and generates no code.
+static bool isJWATailCallReturn(const ReturnInst *Ret,
+                                const TargetMachine &TM) {
+  if (Ret->getNumOperands() != 0)
+    return false;
+
+  // Mirror the target-independent checks made by FastISel::lowerCall.
+  const auto *CI =
+      dyn_cast_or_null<CallInst>(Ret->getPrevNonDebugInstruction());
+  if (!CI || !CI->isTailCall() || CI->getCallingConv() != CallingConv::JWA)
+    return false;
+  const Function &F = *Ret->getFunction();
+  if (F.getFnAttribute("disable-tail-calls").getValueAsString() == "true")
+    return false;
+  return isInTailCallPosition(ImmutableCallSite(CI), TM);
+}
+
 /// X86SelectRet - Select and emit code to implement ret instructions.
 bool X86FastISel::X86SelectRet(const Instruction *I) {
   const ReturnInst *Ret = cast<ReturnInst>(I);
@@ -1159,6 +1182,9 @@ bool X86FastISel::X86SelectRet(const Instruction *I) {
     return false;
 
   CallingConv::ID CC = F.getCallingConv();
+  if (CC == CallingConv::JWA)
+    return Subtarget->is64Bit() && isJWATailCallReturn(Ret, TM);
+
   if (CC != CallingConv::C &&
       CC != CallingConv::Fast &&
       CC != CallingConv::Tail &&
@@ -3152,6 +3178,52 @@ bool X86FastISel::fastLowerArguments() {
   return true;
 }
 
+/// Emit the TCRETURN for a JWA tail call whose arguments have already been
+/// copied to their registers.  The stack adjustment is always zero, since
+/// neither the caller nor the callee has a frame.
+bool X86FastISel::X86FastLowerJWATailCall(CallLoweringInfo &CLI,
+                                          const GlobalValue *GV,
+                                          unsigned CalleeOp) {
+  MachineInstrBuilder MIB;
+  if (CalleeOp) {
+    // Register-indirect tail call; the target must be in a register that is
+    // not callee-saved, which is what ptr_rc_tailcall describes.
+    const MCInstrDesc &II = TII.get(X86::TCRETURNri64);
+    CalleeOp = constrainOperandRegClass(II, CalleeOp, 0);
+    MIB = BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, II)
+      .addReg(CalleeOp);
+  } else {
+    // Direct tail call; calls through the GOT or a dllimport stub are left to
+    // SelectionDAG isel.
+    assert(GV && "Not a direct call");
+    unsigned char OpFlags = Subtarget->classifyGlobalFunctionReference(GV);
+    if (OpFlags == X86II::MO_DLLIMPORT || OpFlags == X86II::MO_GOTPCREL ||
+        OpFlags == X86II::MO_COFFSTUB)
+      return false;
+    MIB = BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc,
+                  TII.get(X86::TCRETURNdi64));
+    if (CLI.Symbol)
+      MIB.addSym(CLI.Symbol, OpFlags);
+    else
+      MIB.addGlobalAddress(GV, 0, OpFlags);
+  }
+  MIB.addImm(0);
+
+  // Add a register mask operand representing the call-preserved registers.
+  MIB.addRegMask(TRI.getCallPreservedMask(*FuncInfo.MF, CLI.CallConv));
+
+  // Add implicit physical register uses to the call.
+  for (auto Reg : CLI.OutRegs)
+    MIB.addReg(Reg, RegState::Implicit);
+
+  // The tail call does not return, so there are no results.
+  CLI.ResultReg = 0;
+  CLI.NumResultRegs = 0;
+  CLI.Call = MIB;
+
+  return true;
+}
+
 static unsigned computeBytesPoppedByCalleeForSRet(const X86Subtarget *Subtarget,
                                                   CallingConv::ID CC,
                                                   ImmutableCallSite *CS) {
@@ -3221,11 +3293,17 @@ bool X86FastISel::fastLowerCall(CallLoweringInfo &CLI) {
   case CallingConv::Win64:
   case CallingConv::X86_64_SysV:
   case CallingConv::CFGuard_Check:
+  case CallingConv::JWA:
     break;
   }
 
-  // Allow SelectionDAG isel to handle tail calls.
-  if (IsTailCall)
+  // A tail call from one JWA function to another is a jump with the arguments
+  // in registers: JWA never passes arguments on the stack and JWA functions
+  // are naked, so there is no frame to tear down.  Allow SelectionDAG isel to
+  // handle all other tail calls.
+  bool IsJWATailCall = IsTailCall && Is64Bit && CC == CallingConv::JWA &&
+      FuncInfo.Fn->getCallingConv() == CallingConv::JWA;
+  if (IsTailCall && !IsJWATailCall)
     return false;
 
   // fastcc with -tailcallopt is intended to provide a guaranteed
@@ -3310,10 +3388,17 @@ bool X86FastISel::fastLowerCall(CallLoweringInfo &CLI) {
   // Get a count of how many bytes are to be pushed on the stack.
   unsigned NumBytes = CCInfo.getAlignedCallFrameSize();
 
-  // Issue CALLSEQ_START
-  unsigned AdjStackDown = TII.getCallFrameSetupOpcode();
-  BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, TII.get(AdjStackDown))
-    .addImm(NumBytes).addImm(0).addImm(0);
+  // A JWA tail call has no call sequence, so it must not need any stack
+  // space for its arguments.
+  if (IsJWATailCall) {
+    if (NumBytes != 0)
+      return false;
+  } else {
+    // Issue CALLSEQ_START
+    unsigned AdjStackDown = TII.getCallFrameSetupOpcode();
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DbgLoc, TII.get(AdjStackDown))
+      .addImm(NumBytes).addImm(0).addImm(0);
+  }
 
   // Walk the register/memloc assignments, inserting copies/loads.
   const X86RegisterInfo *RegInfo = Subtarget->getRegisterInfo();
@@ -3485,6 +3570,9 @@ bool X86FastISel::fastLowerCall(CallLoweringInfo &CLI) {
   } else
     return false;
 
+  if (IsJWATailCall)
+    return X86FastLowerJWATailCall(CLI, GV, CalleeOp);
+
   // Issue the call.
   MachineInstrBuilder MIB;
   if (CalleeOp) {
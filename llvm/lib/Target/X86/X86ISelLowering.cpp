@@ -25139,6 +25139,13 @@ Register X86TargetLowering::getRegisterByName(const char* RegName, LLT VT,
   if (Reg)
     return Reg;
 
+  // The pinned registers of a JWA function are reserved, so they can be
+  // accessed by name.
+  for (MCPhysReg R : Subtarget.getRegisterInfo()->getJWAPinnedRegs(MF))
+    if (StringRef(RegName).equals_lower(
+            Subtarget.getRegisterInfo()->getName(R)))
+      return R;
+
   report_fatal_error("Invalid register name global variable");
 }
 
@@ -8054,9 +8054,30 @@ llvm::createCleanupLocalDynamicTLSPass() { return new LDTLSCleanup(); }
 /// * Call construction overhead: 1 (jump instruction)
 /// * Frame construction overhead: 0 (don't need to return)
 ///
+/// \p MachineOutlinerThunk implies that the outlined sequence ends in a call
+/// (this variant is only used for JWA functions).  The outlined function is
+/// called and it tail-calls the original destination, which then returns to
+/// the instruction after the outlined call.  That is,
+///
+/// I1                                 OUTLINED_FUNCTION:
+/// I2 --> call OUTLINED_FUNCTION       I1
+/// call f                              I2
+///                                     jmp f
+///
+/// * Call construction overhead: 1 (call instruction)
+/// * Frame construction overhead: 0 (the call becomes a jump)
+///
+/// JWA functions are naked: they have no frame of their own and they never
+/// keep live data below the stack pointer (the SML frame is above it), so
+/// the return address pushed by the outlined call is harmless.  Outlined
+/// sequences never touch RSP (see getOutliningType), and none of the variants
+/// use any registers beyond those of the original sequence, so all of the
+/// JWA argument registers are preserved.
+///
 enum MachineOutlinerClass {
   MachineOutlinerDefault,
-  MachineOutlinerTailCall
+  MachineOutlinerTailCall,
+  MachineOutlinerThunk
 };
 
 outliner::OutlinedFunction X86InstrInfo::getOutliningCandidateInfo(
@@ -8084,6 +8105,15 @@ outliner::OutlinedFunction X86InstrInfo::getOutliningCandidateInfo(
     );
   }
 
+  // A sequence can only end in a call in a JWA function (see getOutliningType).
+  if (RepeatedSequenceLocs[0].back()->isCall()) {
+    for (outliner::Candidate &C : RepeatedSequenceLocs)
+      C.setCallInfo(MachineOutlinerThunk, 1);
+
+    return outliner::OutlinedFunction(RepeatedSequenceLocs, SequenceSize, 0,
+                                      MachineOutlinerThunk);
+  }
+
   for (outliner::Candidate &C : RepeatedSequenceLocs)
     C.setCallInfo(MachineOutlinerDefault, 1);
 
@@ -8113,6 +8143,11 @@ bool X86InstrInfo::isFunctionSafeToOutlineFrom(MachineFunction &MF,
   return true;
 }
 
+bool X86InstrInfo::shouldOutlineFromFunctionByDefault(
+    MachineFunction &MF) const {
+  return MF.getFunction().hasMinSize();
+}
+
 outliner::InstrType
 X86InstrInfo::getOutliningType(MachineBasicBlock::iterator &MIT,  unsigned Flags) const {
   MachineInstr &MI = *MIT;
@@ -8125,10 +8160,31 @@ X86InstrInfo::getOutliningType(MachineBasicBlock::iterator &MIT,  unsigned Flags
   if (MI.isKill())
     return outliner::InstrType::Invisible;
 
+  // Entry sleds must stay at the entry of their function.
+  if (MI.getOpcode() == TargetOpcode::PATCHABLE_FUNCTION_ENTER)
+    return outliner::InstrType::Illegal;
+
   // Is this a tail call? If yes, we can outline as a tail call.
   if (isTailCall(MI))
     return outliner::InstrType::Legal;
 
+  // In a JWA function, a direct or register-indirect call can end an outlined
+  // sequence, since the outlined function can tail call the destination (see
+  // MachineOutlinerThunk).
+  if (MI.isCall() && MI.getMF()->getFunction().getCallingConv() ==
+                         CallingConv::JWA) {
+    switch (MI.getOpcode()) {
+    case X86::CALL64pcrel32:
+      return outliner::InstrType::LegalTerminator;
+    case X86::CALL64r:
+      if (MI.getOperand(0).getReg() != X86::RSP)
+        return outliner::InstrType::LegalTerminator;
+      return outliner::InstrType::Illegal;
+    default:
+      return outliner::InstrType::Illegal;
+    }
+  }
+
   // Is this the terminator of a basic block?
   if (MI.isTerminator() || MI.isReturn()) {
 
@@ -8181,6 +8237,28 @@ void X86InstrInfo::buildOutlinedFrame(MachineBasicBlock &MBB,
   if (OF.FrameConstructionID == MachineOutlinerTailCall)
     return;
 
+  // If we're a thunk, then replace the call at the end of the sequence with a
+  // tail call.
+  if (OF.FrameConstructionID == MachineOutlinerThunk) {
+    MachineInstr *Call = &*--MBB.instr_end();
+    unsigned TailOpc;
+    switch (Call->getOpcode()) {
+    case X86::CALL64pcrel32:
+      TailOpc = X86::TAILJMPd64;
+      break;
+    case X86::CALL64r:
+      TailOpc = X86::TAILJMPr64;
+      break;
+    default:
+      llvm_unreachable("unexpected call in outlined thunk");
+    }
+    MachineInstr *TC = BuildMI(MF, DebugLoc(), get(TailOpc))
+                           .add(Call->getOperand(0));
+    MBB.insert(MBB.end(), TC);
+    Call->eraseFromParent();
+    return;
+  }
+
   // We're a normal call, so our sequence doesn't have a return instruction.
   // Add it in.
   MachineInstr *retq = BuildMI(MF, DebugLoc(), get(X86::RETQ));
@@ -1617,6 +1617,18 @@ void X86AsmPrinter::LowerPATCHABLE_FUNCTION_ENTER(const MachineInstr &MI,
   NoAutoPaddingScope NoPadScope(*OutStreamer);
 
   const Function &F = MF->getFunction();
+  if (F.hasFnAttribute("jwa-entry-sled")) {
+    // A JWA entry sled is a single 5-byte NOP that the runtime replaces with
+    //
+    //   call <relative offset, 32-bits>
+    //
+    // to a trampoline. Unlike the XRay sled, it cannot load a function id into
+    // a scratch register, since JWA functions use nearly every GPR for their
+    // arguments. The trampoline identifies the function by the return address
+    // and must preserve every register.
+    EmitNops(*OutStreamer, 5, Subtarget->is64Bit(), getSubtargetInfo());
+    return;
+  }
   if (F.hasFnAttribute("patchable-function-entry")) {
     unsigned Num;
     if (F.getFnAttribute("patchable-function-entry")
@@ -8,6 +8,7 @@
 
 #include "X86MachineFunctionInfo.h"
 #include "X86RegisterInfo.h"
+#include "X86Subtarget.h"
 #include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 
@@ -15,6 +16,11 @@ using namespace llvm;
 
 void X86MachineFunctionInfo::anchor() { }
 
+X86MachineFunctionInfo::X86MachineFunctionInfo(MachineFunction &MF) {
+  MF.getSubtarget<X86Subtarget>().getRegisterInfo()->parseJWAPinnedRegs(
+      MF.getFunction(), JWAPinnedRegs);
+}
+
 void X86MachineFunctionInfo::setRestoreBasePointer(const MachineFunction *MF) {
   if (!RestoreBasePointerOffset) {
     const X86RegisterInfo *RegInfo = static_cast<const X86RegisterInfo *>(
@@ -13,6 +13,7 @@
 #ifndef LLVM_LIB_TARGET_X86_X86MACHINEFUNCTIONINFO_H
 #define LLVM_LIB_TARGET_X86_X86MACHINEFUNCTIONINFO_H
 
+#include "llvm/ADT/Optional.h"
 #include "llvm/CodeGen/CallingConvLower.h"
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/Support/MachineValueType.h"
@@ -109,10 +110,18 @@ private:
   /// that must be forwarded to every musttail call.
   SmallVector<ForwardedRegister, 1> ForwardedMustTailRegParms;
 
+  /// The registers that are pinned in a JWA function, which are given by the
+  /// module's "jwa.pinned" flag (see X86RegisterInfo::getJWAPinnedRegs).
+  SmallVector<MCPhysReg, 4> JWAPinnedRegs;
+
+  /// The JWA argument registers that are given by the module's "jwa.regs"
+  /// flag (empty for the default sequence), which are parsed on demand.
+  Optional<SmallVector<MCPhysReg, 16>> JWAArgRegs;
+
 public:
   X86MachineFunctionInfo() = default;
 
-  explicit X86MachineFunctionInfo(MachineFunction &MF) {}
+  explicit X86MachineFunctionInfo(MachineFunction &MF);
 
   bool getForceFramePointer() const { return ForceFramePointer;}
   void setForceFramePointer(bool forceFP) { ForceFramePointer = forceFP; }
@@ -185,6 +194,14 @@ public:
 
   bool hasWinAlloca() const { return HasWinAlloca; }
   void setHasWinAlloca(bool v) { HasWinAlloca = v; }
+
+  ArrayRef<MCPhysReg> getJWAPinnedRegs() const { return JWAPinnedRegs; }
+
+  bool hasJWAArgRegs() const { return JWAArgRegs.hasValue(); }
+  ArrayRef<MCPhysReg> getJWAArgRegs() const { return *JWAArgRegs; }
+  void setJWAArgRegs(ArrayRef<MCPhysReg> Regs) {
+    JWAArgRegs.emplace(Regs.begin(), Regs.end());
+  }
 };
 
 } // End llvm namespace
@@ -26,6 +26,7 @@
 #include "llvm/CodeGen/TargetInstrInfo.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -604,12 +605,46 @@ BitVector X86RegisterInfo::getReservedRegs(const MachineFunction &MF) const {
     }
   }
 
+  // Reserve the pinned registers of JWA functions.
+  for (MCPhysReg Reg : getJWAPinnedRegs(MF))
+    for (MCRegAliasIterator AI(Reg, this, true); AI.isValid(); ++AI)
+      Reserved.set(*AI);
+
   assert(checkAllSuperRegsMarked(Reserved,
                                  {X86::SIL, X86::DIL, X86::BPL, X86::SPL,
                                   X86::SIH, X86::DIH, X86::BPH, X86::SPH}));
   return Reserved;
 }
 
+ArrayRef<MCPhysReg>
+X86RegisterInfo::getJWAPinnedRegs(const MachineFunction &MF) const {
+  return MF.getInfo<X86MachineFunctionInfo>()->getJWAPinnedRegs();
+}
+
+void X86RegisterInfo::parseJWAPinnedRegs(
+    const Function &F, SmallVectorImpl<MCPhysReg> &Regs) const {
+  if (F.getCallingConv() != CallingConv::JWA)
+    return;
+  auto *MD = dyn_cast_or_null<MDNode>(
+      F.getParent()->getModuleFlag("jwa.pinned"));
+  if (!MD)
+    return;
+
+  for (const MDOperand &Op : MD->operands()) {
+    auto *Name = dyn_cast_or_null<MDString>(Op.get());
+    if (!Name)
+      report_fatal_error("jwa.pinned: expected a register name");
+    const MCPhysReg *It =
+        llvm::find_if(X86::GR64RegClass, [&](MCPhysReg R) {
+          return Name->getString().equals_lower(getName(R));
+        });
+    if (It == X86::GR64RegClass.end() || *It == X86::RSP || *It == X86::RIP)
+      report_fatal_error("jwa.pinned: '" + Name->getString() +
+                         "' cannot be pinned");
+    Regs.push_back(*It);
+  }
+}
+
 void X86RegisterInfo::adjustStackMapLiveOutMask(uint32_t *Mask) const {
   // Check if the EFLAGS register is marked as live-out. This shouldn't happen,
   // because the calling convention defines the EFLAGS register as NOT
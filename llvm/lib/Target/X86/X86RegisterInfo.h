@@ -119,6 +119,18 @@ public:
   /// register scavenger to determine what registers are free.
   BitVector getReservedRegs(const MachineFunction &MF) const override;
 
+  /// Get the registers that are pinned in the JWA function \p MF, which are
+  /// given by the module's "jwa.pinned" flag.  The pinned registers hold the
+  /// CMachine registers of SML/NJ; they are reserved and are accessed with
+  /// the llvm.read_register and llvm.write_register intrinsics.  The list is
+  /// computed once per function (see X86MachineFunctionInfo).
+  ArrayRef<MCPhysReg> getJWAPinnedRegs(const MachineFunction &MF) const;
+
+  /// Parse the "jwa.pinned" module flag for the function \p F into \p Regs,
+  /// which is left empty when \p F is not a JWA function.
+  void parseJWAPinnedRegs(const Function &F,
+                          SmallVectorImpl<MCPhysReg> &Regs) const;
+
   void adjustStackMapLiveOutMask(uint32_t *Mask) const override;
 
   bool hasBasePointer(const MachineFunction &MF) const;
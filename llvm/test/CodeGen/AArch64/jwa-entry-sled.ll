@@ -0,0 +1,29 @@
+; RUN: llc -mtriple=aarch64-unknown-linux-gnu -o - %s | FileCheck %s
+
+; A function with the "jwa-entry-sled" attribute starts with a NOP that the
+; runtime can patch into a "bl" to a trampoline (which only clobbers X30), and
+; is 8-byte aligned so that the sled can be patched with one atomic store.
+; Other functions do not get a sled.
+
+; CHECK:       .p2align 3
+; CHECK-LABEL: sled:
+; CHECK-NEXT:  // %bb.0:
+; CHECK-NEXT:  nop
+; CHECK-NEXT:  add x24, x24, x25
+; CHECK-NEXT:  b target
+; CHECK:       .p2align 2
+; CHECK-LABEL: nosled:
+; CHECK-NOT:   nop
+; CHECK:       b target
+define cc 20 void @sled(i64 %a, i64 %b) naked nounwind "jwa-entry-sled" {
+  %s = add i64 %a, %b
+  tail call cc 20 void @target(i64 %s, i64 %b)
+  ret void
+}
+
+define cc 20 void @nosled(i64 %a, i64 %b) naked nounwind {
+  tail call cc 20 void @target(i64 %b, i64 %a)
+  ret void
+}
+
+declare cc 20 void @target(i64, i64)
@@ -0,0 +1,67 @@
+; RUN: llc -mtriple=aarch64-unknown-linux-gnu -global-isel -global-isel-abort=2 \
+; RUN:   -pass-remarks-missed='gisel*' -stop-after=irtranslator -o - %s 2> %t.err \
+; RUN:   | FileCheck %s
+; RUN: FileCheck --check-prefix=REMARK %s < %t.err
+
+; GlobalISel lowers calls between JWA functions as tail calls (TCRETURNdi and
+; TCRETURNri without a call sequence), since a JWA function has no frame to
+; return to.  A JWA call in tail position that cannot be a tail call, and a
+; JWA function or call whose arguments do not fit in the argument registers,
+; are left to SelectionDAG.
+
+; CHECK-LABEL: name: direct
+; CHECK:       failedISel: false
+; CHECK-NOT:   ADJCALLSTACKDOWN
+; CHECK-NOT:   BL
+; CHECK:       TCRETURNdi @target, 0, csr_aarch64_noregs, implicit $sp, implicit $x24, implicit $x25, implicit $x26
+define cc 20 void @direct(i64 %a, i64 %b, i64 %c) naked nounwind {
+  %s = add i64 %a, %b
+  tail call cc 20 void @target(i64 %s, i64 %b, i64 %c)
+  ret void
+}
+
+; CHECK-LABEL: name: indirect
+; CHECK:       failedISel: false
+; CHECK-NOT:   ADJCALLSTACKDOWN
+; CHECK-NOT:   BLR
+; CHECK:       TCRETURNri {{%[0-9]+}}(p0), 0, csr_aarch64_noregs, implicit $sp, implicit $x24, implicit $x25
+define cc 20 void @indirect(i64 %a, i64 %b, i64 %k) naked nounwind {
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %b, i64 %a)
+  ret void
+}
+
+; A C function cannot tail call a JWA function, since the two conventions do
+; not preserve the same registers, so the call falls back to SelectionDAG
+; instead of becoming a BL that returns into a function without a frame.
+;
+; REMARK: remark: {{.*}} unable to translate instruction: call: '  tail call cc20 void @target(i64 %b, i64 %a, i64 %a)' (in function: from_c)
+; CHECK-LABEL: name: from_c
+; CHECK:       failedISel: true
+define void @from_c(i64 %a, i64 %b) nounwind {
+  tail call cc 20 void @target(i64 %b, i64 %a, i64 %a)
+  ret void
+}
+
+; The JWA convention has 27 integer argument registers and never passes
+; arguments on the stack, so a function with more parameters, or a call with
+; more arguments, is rejected.
+;
+; REMARK: remark: {{.*}} unable to lower arguments: {{.*}} (in function: many_in)
+; CHECK-LABEL: name: many_in
+; CHECK:       failedISel: true
+define cc 20 void @many_in(i64 %a0, i64 %a1, i64 %a2, i64 %a3, i64 %a4, i64 %a5, i64 %a6, i64 %a7, i64 %a8, i64 %a9, i64 %a10, i64 %a11, i64 %a12, i64 %a13, i64 %a14, i64 %a15, i64 %a16, i64 %a17, i64 %a18, i64 %a19, i64 %a20, i64 %a21, i64 %a22, i64 %a23, i64 %a24, i64 %a25, i64 %a26, i64 %a27) naked nounwind {
+  tail call cc 20 void @target(i64 %a27, i64 %a0, i64 %a1)
+  ret void
+}
+
+; REMARK: remark: {{.*}} unable to translate instruction: call: {{.*}} @wide({{.*}})' (in function: many_out)
+; CHECK-LABEL: name: many_out
+; CHECK:       failedISel: true
+define cc 20 void @many_out(i64 %a, i64 %b) naked nounwind {
+  tail call cc 20 void @wide(i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b, i64 %a, i64 %b)
+  ret void
+}
+
+declare cc 20 void @target(i64, i64, i64)
+declare cc 20 void @wide(i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64, i64)
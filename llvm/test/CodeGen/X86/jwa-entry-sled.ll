@@ -0,0 +1,32 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -o - %s | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.o %s
+; RUN: llvm-objdump -d %t.o | FileCheck %s --check-prefix=OBJ
+
+; A function with the "jwa-entry-sled" attribute starts with a 5-byte NOP
+; that the runtime can patch into a "call rel32" with one atomic store, so the
+; function is at least 8-byte aligned.  Other functions do not get a sled.
+
+; CHECK:       .p2align 4
+; CHECK-LABEL: sled:
+; CHECK-NEXT:  # %bb.0:
+; CHECK-NEXT:  nopl 8(%rax,%rax)
+; CHECK-NEXT:  addq %r14, %rdi
+; CHECK-NEXT:  jmp target # TAILCALL
+; CHECK-LABEL: nosled:
+; CHECK-NOT:   nop
+; CHECK:       jmp target # TAILCALL
+
+; OBJ-LABEL: sled:
+; OBJ-NEXT:  0: 0f 1f 44 00 08 nopl
+define cc 20 void @sled(i64 %a, i64 %b) naked nounwind "jwa-entry-sled" {
+  %s = add i64 %a, %b
+  tail call cc 20 void @target(i64 %s, i64 %b)
+  ret void
+}
+
+define cc 20 void @nosled(i64 %a, i64 %b) naked nounwind {
+  tail call cc 20 void @target(i64 %b, i64 %a)
+  ret void
+}
+
+declare cc 20 void @target(i64, i64)
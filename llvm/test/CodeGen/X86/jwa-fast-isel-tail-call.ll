@@ -0,0 +1,28 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -O0 -pass-remarks-missed=sdagisel -o - %s 2>&1 | FileCheck %s
+
+; FastISel lowers JWA tail calls and the returns that follow them, so that
+; only the arguments of a JWA function are left to SelectionDAG at -O0.
+
+; CHECK-NOT: FastISel missed
+; CHECK:     remark: {{.*}} FastISel didn't lower all arguments: {{.*}} (in function: direct)
+; CHECK-NOT: FastISel missed
+; CHECK:     remark: {{.*}} FastISel didn't lower all arguments: {{.*}} (in function: indirect)
+; CHECK-NOT: FastISel missed
+
+; CHECK-LABEL: direct:
+; CHECK:       jmp target # TAILCALL
+define cc 20 void @direct(i64 %a, i64 %b) naked nounwind {
+  %s = add i64 %a, %b
+  tail call cc 20 void @target(i64 %s, i64 %b)
+  ret void
+}
+
+; CHECK-LABEL: indirect:
+; CHECK:       jmpq *%rax # TAILCALL
+define cc 20 void @indirect(i64 %a, i64 %b) naked nounwind {
+  %f = inttoptr i64 %a to void (i64, i64)*
+  tail call cc 20 void %f(i64 %a, i64 %b)
+  ret void
+}
+
+declare cc 20 void @target(i64, i64)
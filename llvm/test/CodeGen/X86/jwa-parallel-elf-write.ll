@@ -0,0 +1,54 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -elf-parallel-write-threshold=0 -o %t.serial.o %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -elf-parallel-write-threshold=1 -elf-parallel-write-chunk-size=16 -o %t.parallel.o %s
+; RUN: cmp %t.serial.o %t.parallel.o
+; RUN: llvm-readobj -r %t.parallel.o | FileCheck %s
+
+; Section contents and relocations that are encoded in parallel chunks are
+; written in order, so the object is identical to the one that is written
+; serially.  The tiny chunk size splits .text and .rela.text into many chunks.
+
+; CHECK:      Section ({{[0-9]+}}) .rela.text {
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f0 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f2 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f1 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f3 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f0 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f1 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT:   0x{{[0-9A-F]+}} R_X86_64_PLT32 f2 0xFFFFFFFFFFFFFFFC
+; CHECK-NEXT: }
+
+declare cc 20 void @f0(i64, i64)
+declare cc 20 void @f1(i64, i64)
+declare cc 20 void @f2(i64, i64)
+declare cc 20 void @f3(i64, i64)
+
+define cc 20 void @a(i64 %k, i64 %v) naked nounwind {
+  switch i64 %v, label %d [ i64 0, label %b0
+                            i64 1, label %b1
+                            i64 2, label %b2 ]
+b0:
+  tail call cc 20 void @f0(i64 %k, i64 %v)
+  ret void
+b1:
+  tail call cc 20 void @f1(i64 %k, i64 %v)
+  ret void
+b2:
+  tail call cc 20 void @f2(i64 %k, i64 %v)
+  ret void
+d:
+  tail call cc 20 void @f3(i64 %k, i64 %v)
+  ret void
+}
+
+define cc 20 void @b(i64 %k, i64 %v) naked nounwind {
+  %c = icmp eq i64 %v, %k
+  br i1 %c, label %t, label %e
+t:
+  tail call cc 20 void @f0(i64 %k, i64 %v)
+  ret void
+e:
+  %w = add i64 %v, 1
+  tail call cc 20 void @f1(i64 %k, i64 %w)
+  tail call cc 20 void @f2(i64 %k, i64 %w)
+  ret void
+}
@@ -0,0 +1,64 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs -o - %s | FileCheck %s
+
+; An update of a pinned (reserved) register by a two-address instruction is
+; done in place, and other values computed from the pinned register use
+; three-address instructions, so that neither needs a copy of the register.
+
+declare i64 @llvm.read_register.i64(metadata)
+declare void @llvm.write_register.i64(metadata, i64)
+
+; CHECK-LABEL: bump:
+; CHECK-NOT:   %rdi, %r
+; CHECK:       movq %r9, (%rdi)
+; CHECK-NEXT:  movq %r9, 8(%rdi)
+; CHECK-NEXT:  addq $16, %rdi
+; CHECK-NEXT:  jmpq *%r8
+define cc 20 void @bump(i64 %k, i64 %v) naked nounwind {
+  %ap = call i64 @llvm.read_register.i64(metadata !1)
+  %p = inttoptr i64 %ap to i64*
+  store i64 %v, i64* %p
+  %p8 = getelementptr i64, i64* %p, i64 1
+  store i64 %v, i64* %p8
+  %n = add i64 %ap, 16
+  call void @llvm.write_register.i64(metadata !1, i64 %n)
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %k, i64 %v)
+  ret void
+}
+
+; The pinned register is read before the heap-limit check, and the object
+; pointer passed to the continuation is computed from it.
+; CHECK-LABEL: alloc:
+; CHECK:       cmpq %r14, %rdi
+; CHECK-NOT:   %rdi, %r
+; CHECK:       leaq 8(%rdi), %r9
+; CHECK-NEXT:  addq $16, %rdi
+; CHECK-NEXT:  jmpq *%r8
+define cc 20 void @alloc(i64 %k, i64 %v) naked nounwind {
+  %ap = call i64 @llvm.read_register.i64(metadata !1)
+  %lim = call i64 @llvm.read_register.i64(metadata !2)
+  %full = icmp ugt i64 %ap, %lim
+  br i1 %full, label %gc, label %ok
+
+gc:
+  %g = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %g(i64 %k, i64 %v)
+  ret void
+
+ok:
+  %p = inttoptr i64 %ap to i64*
+  store i64 %v, i64* %p
+  %obj = add i64 %ap, 8
+  %n = add i64 %ap, 16
+  call void @llvm.write_register.i64(metadata !1, i64 %n)
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %k, i64 %obj)
+  ret void
+}
+
+!llvm.module.flags = !{!0}
+
+!0 = !{i32 1, !"jwa.pinned", !3}
+!1 = !{!"rdi"}
+!2 = !{!"r14"}
+!3 = !{!"rdi", !"r14", !"r15"}
@@ -0,0 +1,91 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -o - %s | FileCheck %s
+
+; In JWA-aware allocation mode (the "jwa-regalloc" attribute), the greedy
+; allocator hints the PHI webs of the first three arguments (the SML
+; allocation, limit, and store pointers) to their argument registers, so the
+; pointers stay in RDI, R14, and R15 across the loop.  The limit and store
+; pointers are never copied and the allocation pointer is only copied back
+; into RDI after it is bumped.
+
+; CHECK-LABEL: loop:
+; CHECK-NOT:   mov{{.*}}, %r14
+; CHECK-NOT:   mov{{.*}}, %r15
+; CHECK:       # %join
+; CHECK:       movq {{%r[a-z0-9]+}}, %rdi
+; CHECK:       # %L
+; CHECK:       movq {{%r[a-z0-9]+}}, (%rdi)
+; CHECK:       leaq 32(%rdi), [[AP:%r[a-z0-9]+]]
+; CHECK-NEXT:  cmpq %r14, [[AP]]
+; CHECK:       # %side
+; CHECK-NEXT:  # in Loop
+; CHECK-NEXT:  movq %rdi, (%r15)
+; CHECK-NEXT:  movq %r15, 32(%rdi)
+; CHECK-NEXT:  addq $8, %r15
+; CHECK:       # %exit
+; CHECK-NOT:   mov{{.*}}, %r14
+; CHECK-NOT:   mov{{.*}}, %r15
+; CHECK:       # %gc
+; CHECK-NEXT:  movq [[AP]], %rdi
+; CHECK-NEXT:  jmpq *%rsi # TAILCALL
+
+define cc 20 void @loop(i64 %alloc, i64 %limit, i64 %store, i64 %link, i64 %clos, i64 %cont, i64 %a0, i64 %a1, i64 %a2, i64 %a3) nounwind "jwa-regalloc"="0" {
+entry:
+  br label %L
+
+L:
+  %ap = phi i64 [ %alloc, %entry ], [ %ap2, %join ]
+  %sp = phi i64 [ %store, %entry ], [ %sp2, %join ]
+  %v0 = phi i64 [ %a0, %entry ], [ %v0.n, %join ]
+  %v1 = phi i64 [ %a1, %entry ], [ %v1.n, %join ]
+  %v2 = phi i64 [ %a2, %entry ], [ %v2.n, %join ]
+  %v3 = phi i64 [ %a3, %entry ], [ %v3.n, %join ]
+  %p = inttoptr i64 %ap to i64*
+  store i64 %v0, i64* %p
+  %q1 = getelementptr i64, i64* %p, i64 1
+  store i64 %v1, i64* %q1
+  %q2 = getelementptr i64, i64* %p, i64 2
+  store i64 %v2, i64* %q2
+  %q3 = getelementptr i64, i64* %p, i64 3
+  store i64 %v3, i64* %q3
+  %ap1 = add i64 %ap, 32
+  %full = icmp ugt i64 %ap1, %limit
+  br i1 %full, label %gc, label %next
+
+gc:
+  %g = inttoptr i64 %cont to void (i64, i64, i64)*
+  tail call cc 20 void %g(i64 %ap1, i64 %limit, i64 %sp)
+  ret void
+
+next:
+  %v0.t = mul i64 %v0, %v1
+  %v0.n = xor i64 %v0.t, %v3
+  %v1.t = mul i64 %v1, %v2
+  %v1.n = xor i64 %v1.t, %v0
+  %v2.t = mul i64 %v2, %v3
+  %v2.n = xor i64 %v2.t, %v1
+  %v3.t = mul i64 %v3, %v0
+  %v3.n = xor i64 %v3.t, %v2
+  %c = icmp ult i64 %v0.n, %v1.n
+  br i1 %c, label %side, label %join
+
+side:
+  ; record the old allocation pointer in the store list
+  %sq = inttoptr i64 %sp to i64*
+  store i64 %ap, i64* %sq
+  %sp1 = add i64 %sp, 8
+  %r = inttoptr i64 %ap1 to i64*
+  store i64 %sp, i64* %r
+  %ap3 = add i64 %ap1, 16
+  br label %join
+
+join:
+  %sp2 = phi i64 [ %sp1, %side ], [ %sp, %next ]
+  %ap2 = phi i64 [ %ap3, %side ], [ %ap1, %next ]
+  %done = icmp eq i64 %v2.n, 0
+  br i1 %done, label %exit, label %L
+
+exit:
+  %k = inttoptr i64 %link to void (i64, i64, i64, i64, i64, i64, i64)*
+  tail call cc 20 void %k(i64 %ap2, i64 %limit, i64 %sp2, i64 %v0.n, i64 %v1.n, i64 %v2.n, i64 %v3.n)
+  ret void
+}
@@ -0,0 +1,33 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -pass-remarks-analysis=regalloc -o /dev/null %s 2>&1 | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -pass-remarks-analysis=regalloc -jwa-regalloc-budget=0 -o /dev/null %s 2>&1 | FileCheck %s --check-prefix=NOLIMIT
+
+; The greedy allocator reports the spills and reloads of every function.  A
+; function whose "jwa-regalloc" budget is smaller than its instruction count
+; is allocated without live-range splitting, which the remark records; the
+; -jwa-regalloc-budget option overrides the budget of the attribute.
+
+; CHECK: remark: {{.*}} spills {{.*}} reloads {{.*}} generated in function{{$}}
+; CHECK: remark: {{.*}} generated in function; allocation budget exceeded: true
+; CHECK: remark: {{.*}} generated in function{{$}}
+
+; NOLIMIT-NOT:     budget exceeded
+; NOLIMIT-COUNT-3: remark: {{.*}} generated in function{{$}}
+; NOLIMIT-NOT:     budget exceeded
+
+define cc 20 void @unlimited(i64 %k, i64 %v) nounwind "jwa-regalloc"="0" {
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %k, i64 %v)
+  ret void
+}
+
+define cc 20 void @small(i64 %k, i64 %v) nounwind "jwa-regalloc"="1" {
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %k, i64 %v)
+  ret void
+}
+
+define cc 20 void @large(i64 %k, i64 %v) nounwind "jwa-regalloc"="1000" {
+  %f = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %f(i64 %k, i64 %v)
+  ret void
+}
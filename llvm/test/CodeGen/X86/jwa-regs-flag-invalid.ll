@@ -0,0 +1,14 @@
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -o /dev/null %s 2>&1 | FileCheck %s
+
+; The registers of a "jwa.regs" module flag must be JWA argument registers.
+
+; CHECK: LLVM ERROR: jwa.regs: 'rax' is not a JWA argument register
+define cc 20 void @f(i64 %a, i64 %k) naked nounwind {
+  %g = inttoptr i64 %k to void (i64, i64)*
+  tail call cc 20 void %g(i64 %a, i64 %k)
+  ret void
+}
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"jwa.regs", !1}
+!1 = !{!"r14", !"rax"}
@@ -0,0 +1,24 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -o - %s | FileCheck %s
+
+; The "jwa.regs" module flag overrides the start of the JWA register sequence;
+; the arguments beyond it are assigned from the rest of the default sequence
+; (RDI, R14, R15, R8, ...), so the fourth argument is passed in R15.
+
+; CHECK-LABEL: f:
+; CHECK:       movq %r15, %rax
+; CHECK-NEXT:  movq %rdi, (%r14)
+; CHECK-NEXT:  movq %r8, 8(%r14)
+; CHECK-NEXT:  jmpq *%rax
+define cc 20 void @f(i64 %a, i64 %b, i64 %c, i64 %k) naked nounwind {
+  %p = inttoptr i64 %a to i64*
+  store i64 %b, i64* %p
+  %p8 = getelementptr i64, i64* %p, i64 1
+  store i64 %c, i64* %p8
+  %g = inttoptr i64 %k to void (i64, i64, i64, i64)*
+  tail call cc 20 void %g(i64 %a, i64 %b, i64 %c, i64 %k)
+  ret void
+}
+
+!llvm.module.flags = !{!0}
+!0 = !{i32 1, !"jwa.regs", !1}
+!1 = !{!"r14", !"rdi", !"r8"}
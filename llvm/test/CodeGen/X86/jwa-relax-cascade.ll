@@ -0,0 +1,40 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -o %t.o %s
+; RUN: llvm-objdump -d %t.o | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj -mc-early-relax-margin=8 -o %t.early.o %s
+; RUN: llvm-objdump -d %t.early.o | FileCheck %s --check-prefix=EARLY
+
+; After the first relaxation pass, the assembler only re-checks a branch when
+; it and its target have moved by different amounts.  Relaxing the jne moves
+; the target of the first jmp, but not the jmp itself, so the jmp must be
+; relaxed in the next pass.  The last jmp and its target move together, so
+; it stays short.
+
+; CHECK-LABEL: cascade:
+; CHECK-NEXT:    0: e9 81 00 00 00 jmp
+; CHECK:        7d: 0f 85 82 00 00 00 jne
+; CHECK:       105: eb 7a jmp
+; CHECK:       181: c3 retq
+
+; With an early-relaxation margin of 8, the first pass also relaxes the last
+; jmp, whose short distance is within 8 bytes of the limit.
+; EARLY-LABEL: cascade:
+; EARLY-NEXT:    0: e9 81 00 00 00 jmp
+; EARLY:        7d: 0f 85 82 00 00 00 jne
+; EARLY:       105: e9 7a 00 00 00 jmp
+; EARLY:       184: c3 retq
+
+module asm ".text"
+module asm ".globl cascade"
+module asm ".p2align 4"
+module asm "cascade:"
+module asm "  jmp .Lfar"
+module asm "  .fill 120, 1, 0x90"
+module asm "  jne .Lmid"
+module asm "  .fill 3, 1, 0x90"
+module asm ".Lfar:"
+module asm "  .fill 127, 1, 0x90"
+module asm ".Lmid:"
+module asm "  jmp .Lend"
+module asm "  .fill 122, 1, 0x90"
+module asm ".Lend:"
+module asm "  ret"
@@ -0,0 +1,30 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -pass-remarks-analysis=prologepilog -o /dev/null %s 2>&1 | FileCheck %s
+; RUN: sed -e 's/"jwa-spill-budget"="4096"/"jwa-spill-budget"="8"/' %s > %t.ll
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -o /dev/null %t.ll 2>&1 | FileCheck %s --check-prefix=OVER
+
+; The spill slots of a naked JWA function live in the spill area of the SML
+; stack frame.  Its size is reported against the "jwa-spill-budget" of the
+; function, and a function that needs more than its budget is an error.
+
+; CHECK: remark: {{.*}} [[SIZE:[0-9]+]] of 4096 spill-area bytes in function
+; CHECK: remark: {{.*}} [[SIZE]] stack bytes in function
+
+; OVER: error: stack size limit of 8 exceeded ({{[0-9]+}}) in spills
+
+define cc 20 void @spills(i64* %p) naked nounwind "jwa-spill-budget"="4096" {
+  %p1 = getelementptr i64, i64* %p, i64 1
+  %p2 = getelementptr i64, i64* %p, i64 2
+  %p3 = getelementptr i64, i64* %p, i64 3
+  %v0 = load volatile i64, i64* %p
+  %v1 = load volatile i64, i64* %p1
+  %v2 = load volatile i64, i64* %p2
+  %v3 = load volatile i64, i64* %p3
+  call void asm sideeffect "", "~{rax},~{rbx},~{rcx},~{rdx},~{rsi},~{rdi},~{rbp},~{r8},~{r9},~{r10},~{r11},~{r12},~{r13},~{r14},~{r15}"()
+  store volatile i64 %v0, i64* %p
+  store volatile i64 %v1, i64* %p1
+  store volatile i64 %v2, i64* %p2
+  store volatile i64 %v3, i64* %p3
+  %f = bitcast i64* %p to void (i64*)*
+  tail call cc 20 void %f(i64* %p)
+  ret void
+}
@@ -0,0 +1,63 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -relocation-model=pic -filetype=obj -o %t.o %s
+; RUN: llvm-readobj --sections %t.o | FileCheck %s
+
+; A module of private, nounwind JWA functions without a source-file name is
+; compiled to an object file without a symbol table, relocations, or unwind
+; tables.  The jump table, the constant pool, and the function addresses are
+; all in the text section, where the assembler resolves them.
+
+; CHECK:     Name: .strtab
+; CHECK-NOT: Name: .rela
+; CHECK-NOT: Name: .symtab
+; CHECK-NOT: Name: .eh_frame
+; CHECK:     Name: .text
+; CHECK-NOT: Name: .rela
+; CHECK-NOT: Name: .symtab
+; CHECK-NOT: Name: .eh_frame
+
+source_filename = ""
+
+define private cc 20 void @dispatch(i64 %ap, i64 %k, i64 %x, double %d) naked nounwind {
+entry:
+  switch i64 %x, label %other [
+    i64 0, label %case0
+    i64 1, label %case1
+    i64 2, label %case2
+    i64 3, label %case3
+    i64 4, label %case4
+  ]
+
+case0:
+  tail call cc 20 void @target(i64 %ap, i64 %k, i64 10, double %d)
+  ret void
+
+case1:
+  %d1 = fadd double %d, 3.250000e+00
+  tail call cc 20 void @target(i64 %ap, i64 %k, i64 11, double %d1)
+  ret void
+
+case2:
+  %fn = ptrtoint void (i64, i64, i64, double)* @target to i64
+  tail call cc 20 void @target(i64 %ap, i64 %k, i64 %fn, double %d)
+  ret void
+
+case3:
+  tail call cc 20 void @target(i64 %ap, i64 %k, i64 13, double %d)
+  ret void
+
+case4:
+  tail call cc 20 void @target(i64 %ap, i64 %k, i64 14, double %d)
+  ret void
+
+other:
+  %f = inttoptr i64 %k to void (i64, i64, i64, double)*
+  tail call cc 20 void %f(i64 %ap, i64 %k, i64 %x, double %d)
+  ret void
+}
+
+define private cc 20 void @target(i64 %ap, i64 %k, i64 %x, double %d) naked nounwind {
+entry:
+  %f = inttoptr i64 %k to void (i64, i64, i64, double)*
+  tail call cc 20 void %f(i64 %ap, i64 %k, i64 %x, double %d)
+  ret void
+}
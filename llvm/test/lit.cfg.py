@@ -0,0 +1,43 @@
+# -*- Python -*-
+
+# Configuration file for the regression tests of the code generator changes
+# for the JWA calling convention.  The tests use the tools of an LLVM build
+# (llc, FileCheck, llvm-readobj, ...), whose location is given by the
+# "llvm_tools_dir" parameter:
+#
+#   llvm-lit -Dllvm_tools_dir=<build>/bin llvm/test
+
+import os
+import re
+import subprocess
+
+import lit.formats
+
+config.name = 'LLVM'
+config.test_format = lit.formats.ShTest(not lit_config.isWindows)
+config.suffixes = ['.ll', '.mir', '.s']
+config.excludes = ['Inputs']
+config.test_source_root = os.path.dirname(__file__)
+
+tools_dir = lit_config.params.get('llvm_tools_dir')
+if not tools_dir:
+    lit_config.fatal('set the LLVM tools directory with -Dllvm_tools_dir=<dir>')
+config.environment['PATH'] = os.path.pathsep.join(
+    [tools_dir, config.environment.get('PATH', os.environ.get('PATH', ''))])
+
+# The test outputs go to the "test" directory of the LLVM build (i.e., next
+# to the tools directory), like those of the in-tree tests.
+config.test_exec_root = os.path.join(os.path.dirname(tools_dir), 'test')
+
+# The registered targets (e.g., "X86" and "AArch64") are the target
+# directories that llc reports in its version message.
+target_dirs = {'x86-64': 'X86', 'aarch64': 'AArch64', 'arm64': 'AArch64'}
+config.targets = set()
+llc_version = subprocess.check_output(
+    [os.path.join(tools_dir, 'llc'), '--version'], universal_newlines=True)
+for line in llc_version.splitlines():
+    m = re.match(r'\s+(\S+)\s+- ', line)
+    if m and m.group(1) in target_dirs:
+        config.targets.add(target_dirs[m.group(1)])
+for target in config.targets:
+    config.available_features.add(target.lower() + '-registered-target')
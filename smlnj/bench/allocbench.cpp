@@ -0,0 +1,232 @@
+/// \file allocbench.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (http://www.smlnj.org)
+/// All rights reserved.
+///
+/// \brief A benchmark for the allocation-pointer write prefetch
+///
+/// This tool measures the effect of the write prefetch that the code generator
+/// issues ahead of the allocation pointer (see `Context::setAllocPrefetch`) on
+/// an allocation-bound workload.  It uses a stand-in for the runtime system:
+/// a nursery that is filled by bump-pointer allocation of small records, which
+/// mirrors the code generated for a sequence of fragments that each allocate a
+/// few records and then prefetch once ahead of the final allocation pointer.
+/// When the nursery is exhausted, the "GC" resets the allocation pointer to the
+/// start of the nursery (i.e., nothing survives a minor collection).
+///
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+
+#include "target-info.hpp"
+
+#if defined(ARCH_AMD64)
+#define HOST_ARCH "x86_64"
+#elif defined(ARCH_ARM64)
+#define HOST_ARCH "aarch64"
+#else
+#  error unknown architeture
+#endif
+
+using smlnj::cfgcg::TargetInfo;
+
+extern "C" {
+void Die (const char *fmt, ...)
+{
+    va_list	ap;
+
+    va_start (ap, fmt);
+    fprintf (stderr, "allocbench: Fatal error -- ");
+    vfprintf (stderr, fmt, ap);
+    fprintf (stderr, "\n");
+    va_end(ap);
+
+    ::exit (1);
+}
+} // extern "C"
+
+[[noreturn]] void usage ()
+{
+    std::cerr << "usage: allocbench [ options ] [ <distance> ... ]\n";
+    std::cerr << "options:\n";
+    std::cerr << "    --nursery <kb>    -- size of the nursery in Kbytes (default 1024)\n";
+    std::cerr << "    --record <n>      -- size of a record in words, including the\n";
+    std::cerr << "                         descriptor (default 3)\n";
+    std::cerr << "    --fragment <n>    -- number of records allocated by a fragment (default 2)\n";
+    std::cerr << "    --total <mb>      -- Mbytes allocated per run (default 2048)\n";
+    std::cerr << "    --repeat <n>      -- number of runs for each distance; the minimum\n";
+    std::cerr << "                         time is used (default 5)\n";
+    std::cerr << "The distances are in bytes; zero means no prefetching.  The default\n";
+    std::cerr << "distances are 0, 64, 128, 256, 512, 1024, and the target's default.\n";
+    exit (1);
+}
+
+/// the parameters of the allocation workload
+struct Workload {
+    uint64_t *nursery;                  ///< the base of the nursery
+    size_t nurseryWords;                ///< the size of the nursery in words
+    size_t totalWords;                  ///< the number of words to allocate in a run
+    int recordWords;                    ///< the size of a record in words (including
+                                        ///  the descriptor)
+    int fragmentRecords;                ///< the number of records allocated by a fragment
+};
+
+// run the workload with a write prefetch `dist` bytes ahead of the allocation
+// pointer at the end of each fragment; returns the number of minor collections.
+// We pass the records through a cons-like link field, so the stores are not
+// dead.
+template <bool prefetch>
+__attribute__((noinline))
+static size_t run (Workload const &w, size_t dist)
+{
+    uint64_t *allocPtr = w.nursery;
+    uint64_t const fragWords = w.recordWords * w.fragmentRecords;
+    uint64_t *limitPtr = w.nursery + w.nurseryWords - fragWords;
+    uint64_t const desc = (uint64_t(w.recordWords - 1) << 7) | 0x2;
+    uint64_t link = 1;
+    size_t numGCs = 0;
+
+    for (size_t n = 0;  n < w.totalWords;  n += fragWords) {
+	if (allocPtr > limitPtr) {
+	  // minor collection: nothing survives
+	    allocPtr = w.nursery;
+	    link = 1;
+	    numGCs++;
+	}
+	for (int r = 0;  r < w.fragmentRecords;  r++) {
+	    allocPtr[0] = desc;
+	    allocPtr[1] = link;
+	    for (int i = 2;  i < w.recordWords;  i++) {
+		allocPtr[i] = n + i;
+	    }
+	    link = reinterpret_cast<uint64_t>(allocPtr + 1);
+	    allocPtr += w.recordWords;
+	}
+	if (prefetch) {
+	  // prefetch for writing with maximal temporal locality (as in
+	  // `Context::prefetchAllocPtr`)
+	    __builtin_prefetch (reinterpret_cast<char *>(allocPtr) + dist, 1, 3);
+	}
+    }
+
+    return numGCs;
+}
+
+// return the minimum time (in seconds) over `repeat` runs of the workload
+static double measure (Workload const &w, size_t dist, int repeat)
+{
+    double best = 0.0;
+    for (int r = 0;  r < repeat;  r++) {
+	auto start = std::chrono::steady_clock::now();
+	if (dist == 0) {
+	    run<false> (w, 0);
+	} else {
+	    run<true> (w, dist);
+	}
+	std::chrono::duration<double> t = std::chrono::steady_clock::now() - start;
+	if ((r == 0) || (t.count() < best)) {
+	    best = t.count();
+	}
+    }
+    return best;
+}
+
+int main (int argc, char **argv)
+{
+    size_t nurseryKB = 1024;
+    size_t totalMB = 2048;
+    int recordWords = 3;
+    int fragmentRecords = 2;
+    int repeat = 5;
+    std::vector<size_t> dists;
+
+    std::vector<std::string> args(argv+1, argv+argc);
+
+    for (int i = 0;  i < args.size();  i++) {
+	if (args[i][0] == '-') {
+	    if (i+1 >= args.size()) {
+		usage();
+	    }
+	    int n = atoi(args[i+1].c_str());
+	    if (n <= 0) {
+		usage();
+	    }
+	    if (args[i] == "--nursery") {
+		nurseryKB = n;
+	    } else if (args[i] == "--record") {
+		recordWords = std::max(2, n);
+	    } else if (args[i] == "--fragment") {
+		fragmentRecords = n;
+	    } else if (args[i] == "--total") {
+		totalMB = n;
+	    } else if (args[i] == "--repeat") {
+		repeat = n;
+	    } else {
+		usage();
+	    }
+	    ++i;
+	}
+	else {
+	    dists.push_back (atoi(args[i].c_str()));
+	}
+    }
+
+    auto tgtInfo = TargetInfo::infoForTarget (HOST_ARCH);
+    if (dists.empty()) {
+	dists = { 0, 64, 128, 256, 512, 1024 };
+	if (std::find(dists.begin(), dists.end(), tgtInfo->allocPrefetchSzb) == dists.end()) {
+	    dists.push_back (tgtInfo->allocPrefetchSzb);
+	}
+    }
+
+    Workload w;
+    w.nurseryWords = (nurseryKB * 1024) / sizeof(uint64_t);
+    w.totalWords = (totalMB * 1024 * 1024) / sizeof(uint64_t);
+    w.recordWords = recordWords;
+    w.fragmentRecords = fragmentRecords;
+    if (w.nurseryWords < 2 * recordWords * fragmentRecords) {
+	usage();
+    }
+  // allocate the nursery plus room for prefetches past its end and touch it,
+  // so that the page faults are not part of the first measurement
+    size_t maxDist = *std::max_element(dists.begin(), dists.end());
+    w.nursery = new uint64_t[w.nurseryWords + maxDist / sizeof(uint64_t) + 1];
+    std::fill (w.nursery, w.nursery + w.nurseryWords, 0);
+
+    std::cout << "target: " << HOST_ARCH << "; nursery " << nurseryKB << "Kb; "
+	<< recordWords << "-word records; " << fragmentRecords
+	<< " records/fragment; " << totalMB << "Mb/run; " << repeat << " runs\n";
+    std::cout << "  distance   time(ms)   ns/word   speedup\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    double base = 0.0;
+    for (auto dist : dists) {
+	double t = measure (w, dist, repeat);
+	if (dist == 0) {
+	    base = t;
+	}
+	std::cout << "  " << std::setw(8) << dist
+	    << std::setw(11) << 1000.0 * t
+	    << std::setw(10) << 1.0e9 * t / double(w.totalWords);
+	if (base > 0.0) {
+	    std::cout << std::setw(10) << base / t;
+	}
+	if (dist == tgtInfo->allocPrefetchSzb) {
+	    std::cout << "  (target default)";
+	}
+	std::cout << "\n";
+    }
+
+    delete[] w.nursery;
+
+    return 0;
+
+}
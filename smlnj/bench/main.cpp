@@ -0,0 +1,205 @@
+/// \file main.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (http://www.smlnj.org)
+/// All rights reserved.
+///
+/// \brief A benchmark that compares the ways of handling the CMachine registers
+///
+/// This tool compiles a corpus of CFG pickles twice: once with the CMachine
+/// registers passed as extra arguments to every function (the default scheme)
+/// and once with the registers pinned to their hardware registers (see
+/// `Context::setPinnedRegs`).  For each scheme, it reports the number of
+/// machine instructions, the register allocator's spills and reloads, and the
+/// time spent in register allocation and machine-code generation.
+///
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+
+#include "cfg.hpp"
+#include "context.hpp"
+#include "target-info.hpp"
+
+#if defined(ARCH_AMD64)
+#define HOST_ARCH "x86_64"
+#elif defined(ARCH_ARM64)
+#define HOST_ARCH "aarch64"
+#else
+#  error unknown architeture
+#endif
+
+using smlnj::cfgcg::Context;
+using smlnj::cfgcg::PassTiming;
+
+extern "C" {
+void Die (const char *fmt, ...)
+{
+    va_list	ap;
+
+    va_start (ap, fmt);
+    fprintf (stderr, "cfgbench: Fatal error -- ");
+    vfprintf (stderr, fmt, ap);
+    fprintf (stderr, "\n");
+    va_end(ap);
+
+    ::exit (1);
+}
+} // extern "C"
+
+[[noreturn]] void usage ()
+{
+    std::cerr << "usage: cfgbench [ --target <target> ] [ --repeat <n> ] <pkl-file> ...\n";
+    std::cerr << "options:\n";
+    std::cerr << "    -target <target>  -- specify the target architecture (default "
+              << HOST_ARCH << ")\n";
+    std::cerr << "    -repeat <n>       -- number of times to compile the corpus for each\n";
+    std::cerr << "                         scheme; the minimum times are used (default 5)\n";
+    exit (1);
+}
+
+/// the measurements for a register scheme
+struct Result {
+    unsigned int numInstrs;             ///< number of machine instructions
+    unsigned int numSpills;             ///< number of spills (including folded spills)
+    unsigned int numReloads;            ///< number of reloads (including folded reloads)
+    size_t codeSzb;                     ///< total size of the generated code
+    double raTime;                      ///< wall-clock time (in seconds) spent in
+                                        ///  register allocation
+    double codegenTime;                 ///< wall-clock time (in seconds) spent in
+                                        ///  machine-code generation
+};
+
+// the wall-clock time of the register-allocation passes in a list of pass timings
+static double raTime (std::vector<PassTiming> const &passes)
+{
+    double t = 0.0;
+    for (auto const &p : passes) {
+	if ((p.name == "greedy") || (p.name == "regallocfast")) {
+	    t += p.wallTime;
+	}
+    }
+    return t;
+}
+
+// compile the corpus using the given register scheme and return the measurements
+static Result measure (
+    Context *cxt,
+    std::vector<std::string> const &srcs,
+    bool pinned,
+    int repeat)
+{
+    Result res = { 0, 0, 0, 0, 0.0, 0.0 };
+
+    cxt->setPinnedRegs (pinned);
+
+    for (int r = 0;  r < repeat;  r++) {
+	cxt->stats().clear();
+	size_t szb = 0;
+	for (auto const &src : srcs) {
+	  // we read the pickle for each compilation, since code generation
+	  // annotates the CFG
+	    asdl::file_instream inS(src);
+	    CFG::comp_unit *cu = CFG::comp_unit::read (inS);
+
+	    cu->codegen (cxt);
+	    cxt->optimize ();
+	    auto obj = cxt->compile ();
+	    if (obj) {
+		szb += obj->size();
+	    }
+	    cxt->endModule ();
+
+	    delete cu;
+	}
+      // the instruction and spill counts are the same for every repetition
+	auto const &stats = cxt->stats();
+	res.numInstrs = stats.numMachineInstrs;
+	res.numSpills = stats.numSpills;
+	res.numReloads = stats.numReloads;
+	res.codeSzb = szb;
+	double t = raTime (stats.mcPasses);
+	if ((r == 0) || (t < res.raTime)) {
+	    res.raTime = t;
+	}
+	if ((r == 0) || (stats.codegenTime < res.codegenTime)) {
+	    res.codegenTime = stats.codegenTime;
+	}
+    }
+
+    return res;
+
+}
+
+// print a row of the results table
+static void printRow (char const *name, Result const &res)
+{
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+	<< std::setw(10) << res.numInstrs
+	<< std::setw(8) << res.numSpills
+	<< std::setw(8) << res.numReloads
+	<< std::setw(10) << res.codeSzb
+	<< std::setw(10) << 1000.0 * res.raTime
+	<< std::setw(12) << 1000.0 * res.codegenTime << "\n";
+}
+
+int main (int argc, char **argv)
+{
+    std::string targetArch = HOST_ARCH;
+    int repeat = 5;
+    std::vector<std::string> srcs;
+
+    std::vector<std::string> args(argv+1, argv+argc);
+
+    for (int i = 0;  i < args.size();  i++) {
+	if (args[i][0] == '-') {
+	    if (i+1 >= args.size()) {
+		usage();
+	    }
+	    if (args[i] == "--target") {
+		targetArch = args[++i];
+	    } else if (args[i] == "--repeat") {
+		repeat = std::max(1, atoi(args[++i].c_str()));
+	    } else {
+		usage();
+	    }
+	}
+	else {
+	    srcs.push_back (args[i]);
+	}
+    }
+    if (srcs.empty()) {
+        usage();
+    }
+
+    Context *cxt = Context::create (targetArch);
+    if (cxt == nullptr) {
+	std::cerr << "cfgbench: unknown target \"" << targetArch << "\"\n";
+	return 1;
+    }
+
+  // the instruction and spill counts come from the statistics and the
+  // register-allocation time comes from LLVM's pass timers
+    cxt->enableStats (true);
+    cxt->enablePassTiming (true);
+
+    Result dflt = measure (cxt, srcs, false, repeat);
+    Result pinned = measure (cxt, srcs, true, repeat);
+
+    std::cout << "target: " << targetArch << "; " << srcs.size() << " files; "
+	<< repeat << " runs\n";
+    std::cout << "  scheme        instrs  spills reloads     bytes    RA(ms) codegen(ms)\n";
+    std::cout << std::fixed << std::setprecision(3);
+    printRow ("args", dflt);
+    printRow ("pinned", pinned);
+
+    delete cxt;
+
+    return 0;
+
+}
@@ -11,15 +11,20 @@
 #include <string>
 #include <vector>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <cstdlib>
 #include <cstdio>
 #include <cstdarg>
 
-#include "llvm/Support/TargetSelect.h"
 #include "llvm/IR/Value.h"
 
 #include "cfg.hpp"
 #include "context.hpp"
+#include "context-pool.hpp"
+#include "code-object.hpp"
+#include "code-arena.hpp"
+#include "jit-loader.hpp"
 #include "target-info.hpp"
 
 #if defined(ARCH_AMD64)
@@ -31,15 +36,70 @@
 #endif
 
 /// different output targets
-enum class output { PrintAsm, AsmFile, ObjFile, Memory };
+enum class output { PrintAsm, AsmFile, ObjFile, Memory, Load, JITLink };
+
+// use the fast code generator (i.e., no machine-code optimization, FastISel,
+// and the fast register allocator).  This call must precede `setTarget`.
+//
+void enableFastCodeGen ();
+
+// use GlobalISel for instruction selection on aarch64
+//
+void enableGlobalISel ();
 
 // set the target architecture.  This call returns `true` when there
 // is an error and `false` otherwise.
 //
 bool setTarget (std::string const &target);
 
-// generate code
-void codegen (std::string const & src, bool emitLLVM, bool dumpBits, output out);
+// enable prefetching ahead of the allocation pointer, where a distance of
+// zero selects the target's default distance.
+//
+void setPrefetch (int dist);
+
+// set the IR optimization pipeline from a comma-separated list of pass names.
+// This call returns `true` when there is an error and `false` otherwise.
+//
+bool setPasses (std::string const &passes);
+
+// set the JWA register sequence from a comma-separated list of register names.
+// This call returns `true` when there is an error and `false` otherwise.
+//
+bool setJWARegs (std::string const &regs);
+
+// enable the collection and reporting of code-generation statistics
+//
+void enableStats ();
+
+// optimize for code size (enables the machine outliner)
+//
+void enableOptForSize ();
+
+// emit patchable entry sleds and a sled table
+//
+void enableEntrySleds ();
+
+// use the JWA-aware register-allocation mode with the given instruction budget
+//
+void setRABudget (unsigned int budget);
+
+// emit symbol-free object files for the in-memory code objects
+//
+void enableSymbolFree ();
+
+// pin the hardware CMachine registers in the generated functions
+//
+void enablePinnedRegs ();
+
+// generate code; when there is more than one source file, the comp_units are
+// compiled as a bundle into a single module.  Returns true if there was an error.
+bool codegen (
+    std::vector<std::string> const & srcs,
+    bool emitLLVM, bool emitOptLLVM, bool dumpBits, output out);
+
+// convert the pickle files to the version 2 pickle format and report the
+// size and decoding time of both formats
+void convertPickles (std::vector<std::string> const & srcs);
 
 extern "C" {
 void Die (const char *fmt, ...)
@@ -58,15 +118,47 @@ void Die (const char *fmt, ...)
 
 [[noreturn]] void usage ()
 {
-    std::cerr << "usage: cfgc [ -o | -S | -c ] [ --emit-llvm ] [ --bits ] [ --target <target> ] <pkl-file>\n";
+    std::cerr << "usage: cfgc [ -o | -S | -c ] [ --emit-llvm ] [ --emit-opt-llvm ] [ --bits ]\n";
+    std::cerr << "            [ --target <target> ]\n";
+    std::cerr << "            [ --prefetch <bytes> ] [ --load ] [ --jitlink ] [ --passes <passes> ]\n";
+    std::cerr << "            [ --stats ] [ --jwa-regs <regs> ] [ --ra-budget <instrs> ]\n";
+    std::cerr << "            [ --size ] [ --fast ] [ --gisel ] [ --sleds ] [ --no-symbols ]\n";
+    std::cerr << "            [ --pin-regs ] [ --pickle-v2 ]\n";
+    std::cerr << "            <pkl-file> ... | <ll-file>\n";
     std::cerr << "options:\n";
     std::cerr << "    -o                -- generate an object file\n";
     std::cerr << "    -S                -- emit target assembly code to a file\n";
     std::cerr << "    -c                -- use JIT compiler and loader to produce code object\n";
-    std::cerr << "    -emit-llvm        -- emit generated LLVM assembly to standard output\n";
+    std::cerr << "    -emit-llvm        -- emit generated LLVM assembly to standard error\n";
+    std::cerr << "    -emit-opt-llvm    -- emit the LLVM assembly after optimization to\n";
+    std::cerr << "                         standard error\n";
     std::cerr << "    -bits             -- output the code-object bits (implies \"-c\" flag)\n";
     std::cerr << "    -target <target>  -- specify the target architecture (default "
               << HOST_ARCH << ")\n";
+    std::cerr << "    -prefetch <bytes> -- prefetch <bytes> ahead of the allocation pointer\n";
+    std::cerr << "                         (0 for the target's default distance)\n";
+    std::cerr << "    -load             -- load the code object into executable memory\n";
+    std::cerr << "                         (implies \"-c\" flag)\n";
+    std::cerr << "    -jitlink          -- like \"-load\", but link the object file using JITLink\n";
+    std::cerr << "    -passes <passes>  -- comma-separated list of IR optimization passes\n";
+    std::cerr << "    -jwa-regs <regs>  -- comma-separated list of JWA argument registers\n";
+    std::cerr << "    -ra-budget <instrs> -- JWA-aware register allocation; functions with\n";
+    std::cerr << "                         more than <instrs> instructions are allocated\n";
+    std::cerr << "                         without splitting (0 for no budget)\n";
+    std::cerr << "    -stats            -- report code-generation statistics (including\n";
+    std::cerr << "                         per-pass timing)\n";
+    std::cerr << "    -size             -- optimize for code size (enables outlining)\n";
+    std::cerr << "    -fast             -- use the fast (-O0) code generator\n";
+    std::cerr << "    -gisel            -- use GlobalISel for instruction selection (aarch64)\n";
+    std::cerr << "    -sleds            -- emit patchable entry sleds for tracing\n";
+    std::cerr << "    -no-symbols       -- emit symbol-free object files for the \"-c\" and\n";
+    std::cerr << "                         \"-load\" modes\n";
+    std::cerr << "    -pin-regs         -- reserve the hardware CMachine registers instead\n";
+    std::cerr << "                         of passing them as arguments\n";
+    std::cerr << "    -pickle-v2        -- convert the pickles to the version 2 format\n";
+    std::cerr << "multiple pickle files are compiled as a bundle into a single module;\n";
+    std::cerr << "a single LLVM assembly (\".ll\") file is optimized and compiled in\n";
+    std::cerr << "place of the module generated from a pickle\n";
     exit (1);
 }
 
@@ -74,8 +166,21 @@ int main (int argc, char **argv)
 {
     output out = output::PrintAsm;
     bool emitLLVM = false;
+    bool emitOptLLVM = false;
     bool dumpBits = false;
-    std::string src = "";
+    int prefetchDist = -1;
+    std::string passes = "";
+    std::string jwaRegs = "";
+    bool stats = false;
+    bool pickleV2 = false;
+    bool optForSize = false;
+    bool fastCG = false;
+    bool gisel = false;
+    bool sleds = false;
+    bool noSymbols = false;
+    bool pinRegs = false;
+    int raBudget = -1;
+    std::vector<std::string> srcs;
 #if defined(ARCH_AMD64)
     std::string targetArch = "x86_64";
 #elif defined(ARCH_ARM64)
@@ -100,9 +205,59 @@ int main (int argc, char **argv)
 		out = output::Memory;
 	    } else if (args[i] == "--emit-llvm") {
 		emitLLVM = true;
+	    } else if (args[i] == "--emit-opt-llvm") {
+		emitOptLLVM = true;
 	    } else if (args[i] == "--bits") {
 		dumpBits = true;
 		out = output::Memory;
+	    } else if (args[i] == "--jwa-regs") {
+		i++;
+		if (i < args.size()) {
+		    jwaRegs = args[i];
+		} else {
+		    usage();
+		}
+	    } else if (args[i] == "--ra-budget") {
+		i++;
+		if (i < args.size()) {
+		    raBudget = atoi(args[i].c_str());
+		} else {
+		    usage();
+		}
+	    } else if (args[i] == "--passes") {
+		i++;
+		if (i < args.size()) {
+		    passes = args[i];
+		} else {
+		    usage();
+		}
+	    } else if (args[i] == "--stats") {
+		stats = true;
+	    } else if (args[i] == "--size") {
+		optForSize = true;
+	    } else if (args[i] == "--fast") {
+		fastCG = true;
+	    } else if (args[i] == "--gisel") {
+		gisel = true;
+	    } else if (args[i] == "--sleds") {
+		sleds = true;
+	    } else if (args[i] == "--no-symbols") {
+		noSymbols = true;
+	    } else if (args[i] == "--pin-regs") {
+		pinRegs = true;
+	    } else if (args[i] == "--pickle-v2") {
+		pickleV2 = true;
+	    } else if (args[i] == "--load") {
+		out = output::Load;
+	    } else if (args[i] == "--jitlink") {
+		out = output::JITLink;
+	    } else if (args[i] == "--prefetch") {
+		i++;
+		if (i < args.size()) {
+		    prefetchDist = atoi(args[i].c_str());
+		} else {
+		    usage();
+		}
 	    } else if (args[i] == "--target") {
 		i++;
 		if (i < args.size()) {
@@ -114,29 +269,76 @@ int main (int argc, char **argv)
 		usage();
 	    }
 	}
-	else if (i < args.size()-1) {
-            usage();
-	}
-	else { // last argument
-	    src = args[i];
+	else {
+	    srcs.push_back (args[i]);
 	}
     }
-    if (src.empty()) {
+    if (srcs.empty()) {
         usage();
     }
 
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
+    if (pickleV2) {
+	convertPickles (srcs);
+	return 0;
+    }
+
+    if (fastCG) {
+	enableFastCodeGen ();
+    }
 
+    // note that the LLVM target is initialized on demand when the code
+    // buffer is created
     if (setTarget (targetArch)) {
 	std::cerr << "codegen: unable to set target to \"" << targetArch << "\"\n";
 	return 1;
     }
 
-    codegen (src, emitLLVM, dumpBits, out);
+    if (prefetchDist >= 0) {
+	setPrefetch (prefetchDist);
+    }
+
+    if (!jwaRegs.empty() && setJWARegs (jwaRegs)) {
+	std::cerr << "codegen: invalid JWA register list \"" << jwaRegs << "\"\n";
+	return 1;
+    }
+
+    if (!passes.empty() && setPasses (passes)) {
+	std::cerr << "codegen: invalid pass list \"" << passes << "\"\n";
+	return 1;
+    }
+
+    if (stats) {
+	enableStats ();
+    }
+
+    if (optForSize) {
+	enableOptForSize ();
+    }
+
+    if (gisel) {
+	enableGlobalISel ();
+    }
+
+    if (sleds) {
+	enableEntrySleds ();
+    }
+
+    if (raBudget >= 0) {
+	setRABudget (raBudget);
+    }
+
+    if (pinRegs) {
+	enablePinnedRegs ();
+    }
+
+  // JITLink finds the entry points by their symbols
+    if (noSymbols && (out != output::JITLink)) {
+	enableSymbolFree ();
+    }
+
+    if (codegen (srcs, emitLLVM, emitOptLLVM, dumpBits, out)) {
+	return 1;
+    }
 
     return 0;
 
@@ -144,11 +346,38 @@ int main (int argc, char **argv)
 
 /***** Code Generation *****/
 
-//! points to a dynamically allocated code buffer; this pointer gets
-//! reset if we change the target architecture.
+//! pool of code buffers, so that switching between targets does not require
+//! rebuilding the code buffers.
+//
+static smlnj::cfgcg::ContextPool gPool(4);
+
+//! points to the current code buffer, which is acquired from `gPool`; this
+//! pointer gets reset if we change the target architecture.
 //
 static smlnj::cfgcg::Context *gContext = nullptr;
 
+//! the code-generation optimization level for the contexts that we acquire
+//
+static llvm::CodeGenOpt::Level gOptLvl = llvm::CodeGenOpt::Less;
+
+/// use the fast code generator
+//
+void enableFastCodeGen ()
+{
+    assert (gContext == nullptr && "call enableFastCodeGen before calling setTarget");
+    gOptLvl = llvm::CodeGenOpt::None;
+}
+
+/// use GlobalISel on aarch64
+//
+void enableGlobalISel ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enableGlobalISel");
+
+    gContext->setGlobalISel (true);
+
+}
+
 /// set the target machine
 //
 bool setTarget (std::string const &target)
@@ -157,15 +386,129 @@ bool setTarget (std::string const &target)
 	if (gContext->targetInfo()->name == target) {
 	    return false;
 	}
-	delete gContext;
+	gPool.release (gContext);
     }
 
-    gContext = smlnj::cfgcg::Context::create (target);
+    gContext = gPool.acquire (target, "generic", "", gOptLvl);
 
     return (gContext == nullptr);
 
 }
 
+/// enable allocation-pointer prefetching
+//
+void setPrefetch (int dist)
+{
+    assert (gContext != nullptr && "call setTarget before calling setPrefetch");
+
+    if (dist == 0) {
+	dist = gContext->targetInfo()->allocPrefetchSzb;
+    }
+    gContext->setAllocPrefetch (dist);
+
+}
+
+/// set the optimization pipeline
+//
+// split a comma-separated list
+//
+static std::vector<std::string> splitList (std::string const &s)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= s.size()) {
+	size_t end = s.find (',', start);
+	if (end == std::string::npos) {
+	    end = s.size();
+	}
+	items.push_back (s.substr(start, end - start));
+	start = end + 1;
+    }
+
+    return items;
+
+}
+
+bool setPasses (std::string const &passes)
+{
+    assert (gContext != nullptr && "call setTarget before calling setPasses");
+
+    return ! gContext->setOptPipeline (splitList (passes));
+
+}
+
+bool setJWARegs (std::string const &regs)
+{
+    assert (gContext != nullptr && "call setTarget before calling setJWARegs");
+
+    return ! gContext->setJWARegisters (splitList (regs));
+
+}
+
+static bool gReportStats = false;
+
+/// enable statistics
+//
+void enableStats ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enableStats");
+
+    gReportStats = true;
+    gContext->enableStats (true);
+    gContext->enablePassTiming (true);
+
+}
+
+/// enable optimizing for code size
+//
+void enableOptForSize ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enableOptForSize");
+
+    gContext->setOptimizeForSize (true);
+
+}
+
+/// enable entry sleds
+//
+void enableEntrySleds ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enableEntrySleds");
+
+    gContext->setEntrySleds (true);
+
+}
+
+/// enable JWA-aware register allocation
+//
+void setRABudget (unsigned int budget)
+{
+    assert (gContext != nullptr && "call setTarget before calling setRABudget");
+
+    gContext->setJWARegAlloc (true, budget);
+
+}
+
+/// enable symbol-free object files
+//
+void enableSymbolFree ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enableSymbolFree");
+
+    gContext->setSymbolFree (true);
+
+}
+
+/// pin the hardware CMachine registers
+//
+void enablePinnedRegs ()
+{
+    assert (gContext != nullptr && "call setTarget before calling enablePinnedRegs");
+
+    gContext->setPinnedRegs (true);
+
+}
+
 // timer support
 #include <time.h>
 
@@ -201,22 +544,48 @@ class Timer {
     Timer (uint64_t t) : _ns100(t) { }
 };
 
-void codegen (std::string const & src, bool emitLLVM, bool dumpBits, output out)
+// timer for measuring the time from process startup to the first code object
+static Timer gStartupTimer = Timer::start();
+
+bool codegen (
+    std::vector<std::string> const & srcs,
+    bool emitLLVM, bool emitOptLLVM, bool dumpBits, output out)
 {
     assert (gContext != nullptr && "call setTarget before calling codegen");
 
-    asdl::file_instream inS(src);
-
-    std::cout << "read pickle ..." << std::flush;
-    Timer unpklTimer = Timer::start();
-    CFG::comp_unit *cu = CFG::comp_unit::read (inS);
-    std::cout << " " << unpklTimer.msec() << "ms\n" << std::flush;
+    auto isLL = [](std::string const &src) {
+	return (src.size() > 3) && (src.compare(src.size() - 3, 3, ".ll") == 0);
+    };
 
-    // generate LLVM
-    std::cout << " generate llvm ..." << std::flush;;
-    Timer genTimer = Timer::start();
-    cu->codegen (gContext);
-    std::cout << " " << genTimer.msec() << "ms\n" << std::flush;
+    if ((srcs.size() == 1) && isLL(srcs[0])) {
+      // an LLVM assembly file replaces the generated module
+	std::cout << "read llvm ..." << std::flush;
+	Timer readTimer = Timer::start();
+	if (! gContext->readModule (srcs[0])) {
+	    return true;
+	}
+	std::cout << " " << readTimer.msec() << "ms\n" << std::flush;
+    }
+    else {
+	std::cout << "read pickle ..." << std::flush;
+	Timer unpklTimer = Timer::start();
+	std::vector<CFG::comp_unit *> cus;
+	for (auto src : srcs) {
+	    asdl::file_instream inS(src);
+	    cus.push_back (CFG::comp_unit::read (inS));
+	}
+	std::cout << " " << unpklTimer.msec() << "ms\n" << std::flush;
+
+	// generate LLVM
+	std::cout << " generate llvm ..." << std::flush;;
+	Timer genTimer = Timer::start();
+	if (cus.size() == 1) {
+	    cus[0]->codegen (gContext);
+	} else {
+	    CFG::comp_unit::codegen (gContext, "bundle", cus);
+	}
+	std::cout << " " << genTimer.msec() << "ms\n" << std::flush;
+    }
 
     if (emitLLVM) {
 	gContext->dump ();
@@ -231,16 +600,16 @@ void codegen (std::string const & src, bool emitLLVM, bool dumpBits, output out)
     gContext->optimize ();
     std::cout << " " << optTimer.msec() << "ms\n" << std::flush;
 
-//    if (emitLLVM) {
-//	gContext->dump ();
-//    }
+    if (emitOptLLVM) {
+	gContext->dump ();
+    }
 
     if (! gContext->verify ()) {
 	std::cerr << "Module verified after optimization\n";
     }
 
-    // get the stem of the filename
-    std::string stem(src);
+    // get the stem of the filename; we use the first file for bundles
+    std::string stem(srcs[0]);
     auto pos = stem.rfind(".pkl");
     if (pos+4 != stem.size()) {
 	stem = "out";
@@ -249,24 +618,149 @@ void codegen (std::string const & src, bool emitLLVM, bool dumpBits, output out)
 	stem = stem.substr(0, pos);
     }
 
+  // the code-generation functions fail when the spill area of a cluster
+  // overflows its budget
+    bool failed = false;
     switch (out) {
       case output::PrintAsm:
-	gContext->dumpAsm();
+	failed = !gContext->dumpAsm();
 	break;
       case output::AsmFile:
-	gContext->dumpAsm (stem);
+	failed = !gContext->dumpAsm (stem);
 	break;
       case output::ObjFile:
-	gContext->dumpObj (stem);
+	failed = !gContext->dumpObj (stem);
 	break;
       case output::Memory: {
 	    auto obj = gContext->compile ();
+	    std::cout << " time to first code object: " << gStartupTimer.msec() << "ms\n";
+	    failed = !obj;
+	    if (obj) {
+		obj->dump(dumpBits);
+	    }
+	} break;
+      case output::Load: {
+	    auto obj = gContext->compile ();
+	    std::cout << " time to first code object: " << gStartupTimer.msec() << "ms\n";
+	    failed = !obj;
 	    if (obj) {
 		obj->dump(dumpBits);
+		smlnj::cfgcg::CodeArena arena;
+		auto code = arena.load (obj.get());
+		if (code == nullptr) {
+		    std::cerr << "cfgc: unable to load code object\n";
+		    failed = true;
+		} else {
+		    std::cout << " loaded " << code->size() << " bytes at "
+			<< code->addr() << "\n";
+		    arena.release (code);
+		}
+	    }
+	} break;
+      case output::JITLink: {
+	    auto obj = gContext->compile ();
+	    std::cout << " time to first code object: " << gStartupTimer.msec() << "ms\n";
+	    failed = !obj;
+	    if (obj) {
+		smlnj::cfgcg::CodeArena arena;
+		smlnj::cfgcg::JITLoader loader(arena);
+		auto code = loader.load (gContext);
+		if (code == nullptr) {
+		    std::cerr << "cfgc: unable to link code object: "
+			<< loader.errorMsg() << "\n";
+		    failed = true;
+		} else {
+		    std::cout << " linked " << code->size() << " bytes at "
+			<< code->addr() << "\n";
+		    for (size_t i = 0;  i < code->numEntries();  ++i) {
+			std::cout << "  entry " << i << " @ " << code->entry(i) << "\n";
+		    }
+		    loader.release (code);
+		}
 	    }
 	} break;
     }
 
     gContext->endModule();
 
+    if (gReportStats) {
+	gContext->stats().print (llvm::errs());
+    }
+
+    return failed;
+
 } /* codegen */
+
+// the number of times that each pickle is decoded when measuring decode time
+static constexpr int kDecodeRepeat = 20;
+
+// decode the pickle `data` repeatedly and return the minimum time in ms
+static double decodeTime (std::string const &data)
+{
+    double best = 0.0;
+    for (int i = 0;  i < kDecodeRepeat;  i++) {
+	Timer t = Timer::start();
+	asdl::memory_instream inS(data);
+	CFG::comp_unit *cu = CFG::comp_unit::read (inS);
+	double ms = t.msec();
+	delete cu;
+	if ((i == 0) || (ms < best)) {
+	    best = ms;
+	}
+    }
+    return best;
+}
+
+void convertPickles (std::vector<std::string> const & srcs)
+{
+    size_t totalV1 = 0, totalV2 = 0;
+    double totalT1 = 0.0, totalT2 = 0.0;
+
+    for (auto const &src : srcs) {
+	std::ifstream inS(src, std::ios_base::in | std::ios_base::binary);
+	if (! inS.good()) {
+	    std::cerr << "cfgc: unable to open \"" << src << "\"\n";
+	    continue;
+	}
+	std::ostringstream buf;
+	buf << inS.rdbuf();
+	std::string v1 = buf.str();
+
+	asdl::memory_instream v1S(v1);
+	if (v1S.version() != 1) {
+	    std::cerr << "cfgc: \"" << src << "\" is already in version "
+		<< v1S.version() << " format\n";
+	    continue;
+	}
+	v1S.begin_transcode ();
+	delete CFG::comp_unit::read (v1S);
+	std::string v2 = v1S.end_transcode ();
+
+	// the output file replaces the ".pkl" suffix with ".v2.pkl"
+	std::string dst(src);
+	auto pos = dst.rfind(".pkl");
+	if (pos+4 == dst.size()) {
+	    dst = dst.substr(0, pos);
+	}
+	dst += ".v2.pkl";
+	std::ofstream outS(dst, std::ios_base::out | std::ios_base::binary);
+	outS.write (v2.data(), v2.size());
+
+	double t1 = decodeTime (v1);
+	double t2 = decodeTime (v2);
+	std::cout << src << ": " << v1.size() << " -> " << v2.size() << " bytes; decode "
+	    << t1 << "ms -> " << t2 << "ms\n";
+
+	totalV1 += v1.size();
+	totalV2 += v2.size();
+	totalT1 += t1;
+	totalT2 += t2;
+    }
+
+    if (totalV1 > 0) {
+	std::cout << "total: " << totalV1 << " -> " << totalV2 << " bytes ("
+	    << (100.0 * double(totalV2) / double(totalV1)) << "%); decode "
+	    << totalT1 << "ms -> " << totalT2 << "ms\n";
+    }
+
+} /* convertPickles */
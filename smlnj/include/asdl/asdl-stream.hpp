@@ -15,8 +15,12 @@
 #  error do not include "asdl-stream.hpp" directly; instead include "asdl.hpp"
 #endif
 
+#include <cstdint>
 #include <istream>
 #include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern "C" {
 // failure function from SML/NJ runtime
@@ -87,10 +91,39 @@ namespace asdl {
 	std::string get_pickle () const;
     };
 
+  //! state for re-encoding a version 1 pickle in the version 2 format while
+  //! it is being read (see `instream::begin_transcode`)
+    struct transcoder {
+	std::string body;				//!< the encoded body of the pickle
+	std::vector<std::string> strings;		//!< the string table
+	std::unordered_map<std::string, unsigned int> index; //!< map from strings to
+							     //!  their index in `strings`
+	int suspended;					//!< when non-zero, bytes read from
+							//!  the input are not copied to `body`
+    };
+
   //! ASDL input stream
+  //
+  // Input streams support two encodings.  The original (version 1) encoding
+  // is a direct serialization of the pickled values.  The version 2 encoding
+  // is identified by a header (`V2_MAGIC` followed by the version number)
+  // and differs from version 1 in the following ways:
+  //
+  //   - the header is followed by a table of the distinct strings in the
+  //     pickle (a count followed by version 1 strings); strings in the
+  //     body of the pickle are encoded as indices into the table.
+  //
+  //   - primitive values that are encoded relative to a base value (i.e.,
+  //     CFG lambda variables) are written as zig-zag encoded signed deltas
+  //     from the base, which their reader updates (see `set_base`).
+  //
+  // The encoding is detected when a file or memory stream is created; the
+  // generic `instream` constructor always assumes version 1.
     class instream {
       public:
-	explicit instream (std::istream *is) : _is(is) { }
+	explicit instream (std::istream *is)
+	  : _is(is), _pos(0), _version(1), _base(0), _echo(nullptr)
+	{ }
 
       // no copying allowed!
 	instream (instream const &) = delete;
@@ -98,15 +131,27 @@ namespace asdl {
 
       // move operations
 	instream (instream &&is) noexcept
+	  : _is(is._is), _buf(std::move(is._buf)), _pos(is._pos),
+	    _version(is._version), _strings(std::move(is._strings)),
+	    _base(is._base), _echo(is._echo)
 	{
-	    this->_is = is._is;
 	    is._is = nullptr;
+	    is._echo = nullptr;
 	}
 	instream &operator= (instream &&rhs) noexcept
 	{
 	    if (this != &rhs) {
+		delete this->_is;
+		delete this->_echo;
 		this->_is = rhs._is;
+		this->_buf = std::move(rhs._buf);
+		this->_pos = rhs._pos;
+		this->_version = rhs._version;
+		this->_strings = std::move(rhs._strings);
+		this->_base = rhs._base;
+		this->_echo = rhs._echo;
 		rhs._is = nullptr;
+		rhs._echo = nullptr;
 	    }
 	    return *this;
 	}
@@ -116,33 +161,87 @@ namespace asdl {
 	    if (this->_is != nullptr) {
 		delete this->_is;
 	    }
+	    if (this->_echo != nullptr) {
+		delete this->_echo;
+	    }
 	}
 
 	char getc ()
 	{
-	    if (this->_is->good())
-		return this->_is->get();
-/* LLVM uses the -fno-exceptions flag, so this code doesn't compile */
-#ifdef XXX
-	    throw std::ios_base::failure("decode error");
-#else
-	    Die ("ASDL decode error");
-#endif
+	    return static_cast<char>(this->getb());
 	}
 	unsigned char getb ()
 	{
-	    if (this->_is->good())
-		return static_cast<unsigned char>(this->_is->get());
+	    unsigned char b;
+	    if (this->_pos < this->_buf.size()) {
+		b = static_cast<unsigned char>(this->_buf[this->_pos++]);
+	    }
+	    else if ((this->_is != nullptr) && this->_is->good()) {
+		b = static_cast<unsigned char>(this->_is->get());
+	    }
+	    else {
 /* LLVM uses the -fno-exceptions flag, so this code doesn't compile */
 #ifdef XXX
-	    throw std::ios_base::failure("decode error");
+		throw std::ios_base::failure("decode error");
 #else
-	    Die ("ASDL decode error");
+		Die ("ASDL decode error");
 #endif
+	    }
+	    if ((this->_echo != nullptr) && (this->_echo->suspended == 0)) {
+		this->_echo->body.push_back(static_cast<char>(b));
+	    }
+	    return b;
 	}
 
+      //! the encoding version of the input (1 or 2)
+	unsigned int version () const { return this->_version; }
+
+      //! return the i'th entry in the string table of a version 2 pickle
+	std::string const &string_at (unsigned int i) const
+	{
+	    if (i < this->_strings.size()) {
+		return this->_strings[i];
+	    }
+	    Die ("ASDL decode error: invalid string index %u", i);
+	}
+
+      //! the base value for delta-encoded values
+	int64_t base () const { return this->_base; }
+
+      //! set the base value for delta-encoded values.  This function must be
+      //! called at the same points in the input when reading a version 1 pickle
+      //! that is being transcoded and when reading the resulting version 2 pickle,
+      //! which is the case when it is only called by the readers of the
+      //! delta-encoded values.
+	void set_base (int64_t b) { this->_base = b; }
+
+      //! start re-encoding a version 1 input in the version 2 format.  This
+      //! function must be called before any of the pickle has been read.
+	void begin_transcode ();
+
+      //! finish re-encoding the input and return the version 2 pickle
+	std::string end_transcode ();
+
+      //! the transcoder state; nullptr if the input is not being transcoded
+	transcoder *echo () const { return this->_echo; }
+
+      //! the magic prefix of the header for version 2 (and later) pickles.  The
+      //! first byte of a version 1 pickle cannot be 0xff for any input
+      //! whose first value is a string, since that would specify a length
+      //! greater than 2^30.
+	static constexpr char V2_MAGIC[4] = { '\xff', 'A', 'S', 'D' };
+
       protected:
-	std::istream *_is;
+	std::istream *_is;		//!< the underlying stream; nullptr for buffered input
+	std::string _buf;		//!< buffered input data
+	size_t _pos;			//!< position of the next byte in `_buf`
+	unsigned int _version;		//!< the encoding version
+	std::vector<std::string> _strings; //!< the string table for version 2 input
+	int64_t _base;			//!< the base for delta-encoded values
+	transcoder *_echo;		//!< re-encoding state
+
+      //! initialize buffered input from `data` and check for a version 2 header
+	void _init (std::string &&data);
     };
 
   //! ASDL file instream
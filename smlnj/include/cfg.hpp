@@ -403,6 +403,8 @@ namespace CFG_Prim {
         // pickler method suppressed
         static arith * read (asdl::instream & is);
         virtual llvm::Value *codegen (smlnj::cfgcg::Context *cxt, Args_t const &args) = 0;
+        /// does the operation generate an overflow check?
+        bool checksOverflow ();
 
       protected:
         enum _tag_t {_con_ARITH = 1, _con_FLOAT_TO_INT};
@@ -511,6 +513,9 @@ namespace CFG_Prim {
         // pickler method suppressed
         static pure * read (asdl::instream & is);
         virtual llvm::Value *codegen (smlnj::cfgcg::Context *cxt, Args_t const &args) = 0;
+        /// can the operation be evaluated speculatively (i.e., it cannot trap
+        /// or access memory)?
+        bool canSpeculate ();
 
       protected:
         enum _tag_t {
@@ -1286,6 +1291,9 @@ namespace CFG {
         static exp * read (asdl::instream & is);
         virtual llvm::Value *codegen (smlnj::cfgcg::Context *cxt) = 0;
 	bool isLABEL () { return (this->_tag == _con_LABEL); }
+	/// can the expression be evaluated speculatively (i.e., it cannot trap
+	/// or access memory)?
+	bool canSpeculate ();
 
 
       protected:
@@ -1531,6 +1539,8 @@ namespace CFG {
         virtual void init (smlnj::cfgcg::Context *cxt, bool blkEntry) = 0;
         virtual void codegen (smlnj::cfgcg::Context *cxt) = 0;
         llvm::BasicBlock *bb () { return this->_bb; }
+	bool isLET () { return (this->_tag == _con_LET); }
+	bool isARITH () { return (this->_tag == _con_ARITH); }
 
 
       protected:
@@ -1892,6 +1902,10 @@ namespace CFG {
         std::vector<exp *> _v1;
         param * _v2;
         stm * _v3;
+
+        /// can the overflow check for this operation be merged with the check for
+        /// the next arithmetic operation in the continuation?
+        bool _canDeferOverflowCheck ();
     };
     class SETTER : public stm {
       public:
@@ -2234,8 +2248,14 @@ namespace CFG {
             this->_v_fns = v;
         }
         void codegen (smlnj::cfgcg::Context *cxt);
+        static void codegen (
+            smlnj::cfgcg::Context *cxt,
+            std::string const &name,
+            std::vector<comp_unit *> const &units);
 
       private:
+        void _codegenClusters (smlnj::cfgcg::Context *cxt);
+
         std::string _v_srcFile;
         cluster * _v_entry;
         std::vector<cluster *> _v_fns;
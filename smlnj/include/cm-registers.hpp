@@ -109,6 +109,9 @@ class CMRegs {
 };
 
 /// The CMRegState tracks a mapping from CMachine registers to LLVM values.
+/// For stack-allocated registers, the value is a cached copy of the register's
+/// memory location (or `nullptr` if the register has not been loaded) and we
+/// track which cached values have been modified and must be written back.
 ///
 class CMRegState {
   public:
@@ -130,6 +133,23 @@ class CMRegState {
         this->_val[static_cast<int>(r)] = v;
     }
 
+    /// is the cached value of a stack-allocated register different from its
+    /// value in memory?
+    bool isDirty (CMRegId r) const
+    {
+        return (this->_dirty & (1 << static_cast<int>(r))) != 0;
+    }
+
+    /// mark the cached value of a stack-allocated register as modified
+    void setDirty (CMRegId r) { this->_dirty |= (1 << static_cast<int>(r)); }
+
+    /// mark the cached value of a stack-allocated register as being in sync
+    /// with memory
+    void clearDirty (CMRegId r) { this->_dirty &= ~(1 << static_cast<int>(r)); }
+
+    /// mark all cached values as being in sync with memory
+    void clearDirty () { this->_dirty = 0; }
+
     /// get the LLVM value of the base-address pointer
     llvm::Value *getBasePtr () const { return this->_basePtr; }
 
@@ -144,6 +164,13 @@ class CMRegState {
     void clearBasePtr () { this->_basePtr = nullptr; }
 #endif
 
+    /// get the value of the allocation pointer on entry to the current fragment
+    /// (or after the last GC call)
+    llvm::Value *getEntryAllocPtr () const { return this->_entryAllocPtr; }
+
+    /// record the current value of the allocation pointer as its entry value
+    void setEntryAllocPtr () { this->_entryAllocPtr = this->get (CMRegId::ALLOC_PTR); }
+
     void copyFrom (CMRegState const & cache);
 
   private:
@@ -152,6 +179,11 @@ class CMRegState {
                                                 ///  labels
     llvm::Value * _val[CMRegInfo::NUM_REGS];    ///< mapping from registers IDs to their
                                                 ///  current representation as an LLVM value.
+    unsigned int _dirty;                        ///< bit mask of the stack-allocated registers
+                                                ///  whose cached values must be written back
+    llvm::Value * _entryAllocPtr;               ///< the value of ALLOC_PTR on entry to the
+                                                ///  current fragment; used to avoid redundant
+                                                ///  prefetches
 };
 
 /// initialize the static register information for the target
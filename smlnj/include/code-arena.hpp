@@ -0,0 +1,149 @@
+/// \file code-arena.hpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief This file defines the `CodeArena` class, which manages executable
+///        memory for code objects that are loaded into the running process.
+///
+
+#ifndef _CODE_ARENA_HPP_
+#define _CODE_ARENA_HPP_
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Memory.h"
+
+#include <vector>
+
+namespace smlnj {
+namespace cfgcg {
+
+class CodeObject;
+
+/// \brief An arena of executable memory for in-process code objects.
+///
+/// The arena allocates memory from the operating system in large chunks
+/// and packs code objects densely into them, respecting the alignment
+/// requirements of the objects' sections.  Pages are kept read+execute
+/// except while code is being copied into them (W^X).  A chunk is returned
+/// to the operating system once all of the code objects that were loaded
+/// into it have been released.
+///
+/// Note that this class is not thread safe and that code that lives in the
+/// same pages as a new object must not be running while that object is
+/// being loaded, since the pages are temporarily made non-executable.
+//
+class CodeArena {
+    struct Chunk;
+
+  public:
+
+    /// default size of an arena chunk (2Mb, which is the size of a huge page
+    /// on both x86-64 and AArch64 Linux)
+    static constexpr size_t kDefaultChunkSzb = 2 * 1024 * 1024;
+
+    /// a code object that has been loaded into the arena
+    class Code {
+      public:
+        /// the address of the first byte of code
+        void *addr () const { return this->_addr; }
+
+        /// the size of the code in bytes
+        size_t size () const { return this->_szb; }
+
+      private:
+        Chunk *_chunk;          ///< the chunk that holds the code
+        void *_addr;            ///< the address of the code
+        size_t _szb;            ///< the size of the code
+
+        Code (Chunk *chunk, void *addr, size_t szb)
+          : _chunk(chunk), _addr(addr), _szb(szb)
+        { }
+
+        friend class CodeArena;
+    };
+
+    /// create an empty arena
+    /// \param chunkSzb   the size of the chunks that are allocated for the arena;
+    ///                   this value is rounded up to a multiple of the page size.
+    /// \param hugePages  when true, request that chunks be backed by transparent
+    ///                   huge pages (where supported by the host system).
+    explicit CodeArena (size_t chunkSzb = kDefaultChunkSzb, bool hugePages = false);
+
+    CodeArena (CodeArena const &) = delete;
+    CodeArena &operator= (CodeArena const &) = delete;
+
+    /// the destructor unmaps all of the arena's memory
+    ~CodeArena ();
+
+    /// \brief copy the code from a code object into the arena, while applying
+    ///        relocation patches, and make it executable.
+    /// \param obj  the code object to load
+    /// \return a handle for the loaded code, or nullptr if memory could not
+    ///         be allocated or protected.
+    Code *load (CodeObject *obj);
+
+    /// \brief reserve space in the arena for code that is produced by some
+    ///        other means (e.g., the `JITLoader`).  The memory is executable,
+    ///        but its contents are undefined until `initialize` is called.
+    /// \param szb    the size of the code in bytes
+    /// \param align  the required alignment of the code in bytes (a power of 2)
+    /// \return a handle for the reserved memory, or nullptr if memory could not
+    ///         be allocated.
+    Code *reserve (size_t szb, size_t align);
+
+    /// \brief initialize reserved code by calling `init` on its address while
+    ///        the memory is writable, and then make the memory executable.
+    /// \return true on success
+    bool initialize (Code *code, llvm::function_ref<void(unsigned char *)> init);
+
+    /// release a loaded code object.  The handle is invalid after this call.
+    void release (Code *code);
+
+    /// the number of chunks currently allocated to the arena
+    size_t numChunks () const { return this->_chunks.size(); }
+
+    /// the number of code objects that are currently loaded
+    size_t numLive () const { return this->_nLive; }
+
+    /// the total number of code bytes (not including alignment padding)
+    /// in the loaded code objects
+    size_t bytesInUse () const { return this->_nBytesInUse; }
+
+    /// the total number of bytes mapped for the arena
+    size_t bytesMapped () const;
+
+  private:
+    /// a contiguous region of mapped memory
+    struct Chunk {
+        llvm::sys::MemoryBlock mem;     ///< the mapped memory
+        unsigned char *base;            ///< the start of the usable memory
+        size_t szb;                     ///< the size of the usable memory
+        size_t used;                    ///< the number of bytes allocated so far
+        size_t nLive;                   ///< number of live code objects in the chunk
+    };
+
+    size_t _pageSzb;                    ///< the host page size
+    size_t _chunkSzb;                   ///< the default chunk size
+    bool _hugePages;                    ///< true if we are requesting huge pages
+    Chunk *_current;                    ///< the chunk we are currently allocating from
+    std::vector<Chunk *> _chunks;       ///< all of the allocated chunks
+    size_t _nLive;                      ///< the total number of live code objects
+    size_t _nBytesInUse;                ///< the bytes allocated to live code objects
+
+    /// allocate a new chunk of at least `szb` bytes; returns nullptr on failure
+    Chunk *_newChunk (size_t szb);
+
+    /// unmap a chunk and remove it from the list of chunks
+    void _freeChunk (Chunk *chunk);
+
+    /// set the protection for the pages that cover the range [addr, addr+szb)
+    /// of the given chunk.  Returns true on success.
+    bool _protect (Chunk *chunk, unsigned char *addr, size_t szb, unsigned flags);
+
+};
+
+} // namespace cfgcg
+} // namespace smlnj
+
+#endif // !_CODE_ARENA_HPP_
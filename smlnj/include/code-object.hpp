@@ -140,6 +140,10 @@ public:
     CodeObject () = delete;
     CodeObject (CodeObject &) = delete;
 
+    /// the last word of a symbol-free module's entry table (see
+    /// `Context::entryTable`), which marks the end of the table ("SMLE")
+    static constexpr uint32_t kEntryTableMagic = 0x454c4d53;
+
     virtual ~CodeObject ();
 
     /// create a code object.
@@ -148,13 +152,39 @@ public:
     /// return the size of the code in bytes
     size_t size() const { return this->_szb; }
 
+    /// return the required alignment (in bytes) of the code, which is the maximum
+    /// alignment of the included sections
+    size_t alignment() const { return this->_align; }
+
+    /// return the number of entry points in the code object; this is the number
+    /// of comp_units that were compiled into the module.
+    size_t numEntries () const { return this->_entryOffsets.size(); }
+
+    /// return the offset (in bytes) of the i'th entry point from the start of
+    /// the code object.  For a single comp_unit, the entry is at offset 0.
+    uint64_t entryOffset (size_t i) const { return this->_entryOffsets[i]; }
+
+    /// return the offset (in bytes) of the sled table from the start of the code
+    /// object, or -1 if the code object does not have entry sleds (see
+    /// `Context::setEntrySleds`).
+    int64_t sledTableOffset () const { return this->_sledTblOffset; }
+
+    /// return the number of entry sleds in the code object
+    size_t numSleds () const { return this->_sledOffsets.size(); }
+
+    /// return the offset (in bytes) of the i'th entry sled from the start of
+    /// the code object.  The runtime enables tracing for the function by
+    /// overwriting the sled with a call to its trampoline.
+    uint64_t sledOffset (size_t i) const { return this->_sledOffsets[i]; }
+
     /// \brief copy the code into the given memory buffer while applying the
     ///        relocation patches.
     /// \param code  points to the destination address for the code; this memory
     ///              is assumed to be at least this->size() bytes.
     void getCode (unsigned char *code);
 
-    /// dump information about the code object to the LLVM debug stream.
+    /// dump information about the code object to the LLVM debug stream.  The
+    /// entry sleds are printed with the first few bytes of their code.
     void dump (bool bits);
 
     /// find a section by name
@@ -190,17 +220,35 @@ public:
     /// the size of the heap-allocated code object in bytes
     size_t _szb;
 
+    /// the alignment of the heap-allocated code object in bytes
+    size_t _align;
+
     /// a vector of the sections that are to be included in the heap-allocated code
     /// object.
     std::vector<Section> _sects;
     Section *_last;                     ///< cache of last result returned by the
                                         ///  `findSection` method.
 
+    /// the offsets of the entry functions in the heap-allocated code object
+    std::vector<uint64_t> _entryOffsets;
+
+    /// the offset of the sled table in the heap-allocated code object (-1 if
+    /// there is no table)
+    int64_t _sledTblOffset;
+
+    /// the offsets of the entry sleds in the heap-allocated code object
+    std::vector<uint64_t> _sledOffsets;
+
+    /// true if the object file is known to have no relocations, in which case
+    /// `getCode` just copies the sections
+    bool _relocFree;
+
     /// constuctor
     CodeObject (
 	const TargetInfo *target,
 	std::unique_ptr<llvm::object::ObjectFile> objFile
-    ) : _tgt(target), _obj(std::move(objFile)), _szb(0), _last(nullptr)
+    ) : _tgt(target), _obj(std::move(objFile)), _szb(0), _align(1), _last(nullptr),
+        _sledTblOffset(-1), _relocFree(false)
     { }
 
     /// helper function that determines which sections to include and computes
@@ -211,6 +259,22 @@ public:
     //
     void _computeSize ();
 
+    /// helper function that returns the offset of the named symbol relative to
+    /// the start of the code object, or -1 if the symbol is not defined in one
+    /// of the included sections.
+    int64_t _symbolOffset (llvm::StringRef name);
+
+    /// helper function that reads the sled table (if any) from the object file
+    void _readSledTable (class Context *codeBuf);
+
+    /// helper function that reads the sled offsets from the sled table at the
+    /// given offset in the code object
+    void _readSledOffsets (int64_t tblOffset);
+
+    /// helper function that reads the entry offsets (and the sled table) from
+    /// the entry table of a symbol-free object file (see `Context::entryTable`)
+    void _readEntryTable ();
+
     /// should a section be included in the SML data object?
     //
     bool _includeSect (llvm::object::SectionRef const &sect)
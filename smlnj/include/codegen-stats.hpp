@@ -0,0 +1,153 @@
+/// \file codegen-stats.hpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief This file defines the `CodeGenStats` class, which collects statistics
+///        about code generation.
+///
+
+#ifndef _CODEGEN_STATS_HPP_
+#define _CODEGEN_STATS_HPP_
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace smlnj {
+namespace cfgcg {
+
+/// accumulated timing for an LLVM pass (times are in seconds).  If a pass
+/// occurs more than once in a pipeline, then the times are summed.
+//
+struct PassTiming {
+    std::string name;           ///< the pass's command-line name (e.g., "instcombine")
+    unsigned int count;         ///< the number of pipeline runs that included the
+                                ///  pass (counting each occurrence in a pipeline)
+    double wallTime;            ///< elapsed wall-clock time
+    double userTime;            ///< user CPU time
+    double sysTime;             ///< system CPU time
+};
+
+/// the size of the spill area for a cluster (i.e., the stack-frame size of the
+/// cluster's LLVM function).
+//
+struct SpillArea {
+    std::string name;           ///< the name of the cluster's function
+    unsigned int szb;           ///< the number of bytes of spill slots
+};
+
+/// the per-pass timers of a pipeline.  The timers belong to a single context,
+/// so contexts that run on different threads do not share timers.  The passes
+/// of the IR optimization pipeline are timed by name (see `timer`), while the
+/// passes of the code-generation pipeline are timed by instance, which is done
+/// by making the object the thread's pass-timer source while the pipeline runs.
+//
+class PassTimers : public llvm::PassTimerSource {
+  public:
+
+    /// create an empty set of timers
+    /// \param name  the name of the timer group for the timers
+    /// \param desc  the description of the timer group
+    PassTimers (char const *name, char const *desc);
+
+    PassTimers (PassTimers const &) = delete;
+    PassTimers &operator= (PassTimers const &) = delete;
+
+    ~PassTimers ();
+
+    /// get the timer for the named pass, creating it if necessary
+    llvm::Timer *timer (llvm::StringRef name);
+
+    /// get the timer for an instance of a legacy pass, which is named by the
+    /// pass's command-line name (or its description, if it does not have one)
+    llvm::Timer *getPassTimer (llvm::Pass *pass) override;
+
+    /// add the times of the timers that have run to `passes` and then
+    /// delete the timers.
+    void collect (std::vector<PassTiming> &passes);
+
+  private:
+    llvm::TimerGroup _group;                            ///< the timers' group
+    std::vector<std::unique_ptr<llvm::Timer>> _timers;  ///< the timers
+    llvm::StringMap<llvm::Timer *> _byName;             ///< the named timers
+    llvm::DenseMap<llvm::Pass *, llvm::Timer *> _byPass;///< the legacy-pass timers
+
+};
+
+/// statistics about code generation for a `Context`.  The statistics are
+/// accumulated over the modules compiled by the context until `clear` is called.
+//
+class CodeGenStats {
+  public:
+
+    CodeGenStats () { this->clear(); }
+
+    /// reset the statistics
+    void clear ();
+
+    /// print the statistics
+    void print (llvm::raw_ostream &os) const;
+
+    unsigned int numModules;    ///< the number of modules compiled to machine code
+    double optimizeTime;        ///< wall-clock time (in seconds) spent in the IR
+                                ///  optimization pipeline
+    double codegenTime;         ///< wall-clock time (in seconds) spent in the
+                                ///  machine-code generation pipeline
+    size_t objectSzb;           ///< the total size (in bytes) of the generated
+                                ///  object files
+    unsigned int numOverflowChecks; ///< the number of overflow-check branches
+                                ///  generated for trapping arithmetic
+    unsigned int numMergedOverflowChecks; ///< the number of overflow checks that
+                                ///  were eliminated by combining the checks for
+                                ///  chains of trapping arithmetic operations
+    unsigned int numOutlinedFunctions; ///< the number of functions created by the
+                                ///  machine outliner (see `Context::setOptimizeForSize`)
+    unsigned int numMachineInstrs; ///< the number of machine instructions emitted
+                                ///  by the assembly printer
+    unsigned int numSpills;     ///< the number of spill instructions inserted by the
+                                ///  register allocator (including spills that were
+                                ///  folded into other instructions)
+    unsigned int numReloads;    ///< the number of reload instructions inserted by the
+                                ///  register allocator (including folded reloads)
+    unsigned int numRABudgetFallbacks; ///< the number of functions that exceeded the
+                                ///  register-allocation budget (see
+                                ///  `Context::setJWARegAlloc`)
+    unsigned int maxSpillAreaSzb; ///< the high-water mark of the cluster spill areas
+    unsigned int numSpillBudgetErrors; ///< the number of clusters whose spill area
+                                ///  exceeded the target's budget (see
+                                ///  `TargetInfo::spillAreaSzb`)
+
+    /// the clusters that use spill slots, with their spill-area sizes
+    std::vector<SpillArea> spillAreas;
+
+    /// per-pass timing for the IR optimization pipeline; this information is
+    /// only collected when pass timing is enabled.
+    std::vector<PassTiming> irPasses;
+
+    /// per-pass timing for the machine-code generation pipeline; this information
+    /// is only collected when pass timing is enabled.
+    std::vector<PassTiming> mcPasses;
+
+    /// create an LLVM diagnostic handler for these statistics.  Spill areas that
+    /// exceed their budget are reported on the standard error and counted in
+    /// `numSpillBudgetErrors`.  When `remarks` is true, the handler also asks
+    /// for the analysis remarks that carry the register allocator's spill and
+    /// reload counts, the spill-area sizes, and the number of machine
+    /// instructions, and records them.  Other diagnostics are passed on to
+    /// LLVM's default handling.
+    std::unique_ptr<llvm::DiagnosticHandler> diagnosticHandler (bool remarks);
+
+};
+
+} // namespace cfgcg
+} // namespace smlnj
+
+#endif // !_CODEGEN_STATS_HPP_
@@ -0,0 +1,111 @@
+/// \file context-pool.hpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief This file defines the `ContextPool` class, which caches code-generation
+///        contexts for multiple targets.
+///
+
+#ifndef _CONTEXT_POOL_HPP_
+#define _CONTEXT_POOL_HPP_
+
+#include "llvm/Support/CodeGen.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace smlnj {
+namespace cfgcg {
+
+class Context;
+
+/// \brief A pool of `Context` objects keyed by target, CPU, features, and
+///        optimization level.
+///
+/// Creating a `Context` is expensive (it builds a `TargetMachine`, an `MCGen`
+/// object, and the cached LLVM types), so workloads that switch between
+/// targets should acquire their contexts from a pool instead of creating
+/// and deleting them.  A context that has been acquired is owned by the
+/// acquiring thread until it is released back to the pool; since a `Context`
+/// is an `LLVMContext`, it must not be used by more than one thread at a time.
+/// Several threads may hold contexts with the same key, in which case the pool
+/// holds one context per thread.
+///
+/// The pool holds at most `capacity` idle contexts; when that limit is
+/// exceeded, the least-recently-used idle context is deleted.  Contexts that
+/// are in use are never evicted.
+///
+/// Note that per-context settings (e.g., the allocation-prefetch distance) are
+/// reset to their defaults when a context is returned to the pool (see
+/// `Context::resetSettings`), so a context that is acquired from the pool
+/// always has the same settings as a newly created one.
+//
+class ContextPool {
+  public:
+
+    /// create an empty pool
+    /// \param capacity  the maximum number of idle contexts held by the pool
+    explicit ContextPool (size_t capacity);
+
+    ContextPool (ContextPool const &) = delete;
+    ContextPool &operator= (ContextPool const &) = delete;
+
+    /// the destructor deletes all of the pooled contexts, including those that
+    /// have been acquired but not released.
+    ~ContextPool ();
+
+    /// acquire a context for the calling thread
+    /// \param target    the name of the target architecture
+    /// \param cpu       the LLVM name of the target CPU
+    /// \param features  the LLVM target-features string
+    /// \param optLvl    the code-generation optimization level
+    /// \return the context or nullptr if the target is not supported
+    Context *acquire (
+        std::string const &target,
+        std::string const &cpu = "generic",
+        std::string const &features = "",
+        llvm::CodeGenOpt::Level optLvl = llvm::CodeGenOpt::Less);
+
+    /// release a context back to the pool.  The context must have been acquired
+    /// by the calling thread and must not have a module in progress.
+    void release (Context *cxt);
+
+    /// the number of contexts (idle and in use) that are held by the pool
+    size_t size () const;
+
+    /// the number of contexts that have been created by the pool
+    size_t numCreated () const { return this->_nCreated; }
+
+    /// the number of acquire requests that were satisfied by an idle context
+    size_t numHits () const { return this->_nHits; }
+
+  private:
+    struct Entry {
+        std::string target;             ///< the target name
+        std::string cpu;                ///< the target CPU
+        std::string features;           ///< the target features
+        llvm::CodeGenOpt::Level optLvl; ///< the optimization level
+        Context *cxt;                   ///< the pooled context
+        bool inUse;                     ///< true if the context has been acquired
+        std::thread::id owner;          ///< the owning thread when `inUse` is true
+    };
+
+    mutable std::mutex _mu;             ///< lock that protects the pool state
+    size_t _capacity;                   ///< maximum number of idle contexts
+    std::list<Entry> _entries;          ///< the entries in most-recently-used order
+    size_t _nCreated;                   ///< number of contexts created
+    size_t _nHits;                      ///< number of pool hits
+
+    /// evict least-recently-used idle contexts until we are within capacity;
+    /// the lock must be held.
+    void _evict ();
+
+};
+
+} // namespace cfgcg
+} // namespace smlnj
+
+#endif // !_CONTEXT_POOL_HPP_
@@ -25,6 +25,7 @@
 #include "llvm/IR/Function.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CodeGen.h"
 
 /*DEBUG*/#include "llvm/Support/raw_os_ostream.h"
 /*DEBUG*/#include "llvm/Support/Debug.h"
@@ -32,6 +33,7 @@
 #include "lambda-var.hpp"
 #include "cm-registers.hpp"
 #include "code-object.hpp"
+#include "codegen-stats.hpp"
 #include "objfile-pwrite-stream.hpp"
 
 using Types_t = std::vector<llvm::Type *>;
@@ -77,15 +79,59 @@ class Context : public llvm::LLVMContext {
     /// \param target specifies the target architecture
     static Context *create (const TargetInfo * target);
 
+    /// static function for creating the code buffer for the given target with
+    /// a specific CPU, feature string, and optimization level
+    /// \param target    specifies the target architecture
+    /// \param cpu       the LLVM name of the target CPU (e.g., "generic")
+    /// \param features  the LLVM target-features string (e.g., "+avx2")
+    /// \param optLvl    the code-generation optimization level
+    static Context *create (
+        const TargetInfo * target,
+        std::string const &cpu,
+        std::string const &features,
+        llvm::CodeGenOpt::Level optLvl);
+
+    ~Context ();
+
     /// static function for creating the code buffer for the given target
     /// \param target specifies the target architecture
     static Context *create (std::string const & target);
 
+    /// run the IR optimization pipeline over the current module
     void optimize ();
 
+    /// set the IR optimization pipeline to the given sequence of passes, which
+    /// are specified by their LLVM command-line names (e.g., "instcombine").
+    /// The pipeline takes effect at the next call to `beginModule`.
+    /// \return false if one of the passes is not supported
+    bool setOptPipeline (std::vector<std::string> const &passes);
+
+    /// get the current IR optimization pipeline
+    std::vector<std::string> const &optPipeline () const;
+
+    /// the default IR optimization pipeline
+    static std::vector<std::string> const &defaultOptPipeline ();
+
+    /// the names of the passes that may be used in an optimization pipeline
+    static std::vector<std::string> availableOptPasses ();
+
+    /// use GlobalISel for instruction selection in this context.  This setting
+    /// only applies to the AArch64 target and takes effect for the next module.
+    /// Functions that GlobalISel cannot handle are compiled using SelectionDAG.
+    void setGlobalISel (bool enable);
+
+    /// is GlobalISel enabled for this context?
+    bool globalISelEnabled () const;
+
     /// initialize the code buffer for a new module
     void beginModule (std::string const & src, int nClusters);
 
+    /// start generating code for another comp_unit in the current module; this
+    /// resets the label-to-cluster map, since labels are only unique within a
+    /// comp_unit.  It is used when a bundle of comp_units is compiled into a
+    /// single module.
+    void beginUnit (int nClusters);
+
     /// finish up LLVM code generation for the module
     void completeModule ();
 
@@ -98,6 +144,13 @@ class Context : public llvm::LLVMContext {
     /// return the current module
     llvm::Module *module () { return this->_module; }
 
+    /// the entry functions of the current module in the order in which they
+    /// were defined (there is one per comp_unit in the module)
+    std::vector<llvm::Function *> const &entryFunctions () const
+    {
+        return this->_entryFns;
+    }
+
     /// set the current cluster (during preperation for code generation)
     void setCluster (CFG::cluster *cluster) { this->_curCluster = cluster; }
 
@@ -113,7 +166,7 @@ class Context : public llvm::LLVMContext {
     llvm::IRBuilder<> & build () { return this->_builder; }
 
     /// define a new LLVM function for a cluster with the given type; the `isFirst` flag
-    /// should be true for the entry function of the module.
+    /// should be true for the entry function of a comp_unit.
     llvm::Function *newFunction (llvm::FunctionType *fnTy, std::string const &name, bool isFirst);
 
     /// create a function type from a vector of parameter types.  This function adds
@@ -136,32 +189,169 @@ class Context : public llvm::LLVMContext {
     /// setup the parameter lists for a fragment
     void setupFragEntry (CFG::frag *frag, std::vector<llvm::PHINode *> &phiNodes);
 
-    /// get the LLVM value that represents the specified SML register
+    /// get the LLVM value that represents the specified SML register.  Stack-allocated
+    /// registers are loaded on their first use in a fragment and then cached.
     llvm::Value *mlReg (CMRegId r)
     {
         llvm::Value *reg = this->_regState.get(r);
         if (reg == nullptr) {
-            return this->_loadMemReg(r);
-        } else {
-            return reg;
+            reg = this->_loadMemReg(r);
+            this->_regState.set(r, reg);
         }
+        return reg;
     }
 
-    /// assign a value to an SML register
+    /// assign a value to an SML register.  For stack-allocated and pinned
+    /// registers, the store is deferred until the next call to `writeBackMemRegs`.
     void setMLReg (CMRegId r, llvm::Value *v)
     {
-        llvm::Value *reg = this->_regState.get(r);
-        if (reg == nullptr) {
-            return this->_storeMemReg(r, v);
+        if (this->_regInfo.info(r)->isMemReg()) {
+            this->_regState.set(r, this->asMLValue(v));
+            this->_regState.setDirty(r);
+        } else if (this->_pinnedRegs) {
+            this->_regState.set(r, v);
+            this->_regState.setDirty(r);
         } else {
             this->_regState.set(r, v);
         }
     }
 
+    /// write back the modified values of the stack-allocated and pinned registers.  This
+    /// must be done before any control transfer that leaves the current fragment
+    /// (i.e., JWA calls, GOTOs, GC calls, and the overflow trap).
+    void writeBackMemRegs ();
+
     /// save and restore the CM register state to a cache object
     void saveSMLRegState (CMRegState & cache) { cache.copyFrom (this->_regState); }
     void restoreSMLRegState (CMRegState const & cache) { this->_regState.copyFrom (cache); }
 
+    /// set the distance (in bytes) ahead of the allocation pointer at which to
+    /// issue a write prefetch; a distance of zero disables prefetching.  The
+    /// target's `allocPrefetchSzb` is a reasonable default.
+    void setAllocPrefetch (unsigned int nb) { this->_allocPrefetchSzb = nb; }
+
+    /// return the allocation-prefetch distance (zero when disabled)
+    unsigned int allocPrefetch () const { return this->_allocPrefetchSzb; }
+
+    /// override the sequence of integer argument registers for the JWA calling
+    /// convention in subsequent modules, which lets us evaluate register
+    /// assignments without rebuilding LLVM.  The registers are specified by their
+    /// LLVM names and must be distinct members of the target's default sequence
+    /// (see `TargetInfo::jwaRegisters`); arguments beyond the given registers
+    /// are assigned from the default sequence.  An empty sequence restores the
+    /// default.  Note that the runtime system's assembly code assumes the
+    /// default assignment, so this setting is only useful for experiments.
+    /// \return false if the sequence is invalid or the target does not support
+    ///         overriding the sequence, in which case the setting is unchanged.
+    bool setJWARegisters (std::vector<std::string> const &regs);
+
+    /// the current JWA register sequence (empty for the default)
+    std::vector<std::string> const &jwaRegisters () const { return this->_jwaRegs; }
+
+    /// enable or disable pinning the hardware CMachine registers (ALLOC_PTR,
+    /// LIMIT_PTR, and STORE_PTR; plus EXN_HNDLR and VAR_PTR on aarch64) for
+    /// subsequent modules.  When the registers are pinned, LLVM reserves their
+    /// hardware registers in JWA functions and we access them with the
+    /// `llvm.read_register` and `llvm.write_register` intrinsics, instead of
+    /// passing them as extra arguments and threading them through PHI nodes
+    /// and GC calls.  The other arguments are assigned to the same hardware
+    /// registers in either mode, so code that is compiled with pinned registers
+    /// can be mixed with code that is not.  This setting must not be changed
+    /// while a module is being generated.
+    void setPinnedRegs (bool enable);
+
+    /// are the hardware CMachine registers pinned?
+    bool pinnedRegs () const { return this->_pinnedRegs; }
+
+    /// enable or disable optimizing for code size.  When enabled, the functions
+    /// of subsequent modules are marked `minsize`, which makes instruction
+    /// selection favor smaller code and enables the machine outliner, which
+    /// replaces repeated instruction sequences (e.g., heap-limit checks and
+    /// GC-call setup) with calls to shared code.  This mode is intended for
+    /// large code objects that are not performance critical.
+    void setOptimizeForSize (bool enable);
+
+    /// is optimizing for code size enabled?
+    bool optimizeForSize () const { return this->_optForSize; }
+
+    /// enable or disable entry sleds.  When enabled, the functions of subsequent
+    /// modules begin with a patchable NOP sled that the runtime can replace
+    /// with a call to a tracing trampoline, and the module includes a table
+    /// of the sled offsets (see `CodeObject::sledOffset`).  The trampoline
+    /// must preserve all registers, since the sled is executed before any of
+    /// the JWA argument registers have been used.
+    void setEntrySleds (bool enable) { this->_entrySleds = enable; }
+
+    /// are entry sleds enabled?
+    bool entrySleds () const { return this->_entrySleds; }
+
+    /// enable or disable the JWA-aware register-allocation mode for subsequent
+    /// modules.  In this mode, the register allocator hints the copies of the
+    /// ALLOC_PTR, LIMIT_PTR, and STORE_PTR arguments to their convention
+    /// registers, so that the PHI webs for these registers are not shuffled
+    /// between registers in large functions.  When `budget` is non-zero, it is
+    /// the maximum number of machine instructions in a function for which the
+    /// allocator tries to split live ranges; larger functions use a cheaper
+    /// strategy that spills live ranges without splitting them.  The number of
+    /// functions that exceed the budget is reported in the statistics (see
+    /// `CodeGenStats::numRABudgetFallbacks`).  This mode has no effect at the
+    /// `llvm::CodeGenOpt::None` level, which uses LLVM's fast allocator.
+    void setJWARegAlloc (bool enable, unsigned int budget = 0)
+    {
+        this->_jwaRegAlloc = enable;
+        this->_raBudget = budget;
+    }
+
+    /// is the JWA-aware register-allocation mode enabled?
+    bool jwaRegAlloc () const { return this->_jwaRegAlloc; }
+
+    /// the instruction budget for register allocation (zero for no budget)
+    unsigned int regAllocBudget () const { return this->_raBudget; }
+
+    /// the sled table of the current module or nullptr if the module does not
+    /// have entry sleds
+    llvm::GlobalVariable const *sledTable () const { return this->_sledTable; }
+
+    /// enable or disable symbol-free object files for subsequent modules.  In
+    /// this mode, the functions and label aliases of the module are private
+    /// values (which are unnamed, except in debug builds), so the object file
+    /// does not have any named symbols.
+    /// Instead, the module ends with an entry table that records the offsets
+    /// of the entry functions and of the sled table (see `entryTable`).  This
+    /// mode is meant for the in-memory code objects produced by `compile`;
+    /// the JITLink loader requires named entry symbols, so it should not be
+    /// used with symbol-free modules.
+    void setSymbolFree (bool enable) { this->_symbolFree = enable; }
+
+    /// are symbol-free object files enabled?
+    bool symbolFree () const { return this->_symbolFree; }
+
+    /// restore the default code-generation settings (allocation prefetching,
+    /// the JWA register sequence, register pinning, optimizing for size, entry
+    /// sleds, the JWA-aware register allocation, symbol-free object files,
+    /// GlobalISel, the IR optimization pipeline, statistics collection, and
+    /// pass timing).  This function must not be called while a module is
+    /// being generated.
+    void resetSettings ();
+
+    /// the entry table of the current module or nullptr if the module is not
+    /// symbol free.  The table ends the text section (`compile` makes it the
+    /// last global of the module) and has the layout
+    ///
+    ///     struct { i32 entries[nEntries]; i32 sledTbl; i32 nEntries; i32 magic; }
+    ///
+    /// where the offsets are relative to the start of the table, `sledTbl`
+    /// is zero when the module does not have a sled table, and `magic` is
+    /// `CodeObject::kEntryTableMagic`.
+    llvm::GlobalVariable const *entryTable () const { return this->_entryTable; }
+
+    /// emit a write prefetch ahead of the allocation pointer, if prefetching is
+    /// enabled and the allocation pointer has been bumped since the entry to the
+    /// current fragment (or since the fragment's GC call, if any).  This method should be called just before the control
+    /// transfer that ends the fragment, so that the prefetch is applied to the
+    /// final value of the allocation pointer.
+    void prefetchAllocPtr ();
+
     /// target parameters
 
     /// the size of a target machine word in bytes
@@ -454,6 +644,16 @@ class Context : public llvm::LLVMContext {
     /// return the basic-block that contains the Overflow trap generator
     llvm::BasicBlock *getOverflowBB ();
 
+    /// add the overflow bit of a trapping arithmetic operation to the pending
+    /// overflow check.  The check is not emitted until `flushOverflowCheck`
+    /// is called, which allows the checks for a chain of operations to be
+    /// combined into a single branch.
+    void addOverflowCheck (llvm::Value *obit);
+
+    /// emit a branch to the overflow block for the pending overflow check (if any)
+    /// and continue code generation in a new block.
+    void flushOverflowCheck ();
+
     /// return branch-weight meta data, where `prob` represents the probability of
     /// the true branch and is in the range 1..999.
     llvm::MDNode *branchProb (int prob);
@@ -464,17 +664,8 @@ class Context : public llvm::LLVMContext {
     /// return an address in the stack with the given `ptrTy`.
     llvm::Value *stkAddr (llvm::Type *ptrTy, int offset)
     {
-        if (this->_readReg == nullptr) {
-            this->_initSPAccess();
-        }
-
         return this->createIntToPtr (
-            this->createAdd(
-                this->_builder.CreateCall(
-                    this->_readReg->getFunctionType(),
-                    this->_readReg,
-                    { llvm::MetadataAsValue::get(*this, this->_spRegMD) }),
-                this->iConst(offset)),
+            this->createAdd(this->_stackPtr(), this->iConst(offset)),
             ptrTy);
 
     }
@@ -571,6 +762,13 @@ class Context : public llvm::LLVMContext {
         }
         return this->_copysign64;
     }
+    llvm::Function *prefetch () const
+    {
+        if (this->_prefetch == nullptr) {
+            this->_prefetch = _getIntrinsic (llvm::Intrinsic::prefetch, this->bytePtrTy);
+        }
+        return this->_prefetch;
+    }
     /// @}
 
   /***** shorthand for LLVM integer instructions (with argument coercions) *****/
@@ -707,6 +905,19 @@ class Context : public llvm::LLVMContext {
       // NOTE: our loads are always aligned to the ABI alignment requirement
         return this->_builder.CreateAlignedLoad (ty, adr, llvm::MaybeAlign(0));
     }
+    /// create a load from an immutable field of a heap object (i.e., a field of
+    /// a record or an element of a pure vector).  The load is tagged so that the
+    /// SML heap alias analysis can recognize it.
+    llvm::Value *createImmutableLoad (llvm::Type *ty, llvm::Value *adr, unsigned align)
+    {
+        auto ld = this->_builder.CreateAlignedLoad (ty, adr, llvm::MaybeAlign(align));
+        ld->setMetadata (llvm::LLVMContext::MD_tbaa, this->_immutableMD);
+        return ld;
+    }
+    llvm::Value *createImmutableLoad (llvm::Type *ty, llvm::Value *adr)
+    {
+        return this->createImmutableLoad (ty, adr, 0);
+    }
 
     /// create a store of a ML value
     void createStoreML (llvm::Value *v, llvm::Value *adr)
@@ -750,6 +961,7 @@ class Context : public llvm::LLVMContext {
     /// create a tail JWA function call
     llvm::CallInst *createJWACall (llvm::FunctionType *fnTy, llvm::Value *fn, Args_t const &args)
     {
+        this->writeBackMemRegs ();
         llvm::CallInst *call = this->_builder.CreateCall(fnTy, fn, args);
         call->setCallingConv (llvm::CallingConv::JWA);
         call->setTailCallKind (llvm::CallInst::TCK_Tail);
@@ -804,16 +1016,48 @@ class Context : public llvm::LLVMContext {
     ObjfilePWriteStream & objectFileOS () { return this->_objFileOS; }
 
     /// compile to an in-memory code object
+    /// \return the code object, or nullptr if the spill slots of a cluster do
+    ///         not fit in the target's spill area (see `TargetInfo::spillAreaSzb`)
     std::unique_ptr<CodeObject> compile ();
 
     /// dump assembly code to stdout
-    void dumpAsm () const;
+    /// \return false if the code could not be generated or the spill slots of
+    ///         a cluster do not fit in the target's spill area (as for `compile`)
+    bool dumpAsm () const;
 
     /// dump assembly code to a file
-    void dumpAsm (std::string const &stem) const;
+    /// \return false if the code could not be generated or the spill slots of
+    ///         a cluster do not fit in the target's spill area.  In the latter
+    ///         case, the file is still written, but the code is not usable.
+    bool dumpAsm (std::string const &stem) const;
 
     /// dump machine code to an object file
-    void dumpObj (std::string const &stem) const;
+    /// \return false if the code could not be generated or the spill slots of
+    ///         a cluster do not fit in the target's spill area.  In the latter
+    ///         case, the file is still written, but the code is not usable.
+    bool dumpObj (std::string const &stem) const;
+
+  /***** Statistics *****/
+
+    /// the code-generation statistics for this context
+    CodeGenStats &stats () { return this->_stats; }
+    CodeGenStats const &stats () const { return this->_stats; }
+
+    /// enable or disable the collection of the register allocator's spill and
+    /// reload counts, the spill-area sizes, and the machine-instruction counts
+    /// in the statistics (the default is disabled).  These counts come from
+    /// LLVM analysis remarks, which make code generation slower, so they
+    /// should only be enabled when the statistics are reported.  Spill areas
+    /// that exceed their budget are counted whether or not collection is
+    /// enabled.
+    void enableStats (bool enable);
+
+    /// is the collection of the register-allocation statistics enabled?
+    bool statsEnabled () const { return this->_collectStats; }
+
+    /// enable the collection of per-pass timing in the statistics.  The timers
+    /// belong to the context, so this setting does not affect other contexts.
+    void enablePassTiming (bool enable);
 
   /***** Debugging support *****/
 
@@ -823,6 +1067,13 @@ class Context : public llvm::LLVMContext {
     /// run the LLVM verifier on the module
     bool verify () const;
 
+    /// make the LLVM assembly (".ll") file the current module in place of a
+    /// module generated from a CFG; this is used to test the IR optimization
+    /// pipeline on hand-written code.  The module's target triple and data
+    /// layout are replaced by those of the context.
+    /// \return false if the file could not be parsed
+    bool readModule (std::string const &file);
+
   private:
     struct TargetInfo const     *_target;
     llvm::IRBuilder<>           _builder;
@@ -830,7 +1081,11 @@ class Context : public llvm::LLVMContext {
     llvm::Module                *_module;       // current module
     llvm::Function              *_curFn;        // current LLVM function
     CFG::cluster                *_curCluster;   // current CFG cluster
-    lvar_map_t<CFG::cluster>    _clusterMap;    // per-module mapping from labels to clusters
+    lvar_map_t<CFG::cluster>    _clusterMap;    // per-unit mapping from labels to clusters
+    std::vector<llvm::Function *> _entryFns;    // the entry functions of the module
+    CodeGenStats                _stats;         // code-generation statistics
+    bool                        _timePasses;    // collect per-pass timing?
+    bool                        _collectStats;  // collect the remark-based statistics?
     lvar_map_t<CFG::frag>       _fragMap;       // pre-cluster map from labels to fragments
     lvar_map_t<llvm::Value>     _vMap;          // per-fragment map from lvars to values
 
@@ -841,11 +1096,30 @@ class Context : public llvm::LLVMContext {
     // a basic block for the current cluster that will raise the Overflow exception
     llvm::BasicBlock            *_overflowBB;
     std::vector<llvm::PHINode *> _overflowPhiNodes;
+    // the disjunction of the overflow bits of the trapping arithmetic
+    // operations that have not been checked yet (nullptr if there are none)
+    llvm::Value                 *_pendingOvflw;
+    unsigned int                _nPendingOvflw;         // number of operations in
+                                                        // `_pendingOvflw`
 
     // tracking the state of the SML registers
     CMRegs               _regInfo;       // target-specific register info
     CMRegState                   _regState;      // current register values
 
+    // allocation-pointer prefetching
+    unsigned int                _allocPrefetchSzb; // prefetch distance (0 == disabled)
+    std::vector<std::string>    _jwaRegs;       // JWA register sequence (empty for default)
+
+    bool                        _optForSize;    // true when optimizing for code size
+    bool                        _entrySleds;    // true when emitting entry sleds
+    llvm::GlobalVariable        *_sledTable;    // the sled table of the current module
+    bool                        _symbolFree;    // true for symbol-free object files
+    llvm::GlobalVariable        *_entryTable;   // the entry table of the current module
+    bool                        _pinnedRegs;    // true when the hardware CMachine registers
+                                                // are pinned (see `setPinnedRegs`)
+    bool                        _jwaRegAlloc;   // true for JWA-aware register allocation
+    unsigned int                _raBudget;      // register-allocation budget (0 == none)
+
     /// target-machine properties
     int64_t _wordSzB;
 
@@ -862,19 +1136,68 @@ class Context : public llvm::LLVMContext {
     mutable llvm::Function *_sqrt64;            // @llvm.sqrt.f64
     mutable llvm::Function *_copysign32;        // @llvm.copysign.f32
     mutable llvm::Function *_copysign64;        // @llvm.copysign.f64
+    mutable llvm::Function *_prefetch;          // @llvm.prefetch.p0i8
+
+    /// the TBAA tag for loads from immutable fields (see `createImmutableLoad`)
+    llvm::MDNode *_immutableMD;
 
     /// cached @llvm.read_register + meta data to access stack
     llvm::Function *_readReg;
     llvm::MDNode *_spRegMD;
 
+    /// cached @llvm.write_register + meta data to access the pinned registers
+    llvm::Function *_writeReg;
+    llvm::MDNode *_pinnedMD[CMRegInfo::NUM_REGS];
+
+    /// the value of the stack pointer in the current function (nullptr if
+    /// it has not been read yet)
+    llvm::Value *_spVal;
+
     /// helper function for getting an intrinsic when it has not yet
     /// been loaded for the current module.
     //
     llvm::Function *_getIntrinsic (llvm::Intrinsic::ID id, llvm::Type *ty) const;
 
-    /// initialize the metadata needed to support reading the stack pointer
+    /// initialize the metadata needed to support reading the stack pointer (and
+    /// accessing the pinned registers)
     void _initSPAccess ();
 
+    /// get the metadata argument of `llvm.read_register`/`llvm.write_register`
+    /// for the pinned register `r`
+    llvm::Value *_pinnedRegMD (CMRegId r);
+
+    /// the LLVM names of the pinned hardware registers, in the order of the
+    /// `CMRegId` values
+    std::vector<std::string> _pinnedRegNames () const;
+
+    /// the number of CMachine registers that are passed as extra arguments,
+    /// which is zero when the registers are pinned
+    int _numRegArgs () const
+    {
+        return this->_pinnedRegs ? 0 : this->_regInfo.numMachineRegs();
+    }
+
+    /// initialize the types of the call-gc and raise_overflow functions, which
+    /// depend on whether the CMachine registers are pinned
+    void _initRuntimeFnTys ();
+
+    /// should functions and label aliases be named?  In symbol-free mode, they
+    /// are only named in debug builds.
+    bool _namedValues () const;
+
+    /// create the sled table for the current module (see `sledTable`)
+    void _createSledTable ();
+
+    /// create the entry table for the current module (see `entryTable`)
+    void _createEntryTable ();
+
+    /// return an upper bound on the size in bytes of the machine code for
+    /// the current module
+    size_t _estimateCodeSize ();
+
+    /// get the value of the stack pointer for the current function
+    llvm::Value *_stackPtr ();
+
     /// utility function for loading a value from the stack
     llvm::Value *_loadFromStack (int offset, std::string const &name)
     {
@@ -884,12 +1207,16 @@ class Context : public llvm::LLVMContext {
             name);
     }
 
-    /// function for loading a special register from memory
+    /// function for loading a special register from memory (or from its pinned
+    /// hardware register)
     llvm::Value *_loadMemReg (CMRegId r);
 
-    /// function for setting a special memory register
+    /// function for setting a special memory (or pinned) register
     void _storeMemReg (CMRegId r, llvm::Value *v);
 
+    /// discard the cached values of the stack-allocated and pinned registers
+    void _invalidateMemRegs ();
+
     /// information about JWA arguments
     struct arg_info {
         int nExtra;     ///< number of extra args for special CMachine registers
@@ -912,7 +1239,11 @@ class Context : public llvm::LLVMContext {
     void _addExtraArgs (Args_t &args, arg_info const &info) const;
 
     /// private constructor
-    Context (struct TargetInfo const *target);
+    Context (
+        struct TargetInfo const *target,
+        std::string const &cpu,
+        std::string const &features,
+        llvm::CodeGenOpt::Level optLvl);
 
     //! backing storage for the generated object file.  We put this object it the
     //! code buffer so that we do not have to worry about its lifetime.
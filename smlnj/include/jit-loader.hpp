@@ -0,0 +1,104 @@
+/// \file jit-loader.hpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief This file defines the `JITLoader` class, which uses LLVM's JITLink
+///        to link the object file for a module into a `CodeArena`.
+///
+
+#ifndef _JIT_LOADER_HPP_
+#define _JIT_LOADER_HPP_
+
+#include "code-arena.hpp"
+
+#include "llvm/ExecutionEngine/JITLink/JITLinkMemoryManager.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace smlnj {
+namespace cfgcg {
+
+class Context;
+
+/// \brief A loader that links the in-memory object file for a module using
+///        LLVM's JITLink, instead of copying the code object and applying the
+///        relocations by hand (see `CodeObject::getCode`).
+///
+/// The link graph is pruned to the blocks that are reachable from the entry
+/// functions (and the sled table, when present), GOT loads of symbols that are
+/// defined in the object are relaxed to direct address computations, and the
+/// remaining segments are placed contiguously in the arena, so that a loaded
+/// module occupies a single region of executable memory.  Writable data is
+/// not supported, since SML code objects do not have any.
+///
+/// JITLink supports ELF objects on x86-64 and MachO objects on x86-64 and
+/// AArch64.
+//
+class JITLoader {
+  public:
+
+    /// a module that has been linked into the arena
+    class Code {
+      public:
+        /// the address of the linked code
+        void *addr () const { return this->_addr; }
+
+        /// the size of the linked code in bytes
+        size_t size () const { return this->_szb; }
+
+        /// the number of entry points; this is the number of comp_units that
+        /// were compiled into the module.
+        size_t numEntries () const { return this->_entries.size(); }
+
+        /// the address of the i'th entry point
+        void *entry (size_t i) const { return this->_entries[i]; }
+
+        /// the address of the sled table or nullptr if the module does not
+        /// have entry sleds
+        void *sledTable () const { return this->_sledTbl; }
+
+      private:
+        std::unique_ptr<llvm::jitlink::JITLinkMemoryManager::Allocation> _alloc;
+        void *_addr;                    ///< the address of the code
+        size_t _szb;                    ///< the size of the code
+        std::vector<void *> _entries;   ///< the entry-point addresses
+        void *_sledTbl;                 ///< the sled-table address
+
+        Code () : _addr(nullptr), _szb(0), _sledTbl(nullptr) { }
+
+        friend class JITLoader;
+    };
+
+    /// create a loader that places code in the given arena
+    explicit JITLoader (CodeArena &arena);
+
+    JITLoader (JITLoader const &) = delete;
+    JITLoader &operator= (JITLoader const &) = delete;
+
+    ~JITLoader ();
+
+    /// \brief link the object file for the current module of `cxt` into the
+    ///        arena.  The module must have been compiled (see `Context::compile`).
+    /// \return a handle for the linked code, or nullptr on failure, in which
+    ///         case `errorMsg` describes the problem.
+    Code *load (Context *cxt);
+
+    /// release linked code; the handle is invalid after this call.
+    void release (Code *code);
+
+    /// a description of the last load failure
+    std::string const &errorMsg () const { return this->_errMsg; }
+
+  private:
+    std::unique_ptr<llvm::jitlink::JITLinkMemoryManager> _memMngr;
+    std::string _errMsg;
+
+};
+
+} // namespace cfgcg
+} // namespace smlnj
+
+#endif // !_JIT_LOADER_HPP_
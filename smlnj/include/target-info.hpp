@@ -40,6 +40,12 @@ struct TargetInfo {
     int callGCOffset;                   ///< stack offset of call-gc entry address
     int raiseOvflwOffset;               ///< stack offset of raise_overflow entry address
     unsigned int allocSlopSzb;          ///< byte size of allocation slop
+    unsigned int allocPrefetchSzb;      ///< default distance (in bytes) ahead of the
+                                        ///  allocation pointer for write prefetches
+    unsigned int spillAreaSzb;          ///< size in bytes of the spill area that the
+                                        ///  runtime reserves at the base of the stack
+                                        ///  frame; this is the budget for the spill
+                                        ///  slots of a cluster
 
     /// initialization functions
     using init_fn_t = void (*)();
@@ -55,17 +61,15 @@ struct TargetInfo {
 
     static std::vector<std::string> targetNames ();
 
-    void initialize () const
-    {
-        if (! this->initialized) {
-            this->initTargetInfo();
-            this->initTarget();
-            this->initMC();
-            this->initAsmParser();
-            this->initAsmPrinter();
-            this->initialized = true;
-        }
-    }
+    /// initialize the LLVM target-info, target, MC, and assembly-printer components
+    /// for this target.  The initialization is only done once and it is safe
+    /// to call this function from multiple threads.  The assembly parser is
+    /// not initialized, since we do not generate inline assembly code.
+    void initialize () const;
+
+    /// initialize the LLVM assembly parser for this target, which is only
+    /// required to support inline assembly code.
+    void initializeAsmParser () const;
 
     /// the target info for the native (host) architecture
     static TargetInfo const *native;
@@ -76,6 +80,19 @@ struct TargetInfo {
 
     llvm::Triple getTriple() const;
 
+    /// the default sequence of integer argument registers for the JWA calling
+    /// convention (by lower-case LLVM register name), which is the order that
+    /// LLVM assigns the CMachine registers and other arguments to registers.
+    /// The result is empty for targets that do not support overriding the
+    /// sequence (see `Context::setJWARegisters`).
+    std::vector<std::string> jwaRegisters () const;
+
+    /// the hardware registers (by lower-case LLVM register name) that hold the
+    /// machine-mapped CMachine registers in the order of their `CMRegId` values.
+    /// These are the registers that are reserved when the CMachine registers
+    /// are pinned (see `Context::setPinnedRegs`).
+    std::vector<std::string> pinnedRegisters () const;
+
     /// given a number of bytes, round it up to the next multiple of the
     /// target's word size
     uint64_t roundToWordSz (uint64_t nBytes) const
@@ -34,15 +34,102 @@ namespace asdl {
 	return static_cast<std::ostringstream *>(this->_os)->str();
     }
 
+    constexpr char instream::V2_MAGIC[4];
+
+  // append a version 1 unsigned integer to a string
+    static void append_uint (std::string &buf, unsigned int ui)
+    {
+	if (ui <= 0x3f) { // one byte
+	    buf.push_back (static_cast<char>(ui));
+	}
+	else if (ui <= 0x3fff) { // two bytes
+	    buf.push_back (static_cast<char>(0x40 | (ui >> 8)));
+	    buf.push_back (static_cast<char>(ui));
+	}
+	else if (ui <= 0x3fffff) { // three bytes
+	    buf.push_back (static_cast<char>(0x80 | (ui >> 16)));
+	    buf.push_back (static_cast<char>(ui >> 8));
+	    buf.push_back (static_cast<char>(ui));
+	}
+	else { // four bytes
+	    assert (ui <= 0x3fffffff);
+	    buf.push_back (static_cast<char>(0xc0 | (ui >> 24)));
+	    buf.push_back (static_cast<char>(ui >> 16));
+	    buf.push_back (static_cast<char>(ui >> 8));
+	    buf.push_back (static_cast<char>(ui));
+	}
+    }
+
+    void instream::_init (std::string &&data)
+    {
+	this->_buf = std::move(data);
+	this->_pos = 0;
+
+      // check for a version 2 header
+	if ((this->_buf.size() >= 5)
+	&& (this->_buf.compare(0, 4, V2_MAGIC, 4) == 0)) {
+	    this->_version = static_cast<unsigned char>(this->_buf[4]);
+	    if (this->_version != 2) {
+		Die ("ASDL decode error: unsupported pickle version %u", this->_version);
+	    }
+	    this->_pos = 5;
+	  // read the string table; note that the strings in the table are
+	  // encoded as in version 1.
+	    unsigned int n = read_uint (*this);
+	    this->_strings.reserve (n);
+	    for (unsigned int i = 0;  i < n;  i++) {
+		unsigned int len = read_uint (*this);
+		if (this->_buf.size() - this->_pos < len) {
+		    Die ("ASDL decode error: truncated string table");
+		}
+		this->_strings.push_back (this->_buf.substr(this->_pos, len));
+		this->_pos += len;
+	    }
+	}
+    }
+
+    void instream::begin_transcode ()
+    {
+	assert ((this->_version == 1) && "transcoding requires a version 1 pickle");
+	assert ((this->_echo == nullptr) && "already transcoding");
+	this->_echo = new transcoder;
+	this->_echo->suspended = 0;
+    }
+
+    std::string instream::end_transcode ()
+    {
+	assert ((this->_echo != nullptr) && "not transcoding");
+	std::string result(V2_MAGIC, 4);
+	result.push_back (2);
+	append_uint (result, this->_echo->strings.size());
+	for (auto const &s : this->_echo->strings) {
+	    append_uint (result, s.length());
+	    result.append (s);
+	}
+	result.append (this->_echo->body);
+	delete this->_echo;
+	this->_echo = nullptr;
+	return result;
+    }
+
+  // we read the whole file into memory, since decoding from a buffer is
+  // much faster than going through the stream interface for each byte.
     file_instream::file_instream (std::string const &file)
-	: instream(new std::ifstream(file, std::ios_base::in | std::ios_base::binary))
+	: instream(nullptr)
     {
-// FIXME: need to check for failure
+	std::ifstream inS(file, std::ios_base::in | std::ios_base::binary);
+	if (inS.good()) {
+	    std::ostringstream data(std::ios_base::out | std::ios_base::binary);
+	    data << inS.rdbuf();
+	    this->_init (data.str());
+	}
+      // otherwise the buffer is empty and the first read will fail
     }
 
     memory_instream::memory_instream (std::string const &data)
-	: instream(new std::istringstream(data, std::ios_base::in | std::ios_base::binary))
+	: instream(nullptr)
     {
+	this->_init (std::string(data));
     }
 
     void write_int (outstream & os, int i)
@@ -143,12 +230,28 @@ namespace asdl {
 
     std::string read_string (instream &is)
     {
+	if (is.version() > 1) {
+	    return is.string_at(read_uint(is));
+	}
+	transcoder *echo = is.echo();
+	if (echo != nullptr) {
+	    echo->suspended++;
+	}
 	std::string result;
 	unsigned int len = read_uint(is);
 	result.reserve(len);
 	for (unsigned int i = 0;  i < len;  i++) {
 	    result.push_back(is.getc());
 	}
+	if (echo != nullptr) {
+	  // replace the string with its index in the string table
+	    echo->suspended--;
+	    auto ins = echo->index.insert(std::make_pair(result, echo->strings.size()));
+	    if (ins.second) {
+		echo->strings.push_back(result);
+	    }
+	    append_uint (echo->body, ins.first->second);
+	}
 	return result;
     }
 
@@ -60,6 +60,33 @@ namespace CFG {
 
   /***** code generation for the `exp` type *****/
 
+    bool exp::canSpeculate ()
+    {
+	switch (this->_tag) {
+	  case _con_VAR:
+	  case _con_LABEL:
+	  case _con_NUM:
+	    return true;
+	  case _con_PURE: {
+		PURE *p = static_cast<PURE *>(this);
+		if (! p->get_oper()->canSpeculate()) {
+		    return false;
+		}
+		for (auto arg : p->get_args()) {
+		    if (! arg->canSpeculate()) {
+			return false;
+		    }
+		}
+		return true;
+	    }
+	  case _con_OFFSET:
+	    return static_cast<OFFSET *>(this)->get_arg()->canSpeculate();
+	  default: // LOOKER and SELECT are memory loads
+	    return false;
+	}
+
+    } // exp::canSpeculate
+
     llvm::Value *VAR::codegen (smlnj::cfgcg::Context *cxt)
     {
 	llvm::Value *v = cxt->lookupVal (this->_v_name);
@@ -118,7 +145,7 @@ namespace CFG {
 	llvm::Value *adr = cxt->createGEP (
 	    cxt->asObjPtr(this->_v_arg->codegen(cxt)),
 	    static_cast<int32_t>(this->_v_idx));
-	return cxt->createLoad (cxt->mlValueTy, adr);
+	return cxt->createImmutableLoad (cxt->mlValueTy, adr);
 
     } // SELECT::codegen
 
@@ -199,6 +226,7 @@ namespace CFG {
       // evaluate the arguments
 	Args_t args = SetupStdArgs (cxt, fnTy, fk, this->_v1);
 
+	cxt->prefetchAllocPtr ();
 	cxt->createJWACall(fnTy, fn, args);
 
 	cxt->build().CreateRetVoid();
@@ -225,6 +253,7 @@ namespace CFG {
       // evaluate the arguments
 	Args_t args = SetupStdArgs (cxt, fnTy, frag_kind::STD_CONT, this->_v1);
 
+	cxt->prefetchAllocPtr ();
 	cxt->createJWACall(fnTy, fn, args);
 
 	cxt->build().CreateRetVoid();
@@ -258,6 +287,9 @@ namespace CFG {
 	    }
 	}
 
+	cxt->prefetchAllocPtr ();
+	cxt->writeBackMemRegs ();
+
       // generate the control transfer; note that we need to do this *after*
       // updating the PHI nodes, since any type casts introduced for the PHI
       // nodes will be generated in the *source* block!
@@ -335,6 +367,41 @@ namespace CFG {
 
     } // BRANCH::codegen
 
+    // Only whether some Overflow exception is raised by a sequence of trapping
+    // arithmetic operations is observable, so when the continuation of an
+    // operation is another trapping operation (possibly after some LET bindings)
+    // and nothing in between can trap or access memory, we can combine the
+    // overflow tests of the two operations into a single branch.
+    //
+    bool ARITH::_canDeferOverflowCheck ()
+    {
+	if (! this->_v0->checksOverflow()) {
+	    return false;
+	}
+	stm *next = this->_v3;
+	while (next->isLET()) {
+	    LET *let = static_cast<LET *>(next);
+	    if (! let->get_0()->canSpeculate()) {
+		return false;
+	    }
+	    next = let->get_2();
+	}
+	if (! next->isARITH()) {
+	    return false;
+	}
+	ARITH *nextArith = static_cast<ARITH *>(next);
+	if (! nextArith->_v0->checksOverflow()) {
+	    return false;
+	}
+	for (auto arg : nextArith->_v1) {
+	    if (! arg->canSpeculate()) {
+		return false;
+	    }
+	}
+	return true;
+
+    } // ARITH::_canDeferOverflowCheck
+
     void ARITH::codegen (smlnj::cfgcg::Context *cxt)
     {
 	Args_t args;
@@ -343,6 +410,10 @@ namespace CFG {
 	}
       // record mapping from the parameter to the compiled expression
 	this->_v2->bind (cxt, this->_v0->codegen (cxt, args));
+      // test for overflow, unless the test can be combined with the next operation
+	if (! this->_canDeferOverflowCheck()) {
+	    cxt->flushOverflowCheck ();
+	}
       // compile continuation
 	this->_v3->codegen (cxt);
 
@@ -431,6 +502,43 @@ namespace CFG {
       // initialize the buffer for the comp_unit
 	cxt->beginModule (this->_v_srcFile, this->_v_fns.size() + 1);
 
+	this->_codegenClusters (cxt);
+
+        cxt->completeModule ();
+
+    } // comp_unit::codegen
+
+  // generate code for a bundle of comp_units into a single module.  Each unit
+  // gets its own entry function; the entry functions are recorded in the
+  // context in the order of the units, so that the resulting code object can
+  // report their offsets.
+  //
+    void comp_unit::codegen (
+	smlnj::cfgcg::Context *cxt,
+	std::string const &name,
+	std::vector<comp_unit *> const &units)
+    {
+	int nClusters = 0;
+	for (auto cu : units) {
+	    nClusters += cu->_v_fns.size() + 1;
+	}
+
+      // initialize the buffer for the bundle
+	cxt->beginModule (name, nClusters);
+
+	for (auto cu : units) {
+	  // labels are only unique within a comp_unit, so each unit gets a fresh
+	  // label-to-cluster map
+	    cxt->beginUnit (cu->_v_fns.size() + 1);
+	    cu->_codegenClusters (cxt);
+	}
+
+        cxt->completeModule ();
+
+    } // comp_unit::codegen
+
+    void comp_unit::_codegenClusters (smlnj::cfgcg::Context *cxt)
+    {
       // initialize the clusters
 	this->_v_entry->init (cxt, true);
 	for (auto f : this->_v_fns) {
@@ -443,8 +551,6 @@ namespace CFG {
 	    f->codegen (cxt, false);
 	}
 
-        cxt->completeModule ();
-
-    } // comp_unit::codegen
+    } // comp_unit::_codegenClusters
 
 } // namespace CFG
@@ -198,16 +198,30 @@ namespace CFG_Prim {
         }
 
         llvm::Value *res = cxt->createExtractValue(pair, 0);
-        llvm::Value *obit = cxt->createExtractValue(pair, 1);
-        llvm::BasicBlock *next = cxt->newBB ("ok");
-        cxt->build().CreateCondBr(obit, cxt->getOverflowBB(), next, cxt->overflowWeights());
-      // switch to the new block for the continuation
-        cxt->setInsertPoint (next);
+      // the branch to the overflow block is generated by `Context::flushOverflowCheck`,
+      // which is called by the ARITH statement
+        cxt->addOverflowCheck (cxt->createExtractValue(pair, 1));
 
         return res;
 
     } // ARITH::codegen
 
+    bool arith::checksOverflow ()
+    {
+        if (this->_tag != _con_ARITH) {
+            return false;
+        }
+        switch (static_cast<ARITH *>(this)->get_oper()) {
+            case arithop::IADD:
+            case arithop::ISUB:
+            case arithop::IMUL:
+                return true;
+            default:
+                return false;
+        }
+
+    } // arith::checksOverflow
+
     llvm::Value *FLOAT_TO_INT::codegen (smlnj::cfgcg::Context *cxt, Args_t const &args)
     {
         return cxt->createFPToSI (args[0], cxt->iType (this->_v_to));
@@ -217,6 +231,31 @@ namespace CFG_Prim {
 
   /***** code generation for the `pure` type *****/
 
+    bool pure::canSpeculate ()
+    {
+        switch (this->_tag) {
+            case _con_PURE_ARITH:
+              // integer division can trap
+                switch (static_cast<PURE_ARITH *>(this)->get_oper()) {
+                    case pureop::SDIV:
+                    case pureop::SREM:
+                    case pureop::UDIV:
+                    case pureop::UREM:
+                        return false;
+                    default:
+                        return true;
+                }
+            case _con_PURE_SUBSCRIPT:
+            case _con_PURE_RAW_SUBSCRIPT:
+            case _con_RAW_SELECT:
+              // memory loads
+                return false;
+            default:
+                return true;
+        }
+
+    } // pure::canSpeculate
+
     llvm::Value *PURE_ARITH::codegen (smlnj::cfgcg::Context *cxt, Args_t const &args)
     {
         unsigned sz = this->_v_sz;
@@ -322,7 +361,7 @@ namespace CFG_Prim {
     llvm::Value *PURE_SUBSCRIPT::codegen (smlnj::cfgcg::Context *cxt, Args_t const &args)
     {
         llvm::Value *adr = cxt->createGEP (cxt->asObjPtr(args[0]), cxt->asInt(args[1]));
-        return cxt->build().CreateLoad (cxt->mlValueTy, adr);
+        return cxt->createImmutableLoad (cxt->mlValueTy, adr);
 
     } // PURE_SUBSCRIPT::codegen
 
@@ -332,7 +371,7 @@ namespace CFG_Prim {
 
         llvm::Value *adr = cxt->createGEP (elemTy->getPointerTo(), args[0], args[1]);
 
-        return cxt->createLoad (elemTy, adr, bitsToBytes(this->_v_sz));
+        return cxt->createImmutableLoad (elemTy, adr, bitsToBytes(this->_v_sz));
 
     } // PURE_RAW_SUBSCRIPT::codegen
 
@@ -348,7 +387,7 @@ namespace CFG_Prim {
                 cxt->uConst (this->_v_offset)),
             elemTy->getPointerTo());
 
-        return cxt->createLoad (elemTy, adr, bitsToBytes(this->_v_sz));
+        return cxt->createImmutableLoad (elemTy, adr, bitsToBytes(this->_v_sz));
 
     } // RAW_SELECT::codegen
 
@@ -67,7 +67,7 @@ CMRegs::CMRegs (TargetInfo const *target)
 /***** CMRegState methods *****/
 
 CMRegState::CMRegState (CMRegs const & info)
-  : _basePtr(nullptr)
+  : _basePtr(nullptr), _dirty(0), _entryAllocPtr(nullptr)
 {
   // we initialize all of the registers to nullptr
     for (int i = 0;  i < CMRegInfo::NUM_REGS;  i++) {
@@ -81,6 +81,8 @@ void CMRegState::copyFrom (CMRegState const & cache)
     for (int i = 0;  i < CMRegInfo::NUM_REGS;  i++) {
 	this->_val[i] = cache._val[i];
     }
+    this->_dirty = cache._dirty;
+    this->_entryAllocPtr = cache._entryAllocPtr;
 
 }
 
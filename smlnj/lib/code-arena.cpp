@@ -0,0 +1,240 @@
+/// \file code-arena.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief Implementation of the `CodeArena` class.
+///
+
+#include "code-arena.hpp"
+#include "code-object.hpp"
+
+#include "llvm/Support/Process.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(OPSYS_LINUX)
+#include <sys/mman.h>
+#endif
+
+namespace smlnj {
+namespace cfgcg {
+
+using llvm::sys::Memory;
+using llvm::sys::MemoryBlock;
+
+// round `n` up to a multiple of `align`, which must be a power of two
+static inline size_t alignUp (size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+constexpr size_t CodeArena::kDefaultChunkSzb;
+
+CodeArena::CodeArena (size_t chunkSzb, bool hugePages)
+  : _pageSzb(llvm::sys::Process::getPageSizeEstimate()),
+    _hugePages(hugePages), _current(nullptr), _nLive(0), _nBytesInUse(0)
+{
+    if (hugePages) {
+        // huge-page backed chunks must be a multiple of the huge-page size
+        this->_chunkSzb = alignUp (std::max(chunkSzb, kDefaultChunkSzb), kDefaultChunkSzb);
+    } else {
+        this->_chunkSzb = alignUp (chunkSzb, this->_pageSzb);
+    }
+
+} // CodeArena constructor
+
+CodeArena::~CodeArena ()
+{
+    for (auto chunk : this->_chunks) {
+        Memory::releaseMappedMemory (chunk->mem);
+        delete chunk;
+    }
+
+} // CodeArena destructor
+
+size_t CodeArena::bytesMapped () const
+{
+    size_t n = 0;
+    for (auto chunk : this->_chunks) {
+        n += chunk->mem.allocatedSize();
+    }
+    return n;
+
+} // CodeArena::bytesMapped
+
+CodeArena::Code *CodeArena::load (CodeObject *obj)
+{
+    Code *code = this->reserve (obj->size(), obj->alignment());
+    if (code == nullptr) {
+        return nullptr;
+    }
+
+    bool ok = this->initialize (code,
+        [obj] (unsigned char *addr) { obj->getCode (addr); });
+    if (! ok) {
+        this->release (code);
+        return nullptr;
+    }
+
+    return code;
+
+} // CodeArena::load
+
+CodeArena::Code *CodeArena::reserve (size_t szb, size_t align)
+{
+    align = std::max(align, size_t(1));
+
+    // find a chunk with enough space for the object
+    Chunk *chunk = this->_current;
+    size_t offset = 0;
+    if (chunk != nullptr) {
+        offset = alignUp (chunk->used, align);
+    }
+    if ((chunk == nullptr) || (offset + szb > chunk->szb)) {
+        if (szb + align > this->_chunkSzb) {
+            // an oversized object gets its own chunk, which does not replace
+            // the current chunk
+            chunk = this->_newChunk (szb + align);
+            if (chunk == nullptr) {
+                return nullptr;
+            }
+        } else {
+            chunk = this->_newChunk (this->_chunkSzb);
+            if (chunk == nullptr) {
+                return nullptr;
+            }
+            // the old current chunk can be freed if it does not hold any live code
+            if ((this->_current != nullptr) && (this->_current->nLive == 0)) {
+                this->_freeChunk (this->_current);
+            }
+            this->_current = chunk;
+        }
+        offset = 0;
+    }
+
+    unsigned char *addr = chunk->base + offset;
+
+    chunk->used = offset + szb;
+    chunk->nLive++;
+    this->_nLive++;
+    this->_nBytesInUse += szb;
+
+    return new Code (chunk, addr, szb);
+
+} // CodeArena::reserve
+
+bool CodeArena::initialize (
+    Code *code,
+    llvm::function_ref<void(unsigned char *)> init)
+{
+    Chunk *chunk = code->_chunk;
+    unsigned char *addr = static_cast<unsigned char *>(code->_addr);
+
+    // make the pages writable while we copy and patch the code; note that the
+    // pages are not executable at this point (W^X)
+    if (! this->_protect (chunk, addr, code->_szb, Memory::MF_READ | Memory::MF_WRITE)) {
+        return false;
+    }
+
+    init (addr);
+
+    // make the pages executable again.  On AArch64, `protectMappedMemory` also
+    // invalidates the instruction cache for the range when MF_EXEC is set.
+    return this->_protect (chunk, addr, code->_szb, Memory::MF_READ | Memory::MF_EXEC);
+
+} // CodeArena::initialize
+
+void CodeArena::release (Code *code)
+{
+    if (code == nullptr) {
+        return;
+    }
+
+    Chunk *chunk = code->_chunk;
+    assert (chunk->nLive > 0 && "release of code in an empty chunk");
+
+    this->_nLive--;
+    this->_nBytesInUse -= code->_szb;
+    delete code;
+
+    if (--chunk->nLive == 0) {
+        if (chunk == this->_current) {
+            // reuse the current chunk from the beginning
+            chunk->used = 0;
+        } else {
+            this->_freeChunk (chunk);
+        }
+    }
+
+} // CodeArena::release
+
+CodeArena::Chunk *CodeArena::_newChunk (size_t szb)
+{
+    size_t pageSzb = this->_hugePages ? kDefaultChunkSzb : this->_pageSzb;
+    szb = alignUp (szb, pageSzb);
+
+    // when using huge pages, we over-allocate by a huge page so that we can
+    // align the usable region on a huge-page boundary
+    size_t mapSzb = this->_hugePages ? szb + kDefaultChunkSzb : szb;
+
+    std::error_code ec;
+    MemoryBlock mem = Memory::allocateMappedMemory (
+        mapSzb, nullptr, Memory::MF_READ | Memory::MF_EXEC, ec);
+    if (ec) {
+        return nullptr;
+    }
+
+    unsigned char *base = reinterpret_cast<unsigned char *>(
+        alignUp (reinterpret_cast<uintptr_t>(mem.base()), pageSzb));
+
+#if defined(OPSYS_LINUX) && defined(MADV_HUGEPAGE)
+    if (this->_hugePages) {
+        // this is just advice, so we ignore failure
+        ::madvise (base, szb, MADV_HUGEPAGE);
+    }
+#endif
+
+    Chunk *chunk = new Chunk;
+    chunk->mem = mem;
+    chunk->base = base;
+    chunk->szb = szb;
+    chunk->used = 0;
+    chunk->nLive = 0;
+
+    this->_chunks.push_back (chunk);
+
+    return chunk;
+
+} // CodeArena::_newChunk
+
+void CodeArena::_freeChunk (Chunk *chunk)
+{
+    auto it = std::find (this->_chunks.begin(), this->_chunks.end(), chunk);
+    assert (it != this->_chunks.end() && "unknown chunk");
+    this->_chunks.erase (it);
+
+    if (chunk == this->_current) {
+        this->_current = nullptr;
+    }
+
+    Memory::releaseMappedMemory (chunk->mem);
+    delete chunk;
+
+} // CodeArena::_freeChunk
+
+bool CodeArena::_protect (Chunk *chunk, unsigned char *addr, size_t szb, unsigned flags)
+{
+    // changing the protection of part of a huge page would force the kernel
+    // to split it, so we change the protection of the whole chunk instead.
+    MemoryBlock blk = this->_hugePages
+        ? MemoryBlock(chunk->base, chunk->szb)
+        : MemoryBlock(addr, szb);
+
+    return ! Memory::protectMappedMemory (blk, flags);
+
+} // CodeArena::_protect
+
+} // namespace cfgcg
+} // namespace smlnj
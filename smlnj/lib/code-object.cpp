@@ -14,6 +14,8 @@
 #include "target-info.hpp"
 #include "code-object.hpp"
 #include "context.hpp"
+#include "llvm/IR/Mangler.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 
@@ -42,6 +44,9 @@ namespace cfgcg {
 
 static llvm::ExitOnError exitOnErr;
 
+// the number of bytes of code that `dump` prints for each entry sled
+static constexpr uint64_t kSledDumpSzB = 8;
+
 //==============================================================================
 
 /// get the name of a section
@@ -231,6 +236,38 @@ std::unique_ptr<CodeObject> CodeObject::create (Context *codeBuf)
 
     p->_computeSize();
 
+#ifdef OBJFF_ELF
+  // the assembler resolves all of the code references of a symbol-free ELF
+  // object, except for Arm64 modules that are too big for ADR (see
+  // `Context::completeModule`), so the object has no relocations
+    if (codeBuf->entryTable() != nullptr) {
+        auto cm = codeBuf->module()->getCodeModel();
+        p->_relocFree = (target->arch != llvm::Triple::aarch64)
+            || (cm && (*cm == llvm::CodeModel::Tiny));
+    }
+#endif
+
+  // a symbol-free object file has an entry table in place of the entry symbols
+    if (codeBuf->entryTable() != nullptr) {
+        p->_readEntryTable ();
+        return p;
+    }
+
+  // record the offsets of the entry functions; we use the mangler to get the
+  // object-file names for the functions (e.g., MachO adds a "_" prefix).
+    llvm::Mangler mangler;
+    for (auto fn : codeBuf->entryFunctions()) {
+        llvm::SmallString<64> name;
+        mangler.getNameWithPrefix (name, fn, false);
+        int64_t offset = p->_symbolOffset (name);
+        if (offset < 0) {
+            Die ("missing entry symbol '%s'", name.c_str());
+        }
+        p->_entryOffsets.push_back (offset);
+    }
+
+    p->_readSledTable (codeBuf);
+
     return p;
 }
 
@@ -253,8 +290,18 @@ void CodeObject::getCode (uint8_t *code)
             /* copy the code into the object */
             uint8_t *base = code + sect.offset();
             memcpy (base, contents->data(), szb);
-            /* resolve relocations */
-            this->_resolveRelocsForSection (sect, code);
+            if (this->_relocFree) {
+                /* the label references and constants of JWA code are in the
+                 * text section, where the assembler resolves them, so there
+                 * are no relocations to apply.
+                 */
+                assert (llvm::empty(sect.relocations())
+                    && "unexpected relocation in code object");
+            }
+            else {
+                /* resolve relocations */
+                this->_resolveRelocsForSection (sect, code);
+            }
         }
     }
 
@@ -271,6 +318,7 @@ void CodeObject::_computeSize ()
     // concatenation of the sections.
     //
     uint64_t codeSzB = 0;
+    uint64_t maxAlign = 1;
     for (auto sect : this->_obj->sections()) {
         if (this->_includeSect (sect)) {
             uint64_t align = sect.getAlignment();
@@ -288,6 +336,7 @@ void CodeObject::_computeSize ()
 #endif
             this->_sects.push_back (Section(this, sect, codeSzB));
             codeSzB += szb;
+            maxAlign = std::max(maxAlign, align);
         }
         else {
             // check to see if the section is a relocation section
@@ -311,8 +360,124 @@ void CodeObject::_computeSize ()
     assert (codeSzB > 0 && "no useful sections in object file");
 
     this->_szb = codeSzB;
+    this->_align = maxAlign;
 }
 
+int64_t CodeObject::_symbolOffset (llvm::StringRef name)
+{
+    for (auto sym : this->_obj->symbols()) {
+        if (getName(sym) == name) {
+            auto sectIt = sym.getSection();
+            if (sectIt.takeError() || (*sectIt == this->_obj->section_end())) {
+                return -1;
+            }
+            for (auto &sect : this->_sects) {
+                if (sect.isSection(**sectIt)) {
+                    // the symbol's value is an address in the object file, so
+                    // we adjust it to be relative to the section
+                    return sect.offset() + (getValue(sym) - sect.getAddress());
+                }
+            }
+            return -1;
+        }
+    }
+    return -1;
+
+} // CodeObject::_symbolOffset
+
+void CodeObject::_readSledTable (Context *codeBuf)
+{
+    auto tbl = codeBuf->sledTable();
+    if (tbl == nullptr) {
+        return;
+    }
+
+    llvm::Mangler mangler;
+    llvm::SmallString<64> name;
+    mangler.getNameWithPrefix (name, tbl, false);
+    int64_t tblOffset = this->_symbolOffset (name);
+    if (tblOffset < 0) {
+        Die ("missing sled table '%s'", name.c_str());
+    }
+    this->_readSledOffsets (tblOffset);
+
+} // CodeObject::_readSledTable
+
+void CodeObject::_readSledOffsets (int64_t tblOffset)
+{
+    this->_sledTblOffset = tblOffset;
+
+  // find the section that contains the table
+    for (auto &sect : this->_sects) {
+        if ((sect.offset() <= tblOffset) && (tblOffset < sect.offset() + sect.getSize())) {
+            auto contents = sect.getContents();
+            if (contents.takeError()) {
+                Die ("unable to get contents of section");
+            }
+            // the table entries are little-endian 32-bit integers; the
+            // offsets are relative to the start of the table
+            auto tblData = reinterpret_cast<const uint8_t *>(contents->data())
+                + (tblOffset - sect.offset());
+            uint32_t n = llvm::support::endian::read32le(tblData);
+            for (uint32_t i = 0;  i < n;  ++i) {
+                int32_t offset = static_cast<int32_t>(
+                    llvm::support::endian::read32le(tblData + 4 * (i + 1)));
+                this->_sledOffsets.push_back (tblOffset + offset);
+            }
+            return;
+        }
+    }
+
+} // CodeObject::_readSledOffsets
+
+void CodeObject::_readEntryTable ()
+{
+#if defined(OBJFF_MACHO)
+    Section *sect = this->findSection ("__text");
+#else
+    Section *sect = this->findSection (".text");
+#endif
+    if (sect == nullptr) {
+        Die ("missing text section");
+    }
+    auto contents = sect->getContents();
+    if (contents.takeError()) {
+        Die ("unable to get contents of section");
+    }
+
+  // the table ends the text section and has the layout
+  //
+  //    struct { i32 entries[nEntries]; i32 sledTbl; i32 nEntries; i32 magic; }
+  //
+  // where the offsets are relative to the start of the table (see
+  // `Context::entryTable`)
+    auto data = reinterpret_cast<const uint8_t *>(contents->data());
+    uint64_t szb = contents->size();
+    if ((szb < 12) || (llvm::support::endian::read32le(data + szb - 4) != kEntryTableMagic)) {
+        Die ("missing entry table");
+    }
+    uint64_t n = llvm::support::endian::read32le(data + szb - 8);
+    if (4 * (n + 3) > szb) {
+        Die ("invalid entry table (%llu entries in %llu bytes of text)",
+            (unsigned long long)n, (unsigned long long)szb);
+    }
+    int32_t sledTbl = static_cast<int32_t>(llvm::support::endian::read32le(data + szb - 12));
+    uint64_t tblOffset = szb - 4 * (n + 3);
+    for (uint32_t i = 0;  i < n;  ++i) {
+        int32_t offset = static_cast<int32_t>(
+            llvm::support::endian::read32le(data + tblOffset + 4 * i));
+        if ((offset >= 0) || (static_cast<uint64_t>(-static_cast<int64_t>(offset)) > tblOffset)) {
+            Die ("invalid offset in entry table");
+        }
+        this->_entryOffsets.push_back (sect->offset() + tblOffset + offset);
+    }
+
+    if (sledTbl != 0) {
+        this->_readSledOffsets (sect->offset() + tblOffset + sledTbl);
+    }
+
+} // CodeObject::_readEntryTable
+
 void CodeObject::dump (bool bits)
 {
   // print info about the sections
@@ -366,6 +531,30 @@ void CodeObject::dump (bool bits)
         }
     }
 
+  // print the entry points
+    llvm::dbgs() << "=== Entries ===\n";
+    for (int i = 0;  i < this->_entryOffsets.size();  ++i) {
+        llvm::dbgs() << "  " << i << " @ " << this->_entryOffsets[i] << "\n";
+    }
+
+  // print the entry sleds, with the first bytes of the code at each sled, so
+  // that the table can be checked against the sleds
+    if (this->_sledTblOffset >= 0) {
+        size_t codeSzB = this->size();
+        uint8_t *bytes = (uint8_t *)::malloc(codeSzB);
+        this->getCode (bytes);
+        llvm::dbgs() << "=== Sleds (table @ " << this->_sledTblOffset << ") ===\n";
+        for (int i = 0;  i < this->_sledOffsets.size();  ++i) {
+            uint64_t offset = this->_sledOffsets[i];
+            llvm::dbgs() << "  " << i << " @ " << offset << ":";
+            for (uint64_t j = offset;  j < std::min(offset + kSledDumpSzB, codeSzB);  j++) {
+                llvm::dbgs() << " " << llvm::format_hex_no_prefix(bytes[j], 2);
+            }
+            llvm::dbgs() << "\n";
+        }
+        ::free(bytes);
+    }
+
   // dump relocation info
     for (auto sect : this->_obj->sections()) {
         this->_dumpRelocs (sect);
@@ -0,0 +1,263 @@
+/// \file codegen-stats.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief Implementation of the `CodeGenStats` class.
+///
+
+#include "codegen-stats.hpp"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Pass.h"
+#include "llvm/PassInfo.h"
+#include "llvm/Support/Format.h"
+
+#include <algorithm>
+
+namespace smlnj {
+namespace cfgcg {
+
+void CodeGenStats::clear ()
+{
+    this->numModules = 0;
+    this->optimizeTime = 0.0;
+    this->codegenTime = 0.0;
+    this->objectSzb = 0;
+    this->numOverflowChecks = 0;
+    this->numMergedOverflowChecks = 0;
+    this->numOutlinedFunctions = 0;
+    this->numMachineInstrs = 0;
+    this->numSpills = 0;
+    this->numReloads = 0;
+    this->numRABudgetFallbacks = 0;
+    this->maxSpillAreaSzb = 0;
+    this->numSpillBudgetErrors = 0;
+    this->spillAreas.clear();
+    this->irPasses.clear();
+    this->mcPasses.clear();
+
+} // CodeGenStats::clear
+
+// print a table of pass timings
+static void printPasses (
+    llvm::raw_ostream &os,
+    char const *title,
+    std::vector<PassTiming> const &passes)
+{
+    if (passes.empty()) {
+        return;
+    }
+    os << "  " << title << ":\n";
+    os << "    pass                             count   wall(ms)   user(ms)    sys(ms)\n";
+    for (auto const &p : passes) {
+        os << "    " << llvm::format("%-32s %5u %10.3f %10.3f %10.3f\n",
+            p.name.c_str(), p.count,
+            1000.0 * p.wallTime, 1000.0 * p.userTime, 1000.0 * p.sysTime);
+    }
+
+}
+
+void CodeGenStats::print (llvm::raw_ostream &os) const
+{
+    os << "code generation statistics:\n";
+    os << "  modules compiled:    " << this->numModules << "\n";
+    os << "  optimization time:   "
+        << llvm::format("%.3f", 1000.0 * this->optimizeTime) << "ms\n";
+    os << "  code generation time: "
+        << llvm::format("%.3f", 1000.0 * this->codegenTime) << "ms\n";
+    os << "  object-file size:    " << this->objectSzb << " bytes\n";
+    os << "  overflow checks:     " << this->numOverflowChecks
+        << " (" << this->numMergedOverflowChecks << " merged)\n";
+    os << "  outlined functions:  " << this->numOutlinedFunctions << "\n";
+    os << "  machine instructions: " << this->numMachineInstrs << "\n";
+    os << "  spills/reloads:      " << this->numSpills << "/" << this->numReloads
+        << " (" << this->numRABudgetFallbacks << " functions over budget)\n";
+    os << "  max. spill area:     " << this->maxSpillAreaSzb << " bytes ("
+        << this->spillAreas.size() << " clusters with spills, "
+        << this->numSpillBudgetErrors << " over budget)\n";
+    printPasses (os, "IR passes", this->irPasses);
+    printPasses (os, "MC passes", this->mcPasses);
+
+} // CodeGenStats::print
+
+PassTimers::PassTimers (char const *name, char const *desc)
+  : _group(name, desc)
+{
+}
+
+PassTimers::~PassTimers ()
+{
+  // clear the timers, since the timer group prints a report when timers that
+  // have run are deleted
+    for (auto &t : this->_timers) {
+        t->clear();
+    }
+
+} // PassTimers destructor
+
+llvm::Timer *PassTimers::timer (llvm::StringRef name)
+{
+    llvm::Timer *&t = this->_byName[name];
+    if (t == nullptr) {
+        this->_timers.push_back (std::make_unique<llvm::Timer>(name, name, this->_group));
+        t = this->_timers.back().get();
+    }
+    return t;
+
+} // PassTimers::timer
+
+llvm::Timer *PassTimers::getPassTimer (llvm::Pass *pass)
+{
+    llvm::Timer *&t = this->_byPass[pass];
+    if (t == nullptr) {
+        llvm::StringRef name = pass->getPassName();
+        if (auto info = llvm::Pass::lookupPassInfo(pass->getPassID())) {
+            if (! info->getPassArgument().empty()) {
+                name = info->getPassArgument();
+            }
+        }
+        this->_timers.push_back (
+            std::make_unique<llvm::Timer>(name, pass->getPassName(), this->_group));
+        t = this->_timers.back().get();
+    }
+    return t;
+
+} // PassTimers::getPassTimer
+
+void PassTimers::collect (std::vector<PassTiming> &passes)
+{
+    for (auto &t : this->_timers) {
+        if (! t->hasTriggered()) {
+            continue;
+        }
+        llvm::TimeRecord time = t->getTotalTime();
+
+        // find or create the entry for the pass
+        auto p = std::find_if (passes.begin(), passes.end(),
+            [&t] (PassTiming const &q) { return q.name == t->getName(); });
+        if (p == passes.end()) {
+            passes.push_back (PassTiming{t->getName(), 0, 0.0, 0.0, 0.0});
+            p = passes.end() - 1;
+        }
+        p->count++;
+        p->wallTime += time.getWallTime();
+        p->userTime += time.getUserTime();
+        p->sysTime += time.getSystemTime();
+
+        t->clear();
+    }
+
+  // the legacy-pass timers are keyed by the address of the pass, which may be
+  // reused by later pipelines, so we start over with a fresh set of timers
+    this->_byName.clear();
+    this->_byPass.clear();
+    this->_timers.clear();
+
+} // PassTimers::collect
+
+// the greedy register allocator reports the spill and reload counts for each
+// function as a "FunctionSpillReload" analysis remark and the prologue/epilogue
+// inserter reports the spill-area size of each JWA function as a "JWASpillArea"
+// remark.  The assembly printer reports the number of machine instructions in
+// each function as an "InstructionCount" remark.  These remarks are only generated
+// when a handler asks for the analysis remarks of the "regalloc", "prologepilog",
+// and "asm-printer" passes.  Asking for them also makes these passes do extra
+// work (e.g., the allocator walks every function to count its spills), so the
+// handler only asks when the statistics are being collected.
+//
+class RegAllocStatsHandler : public llvm::DiagnosticHandler {
+  public:
+    RegAllocStatsHandler (CodeGenStats &stats, bool remarks)
+      : _stats(stats), _remarks(remarks)
+    { }
+
+    bool isAnalysisRemarkEnabled (llvm::StringRef passName) const override
+    {
+        return this->_remarks
+            && ((passName == "regalloc") || (passName == "prologepilog")
+                || (passName == "asm-printer"));
+    }
+
+    bool handleDiagnostics (llvm::DiagnosticInfo const &di) override
+    {
+        if (auto diag = llvm::dyn_cast<llvm::DiagnosticInfoStackSize>(&di)) {
+            if (diag->getSeverity() != llvm::DS_Error) {
+                return false;
+            }
+            llvm::errs() << "spill area of '" << diag->getFunction().getName()
+                << "' (" << diag->getStackSize() << " bytes) exceeds the budget ("
+                << diag->getStackLimit() << " bytes)\n";
+            this->_stats.numSpillBudgetErrors++;
+            return true;
+        }
+
+        auto remark = llvm::dyn_cast<llvm::DiagnosticInfoOptimizationBase>(&di);
+        if (remark == nullptr) {
+            return false;
+        }
+        if ((remark->getPassName() == "prologepilog")
+        && (remark->getRemarkName() == "JWASpillArea")) {
+            this->_spillArea (remark);
+            return true;
+        }
+        if ((remark->getPassName() == "asm-printer")
+        && (remark->getRemarkName() == "InstructionCount")) {
+            for (auto const &arg : remark->getArgs()) {
+                unsigned int n;
+                if ((arg.Key == "NumInstructions")
+                && !llvm::StringRef(arg.Val).getAsInteger(10, n)) {
+                    this->_stats.numMachineInstrs += n;
+                }
+            }
+            return true;
+        }
+        if ((remark->getPassName() != "regalloc")
+        || (remark->getRemarkName() != "FunctionSpillReload")) {
+            return false;
+        }
+        for (auto const &arg : remark->getArgs()) {
+            unsigned int n;
+            if ((arg.Key == "BudgetExceeded") && (arg.Val == "true")) {
+                this->_stats.numRABudgetFallbacks++;
+            } else if (llvm::StringRef(arg.Val).getAsInteger(10, n)) {
+                continue;
+            } else if ((arg.Key == "NumSpills") || (arg.Key == "NumFoldedSpills")) {
+                this->_stats.numSpills += n;
+            } else if ((arg.Key == "NumReloads") || (arg.Key == "NumFoldedReloads")) {
+                this->_stats.numReloads += n;
+            }
+        }
+        return true;
+    }
+
+  private:
+    CodeGenStats &_stats;
+    bool _remarks;              // ask for the analysis remarks?
+
+    void _spillArea (llvm::DiagnosticInfoOptimizationBase const *remark)
+    {
+        for (auto const &arg : remark->getArgs()) {
+            unsigned int szb;
+            if ((arg.Key == "NumSpillBytes")
+            && !llvm::StringRef(arg.Val).getAsInteger(10, szb)
+            && (szb > 0)) {
+                this->_stats.spillAreas.push_back (
+                    SpillArea{remark->getFunction().getName().str(), szb});
+                this->_stats.maxSpillAreaSzb =
+                    std::max(this->_stats.maxSpillAreaSzb, szb);
+            }
+        }
+    }
+
+}; // RegAllocStatsHandler
+
+std::unique_ptr<llvm::DiagnosticHandler> CodeGenStats::diagnosticHandler (bool remarks)
+{
+    return std::make_unique<RegAllocStatsHandler>(*this, remarks);
+}
+
+} // namespace cfgcg
+} // namespace smlnj
@@ -0,0 +1,129 @@
+/// \file context-pool.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief Implementation of the `ContextPool` class.
+///
+
+#include "context-pool.hpp"
+#include "context.hpp"
+#include "target-info.hpp"
+
+#include <cassert>
+
+namespace smlnj {
+namespace cfgcg {
+
+ContextPool::ContextPool (size_t capacity)
+  : _capacity(capacity), _nCreated(0), _nHits(0)
+{
+}
+
+ContextPool::~ContextPool ()
+{
+    for (auto &ent : this->_entries) {
+        delete ent.cxt;
+    }
+
+} // ContextPool destructor
+
+size_t ContextPool::size () const
+{
+    std::lock_guard<std::mutex> lock(this->_mu);
+    return this->_entries.size();
+
+} // ContextPool::size
+
+Context *ContextPool::acquire (
+    std::string const &target,
+    std::string const &cpu,
+    std::string const &features,
+    llvm::CodeGenOpt::Level optLvl)
+{
+    std::thread::id self = std::this_thread::get_id();
+
+    {
+        std::lock_guard<std::mutex> lock(this->_mu);
+
+        // look for an idle context with a matching key
+        for (auto it = this->_entries.begin();  it != this->_entries.end();  ++it) {
+            if (!it->inUse && (it->optLvl == optLvl) && (it->target == target)
+            && (it->cpu == cpu) && (it->features == features)) {
+                it->inUse = true;
+                it->owner = self;
+                this->_nHits++;
+                // move the entry to the front of the list
+                this->_entries.splice (this->_entries.begin(), this->_entries, it);
+                return it->cxt;
+            }
+        }
+    }
+
+    // create a new context without holding the lock, since context creation
+    // is expensive
+    auto tgtInfo = TargetInfo::infoForTarget (target);
+    if (tgtInfo == nullptr) {
+        return nullptr;
+    }
+    Context *cxt = Context::create (tgtInfo, cpu, features, optLvl);
+
+    std::lock_guard<std::mutex> lock(this->_mu);
+    this->_entries.push_front (Entry{target, cpu, features, optLvl, cxt, true, self});
+    this->_nCreated++;
+
+    return cxt;
+
+} // ContextPool::acquire
+
+void ContextPool::release (Context *cxt)
+{
+    assert (cxt->module() == nullptr && "release of context with active module");
+
+    // the next thread to acquire the context expects the default settings
+    cxt->resetSettings ();
+
+    std::lock_guard<std::mutex> lock(this->_mu);
+
+    for (auto it = this->_entries.begin();  it != this->_entries.end();  ++it) {
+        if (it->cxt == cxt) {
+            assert (it->inUse && "release of idle context");
+            assert ((it->owner == std::this_thread::get_id())
+                && "release of context by non-owning thread");
+            it->inUse = false;
+            it->owner = std::thread::id();
+            // the most recently released context is the most recently used
+            this->_entries.splice (this->_entries.begin(), this->_entries, it);
+            this->_evict ();
+            return;
+        }
+    }
+
+    assert (false && "release of unknown context");
+
+} // ContextPool::release
+
+void ContextPool::_evict ()
+{
+    size_t nIdle = 0;
+    for (auto &ent : this->_entries) {
+        if (! ent.inUse) {
+            nIdle++;
+        }
+    }
+
+    // walk the list from the least-recently-used end
+    auto it = this->_entries.end();
+    while ((nIdle > this->_capacity) && (it != this->_entries.begin())) {
+        --it;
+        if (! it->inUse) {
+            delete it->cxt;
+            it = this->_entries.erase (it);
+            nIdle--;
+        }
+    }
+
+} // ContextPool::_evict
+
+} // namespace cfgcg
+} // namespace smlnj
@@ -11,11 +11,17 @@
 #include "context.hpp"
 #include "target-info.hpp"
 #include "mc-gen.hpp"
+#include "sml-heap-aa.hpp"
 #include "cfg.hpp" // for argument setup
 
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+
+#include <algorithm>
 
 namespace smlnj {
 namespace cfgcg {
@@ -34,7 +40,18 @@ namespace cfgcg {
 
 Context *Context::create (const TargetInfo *tgtInfo)
 {
-    Context *buf = new Context (tgtInfo);
+    Context *buf = new Context (tgtInfo, "generic", "", llvm::CodeGenOpt::Less);
+
+    return buf;
+}
+
+Context *Context::create (
+    const TargetInfo *tgtInfo,
+    std::string const &cpu,
+    std::string const &features,
+    llvm::CodeGenOpt::Level optLvl)
+{
+    Context *buf = new Context (tgtInfo, cpu, features, optLvl);
 
     return buf;
 }
@@ -46,20 +63,39 @@ Context *Context::create (std::string const & target)
 	return nullptr;
     }
 
-    Context *buf = new Context (tgtInfo);
+    Context *buf = new Context (tgtInfo, "generic", "", llvm::CodeGenOpt::Less);
 
     return buf;
 }
 
-Context::Context (const TargetInfo *target)
+Context::Context (
+    const TargetInfo *target,
+    std::string const &cpu,
+    std::string const &features,
+    llvm::CodeGenOpt::Level optLvl)
   : _target(target),
     _builder(*this),
     _gen(nullptr),
+    _module(nullptr),
+    _timePasses(false),
+    _collectStats(false),
   // initialize the register info
     _regInfo(target),
-    _regState(this->_regInfo)
+    _regState(this->_regInfo),
+    _allocPrefetchSzb(0),
+    _optForSize(false),
+    _entrySleds(false),
+    _sledTable(nullptr),
+    _symbolFree(false),
+    _entryTable(nullptr),
+    _pinnedRegs(false),
+    _jwaRegAlloc(false),
+    _raBudget(0)
 {
-    this->_gen = new MCGen (*this, target),
+    this->_gen = new MCGen (*this, target, cpu, features, optLvl),
+
+  // the statistics handler reports spill areas that exceed their budget
+    this->enableStats (false);
 
   // initialize the standard types that we use
     this->i8Ty = llvm::IntegerType::get (*this, 8);
@@ -81,10 +117,23 @@ Context::Context (const TargetInfo *target)
     this->objPtrTy = this->mlValueTy->getPointerTo ();
     this->bytePtrTy = this->i8Ty->getPointerTo (ML_HEAP_ADDR_SP);
     this->voidTy = llvm::Type::getVoidTy (*this);
+    this->_immutableMD = immutableFieldTag (*this);
+
+  // "call-gc" and raise_overflow types
+    this->_initRuntimeFnTys ();
+
+  // initialize the overflow block
+    this->_overflowBB = nullptr;
+    this->_pendingOvflw = nullptr;
+    this->_nPendingOvflw = 0;
+
+} // constructor
 
+void Context::_initRuntimeFnTys ()
+{
   // "call-gc" types
     {
-	int n = target->numCalleeSaves + 4;
+	int n = this->_target->numCalleeSaves + 4;
 	Types_t gcTys = this->createParamTys (frag_kind::STD_FUN, n);
 	for (int i = 0;  i < n;  ++i) {
 	    gcTys.push_back (this->mlValueTy);
@@ -93,15 +142,16 @@ Context::Context (const TargetInfo *target)
 	this->_gcFnTy = llvm::FunctionType::get(gcRetTy, gcTys, false);
     }
 
-  // initialize the overflow block and raise_overflow function type
+  // the raise_overflow function type
     {
       // the overflow block and raise_overflow have a minimal calling convention
       // that consists of just the hardware CMachine registers.  These are
       // necessary to ensure that the correct values are in place at the point
-      // where the Overflow exception will be raised.
+      // where the Overflow exception will be raised.  When the registers are
+      // pinned, they are already in place and there are no arguments.
       //
 	Types_t tys;
-	int nArgs = this->_regInfo.numMachineRegs();
+	int nArgs = this->_numRegArgs();
 	tys.reserve (nArgs);
 	for (int i = 0;  i < nArgs;  ++i) {
 	    if (this->_regInfo.machineReg(i)->id() <= CMRegId::STORE_PTR) {
@@ -111,20 +161,58 @@ Context::Context (const TargetInfo *target)
 	    }
 	}
 	this->_raiseOverflowFnTy = llvm::FunctionType::get(this->voidTy, tys, false);
-	this->_overflowBB = nullptr;
     }
 
-} // constructor
+} // Context::_initRuntimeFnTys
+
+Context::~Context ()
+{
+    if (this->_module != nullptr) {
+	this->endModule();
+    }
+    delete this->_gen;
+
+} // destructor
 
 void Context::beginModule (std::string const & src, int nClusters)
 {
     this->_module = new llvm::Module (src, *this);
+    if (this->_symbolFree) {
+      // an empty source-file name suppresses the object file's file symbol
+	this->_module->setSourceFileName ("");
+      // the module flag suppresses the other symbols that LLVM adds on its
+      // own (i.e., the Arm64 mapping symbols)
+	this->_module->addModuleFlag (llvm::Module::Error, "jwa.symbol-free", 1);
+    }
 
     this->_gen->beginModule (this->_module);
 
+  // record a non-default JWA register sequence as a module flag, which is
+  // checked by the calling-convention code in LLVM
+    if (! this->_jwaRegs.empty()) {
+	std::vector<llvm::Metadata *> regs;
+	for (auto const &r : this->_jwaRegs) {
+	    regs.push_back (llvm::MDString::get (*this, r));
+	}
+	this->_module->addModuleFlag (
+	    llvm::Module::Error, "jwa.regs", llvm::MDTuple::get (*this, regs));
+    }
+
+  // record the pinned registers as a module flag, which tells LLVM to reserve
+  // them in JWA functions and to not use them for arguments
+    if (this->_pinnedRegs) {
+	std::vector<llvm::Metadata *> regs;
+	for (auto const &r : this->_pinnedRegNames()) {
+	    regs.push_back (llvm::MDString::get (*this, r));
+	}
+	this->_module->addModuleFlag (
+	    llvm::Module::Error, "jwa.pinned", llvm::MDTuple::get (*this, regs));
+    }
+
   // prepare the label-to-cluster map
     this->_clusterMap.clear();
     this->_clusterMap.reserve(nClusters);
+    this->_entryFns.clear();
 
   // clear the cached intrinsic functions
     this->_sadd32WO = nullptr;
@@ -139,24 +227,293 @@ void Context::beginModule (std::string const & src, int nClusters)
     this->_sqrt64 = nullptr;
     this->_copysign32 = nullptr;
     this->_copysign64 = nullptr;
+    this->_prefetch = nullptr;
     this->_readReg = nullptr;
+    this->_writeReg = nullptr;
     this->_spRegMD = nullptr;
+    this->_spVal = nullptr;
 
 } // Context::beginModule
 
+void Context::beginUnit (int nClusters)
+{
+    this->_clusterMap.clear();
+    this->_clusterMap.reserve(nClusters);
+
+} // Context::beginUnit
+
 void Context::completeModule ()
 {
-}
+    if (this->_entrySleds) {
+	this->_createSledTable ();
+    }
+    if (this->_symbolFree) {
+	this->_createEntryTable ();
+    }
+    if (this->_target->name == "aarch64") {
+      // the Arm64 JWA code addresses its jump tables, constant pools, and local
+      // functions with a single ADR, which has a range of +/-1MB, when the module
+      // has the tiny code model.  We mark modules that are well within that range.
+	if (this->_estimateCodeSize() < (1 << 20)) {
+	    this->_module->setCodeModel (llvm::CodeModel::Tiny);
+	}
+    }
+
+} // Context::completeModule
+
+size_t Context::_estimateCodeSize ()
+{
+  // a conservative estimate: each IR instruction expands to at most two machine
+  // instructions plus two more for each operand (materializing constants, spills,
+  // and jump-table entries)
+    size_t nInstrs = 0;
+    for (auto &fn : this->_module->functions()) {
+	for (auto &bb : fn) {
+	    for (auto &instr : bb) {
+		nInstrs += 2 + 2 * instr.getNumOperands();
+	    }
+	}
+    }
+    return 4 * nInstrs;
+
+} // Context::_estimateCodeSize
+
+void Context::_createSledTable ()
+{
+  // collect the functions that have entry sleds
+    std::vector<llvm::Function *> fns;
+    for (auto &fn : this->_module->functions()) {
+	if (fn.hasFnAttribute ("jwa-entry-sled")) {
+	    fns.push_back (&fn);
+	}
+    }
+
+  // the sled table has the layout
+  //
+  //	struct { i32 nSleds; i32 offsets[nSleds]; }
+  //
+  // where the offsets are relative to the start of the table.  We put the
+  // table in the text section, which means that the offsets are label
+  // differences within a section that are resolved by the assembler (i.e.,
+  // they do not require relocation).
+    auto arrTy = llvm::ArrayType::get (this->i32Ty, fns.size());
+    auto tblTy = llvm::StructType::get (*this, { this->i32Ty, arrTy });
+    auto tbl = new llvm::GlobalVariable (
+	*this->_module,
+	tblTy,
+	true,
+	this->_symbolFree
+	    ? llvm::GlobalValue::PrivateLinkage
+	    : llvm::GlobalValue::ExternalLinkage,
+	nullptr,
+	this->_namedValues() ? "__sml_sled_table" : "");
+    auto tblAddr = llvm::ConstantExpr::getPtrToInt(tbl, this->intTy);
+    std::vector<llvm::Constant *> offsets;
+    for (auto fn : fns) {
+	offsets.push_back (llvm::ConstantExpr::getTrunc (
+	    llvm::ConstantExpr::getSub (
+		llvm::ConstantExpr::getPtrToInt(fn, this->intTy),
+		tblAddr),
+	    this->i32Ty));
+    }
+    tbl->setInitializer (llvm::ConstantStruct::get (tblTy, {
+	    this->i32Const (fns.size()),
+	    llvm::ConstantArray::get (arrTy, offsets)
+	}));
+    tbl->setAlignment (llvm::MaybeAlign(4));
+#if defined(OPSYS_DARWIN)
+    tbl->setSection ("__TEXT,__text,regular,pure_instructions");
+#else
+    tbl->setSection (".text");
+#endif
+
+    this->_sledTable = tbl;
+
+} // Context::_createSledTable
+
+void Context::_createEntryTable ()
+{
+  // the entry table replaces the symbol-table entries for the entry functions
+  // and the sled table (see `entryTable` for the layout).  Like the sled table,
+  // the entry table is in the text section, so its offsets are resolved by the
+  // assembler.  Global variables are emitted after the functions, so the table
+  // ends the text section when it is the last global of the module (see
+  // `compile`).  `CodeObject` reads it from there and checks the magic number.
+    auto arrTy = llvm::ArrayType::get (this->i32Ty, this->_entryFns.size());
+    auto tblTy = llvm::StructType::get (
+	*this, { arrTy, this->i32Ty, this->i32Ty, this->i32Ty });
+    auto tbl = new llvm::GlobalVariable (
+	*this->_module,
+	tblTy,
+	true,
+	llvm::GlobalValue::PrivateLinkage,
+	nullptr,
+	"");
+    auto tblAddr = llvm::ConstantExpr::getPtrToInt(tbl, this->intTy);
+    auto offsetOf = [this, tblAddr] (llvm::Constant *v) {
+	return llvm::ConstantExpr::getTrunc (
+	    llvm::ConstantExpr::getSub (
+		llvm::ConstantExpr::getPtrToInt(v, this->intTy),
+		tblAddr),
+	    this->i32Ty);
+    };
+    std::vector<llvm::Constant *> offsets;
+    for (auto fn : this->_entryFns) {
+	offsets.push_back (offsetOf (fn));
+    }
+    tbl->setInitializer (llvm::ConstantStruct::get (tblTy, {
+	    llvm::ConstantArray::get (arrTy, offsets),
+	    (this->_sledTable != nullptr) ? offsetOf (this->_sledTable) : this->i32Const(0),
+	    this->i32Const (this->_entryFns.size()),
+	    this->i32Const (CodeObject::kEntryTableMagic)
+	}));
+    tbl->setAlignment (llvm::MaybeAlign(4));
+#if defined(OPSYS_DARWIN)
+    tbl->setSection ("__TEXT,__text,regular,pure_instructions");
+#else
+    tbl->setSection (".text");
+#endif
+
+    this->_entryTable = tbl;
+
+} // Context::_createEntryTable
 
 void Context::optimize ()
 {
+    auto start = llvm::TimeRecord::getCurrentTime(true);
     this->_gen->optimize (this->_module);
+    auto stop = llvm::TimeRecord::getCurrentTime(false);
+    this->_stats.optimizeTime += stop.getWallTime() - start.getWallTime();
+
+    if (this->_timePasses) {
+        this->_gen->collectIRPassTimings (this->_stats.irPasses);
+    }
+
+}
+
+void Context::enableStats (bool enable)
+{
+    this->_collectStats = enable;
+    this->setDiagnosticHandler (this->_stats.diagnosticHandler(enable));
 }
 
+void Context::enablePassTiming (bool enable)
+{
+    this->_timePasses = enable;
+    this->_gen->enablePassTiming (enable);
+}
+
+bool Context::setOptPipeline (std::vector<std::string> const &passes)
+{
+    return this->_gen->setPipeline (passes);
+}
+
+std::vector<std::string> const &Context::optPipeline () const
+{
+    return this->_gen->pipeline ();
+}
+
+std::vector<std::string> const &Context::defaultOptPipeline ()
+{
+    return MCGen::defaultPipeline ();
+}
+
+std::vector<std::string> Context::availableOptPasses ()
+{
+    return MCGen::availablePasses ();
+}
+
+void Context::setPinnedRegs (bool enable)
+{
+    assert ((this->_module == nullptr) && "cannot change pinning inside a module");
+    this->_pinnedRegs = enable;
+    this->_initRuntimeFnTys ();
+
+} // Context::setPinnedRegs
+
+std::vector<std::string> Context::_pinnedRegNames () const
+{
+    auto names = this->_target->pinnedRegisters();
+    if (! this->_jwaRegs.empty()) {
+      // the pinned registers are the prefix of the overridden JWA sequence
+	std::vector<std::string> seq = this->_jwaRegs;
+	for (auto const &r : this->_target->jwaRegisters()) {
+	    if (std::find(seq.begin(), seq.end(), r) == seq.end()) {
+		seq.push_back (r);
+	    }
+	}
+	names.assign (seq.begin(), seq.begin() + names.size());
+    }
+
+    return names;
+
+} // Context::_pinnedRegNames
+
+bool Context::setJWARegisters (std::vector<std::string> const &regs)
+{
+    auto dflt = this->_target->jwaRegisters();
+    if (dflt.empty()) {
+	return regs.empty();
+    }
+    for (size_t i = 0;  i < regs.size();  i++) {
+	if (std::find(dflt.begin(), dflt.end(), regs[i]) == dflt.end()) {
+	    return false;
+	}
+	if (std::find(regs.begin(), regs.begin() + i, regs[i]) != regs.begin() + i) {
+	    return false;
+	}
+    }
+
+    this->_jwaRegs = regs;
+    return true;
+
+}
+
+void Context::setGlobalISel (bool enable)
+{
+    this->_gen->setGlobalISel (enable);
+}
+
+bool Context::globalISelEnabled () const
+{
+    return this->_gen->globalISel ();
+}
+
+void Context::setOptimizeForSize (bool enable)
+{
+    this->_optForSize = enable;
+  // the machine outliner is only enabled in the target machine for size
+    this->_gen->setOptimizeForSize (enable);
+}
+
+void Context::resetSettings ()
+{
+    assert ((this->_module == nullptr) && "cannot reset settings inside a module");
+
+    this->setAllocPrefetch (0);
+    this->_jwaRegs.clear();
+    this->setPinnedRegs (false);
+    this->setOptimizeForSize (false);
+    this->setEntrySleds (false);
+    this->setJWARegAlloc (false);
+    this->setSymbolFree (false);
+    this->setGlobalISel (false);
+    if (this->optPipeline() != defaultOptPipeline()) {
+	this->setOptPipeline (defaultOptPipeline());
+    }
+    this->enableStats (false);
+    this->enablePassTiming (false);
+
+} // Context::resetSettings
+
 void Context::endModule ()
 {
     this->_gen->endModule();
     delete this->_module;
+    this->_module = nullptr;
+    this->_entryFns.clear();
+    this->_sledTable = nullptr;
+    this->_entryTable = nullptr;
 }
 
 void Context::beginCluster (CFG::cluster *cluster, llvm::Function *fn)
@@ -169,6 +526,7 @@ void Context::beginCluster (CFG::cluster *cluster, llvm::Function *fn)
     this->_fragMap.clear();
     this->_curFn = fn;
     this->_curCluster = cluster;
+    this->_spVal = nullptr;
 
 } // Context::beginCluster
 
@@ -178,6 +536,7 @@ void Context::endCluster ()
 
 void Context::beginFrag ()
 {
+    assert ((this->_pendingOvflw == nullptr) && "unexpected pending overflow check");
     this->_vMap.clear();
 
 } // Context::beginFrag
@@ -187,10 +546,13 @@ llvm::Function *Context::newFunction (
     std::string const &name,
     bool isPublic)
 {
+  // in symbol-free mode, the entry functions are located using the entry
+  // table, so all functions are unnamed private functions
+    bool isExternal = isPublic && !this->_symbolFree;
     llvm::Function *fn = llvm::Function::Create (
 	    fnTy,
-	    isPublic ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::PrivateLinkage,
-	    name,
+	    isExternal ? llvm::GlobalValue::ExternalLinkage : llvm::GlobalValue::PrivateLinkage,
+	    this->_namedValues() ? name : "",
 	    this->_module);
 
   // set the calling convention to our "Jump-with-arguments" convention
@@ -198,6 +560,25 @@ llvm::Function *Context::newFunction (
 
   // assign attributes to the function
     fn->addFnAttr (llvm::Attribute::Naked);
+  // SML code does not use the native unwinder, so we do not need unwind tables
+  // (i.e., ".eh_frame" sections and their relocations)
+    fn->addFnAttr (llvm::Attribute::NoUnwind);
+    if (this->_optForSize) {
+	fn->addFnAttr (llvm::Attribute::OptimizeForSize);
+	fn->addFnAttr (llvm::Attribute::MinSize);
+    }
+    if (this->_entrySleds) {
+	fn->addFnAttr ("jwa-entry-sled");
+    }
+  // the spill slots must fit in the runtime's spill area
+    fn->addFnAttr ("jwa-spill-budget", std::to_string(this->_target->spillAreaSzb));
+    if (this->_jwaRegAlloc) {
+	fn->addFnAttr ("jwa-regalloc", std::to_string(this->_raBudget));
+    }
+
+    if (isPublic) {
+	this->_entryFns.push_back (fn);
+    }
 
     return fn;
 
@@ -209,7 +590,7 @@ Context::arg_info Context::_getArgInfo (frag_kind kind) const
 {
     Context::arg_info info;
 
-    info.nExtra = this->_regInfo.numMachineRegs();
+    info.nExtra = this->_numRegArgs();
 
     switch (kind) {
       case frag_kind::STD_FUN:
@@ -350,20 +731,22 @@ void Context::setupStdEntry (CFG::attrs *attrs, CFG::frag *frag)
 
     arg_info info = this->_getArgInfo(frag->get_kind());
 
-  // initialize the register state
+  // initialize the register state; pinned registers are read on demand
     for (int i = 0, hwIx = 0;  i < CMRegInfo::NUM_REGS;  ++i) {
 	CMRegInfo const *info = this->_regInfo.info(static_cast<CMRegId>(i));
-	if (info->isMachineReg()) {
+	if (info->isMachineReg() && !this->_pinnedRegs) {
 	    llvm::Argument *arg = this->_curFn->getArg(hwIx++);
 #ifndef NO_NAMES
 	    arg->setName (info->name());
 #endif
 	    this->_regState.set (info->id(), arg);
 	}
-	else { // stack-allocated register
+	else { // stack-allocated or pinned register
 	    this->_regState.set (info->id(), nullptr);
 	}
     }
+    this->_regState.clearDirty ();
+    this->_regState.setEntryAllocPtr ();
 
   // initialize the base pointer (if necessary)
     if (this->_regInfo.usesBasePtr()
@@ -371,9 +754,9 @@ void Context::setupStdEntry (CFG::attrs *attrs, CFG::frag *frag)
       // get the index of the register that holds the base address of the cluster
 	int baseIx = (frag->get_kind() == frag_kind::STD_FUN)
 	  // STDLINK holds the function's address and is the first non-special argument.
-	    ? this->_regInfo.numMachineRegs()
+	    ? info.nExtra
 	  // STDCONT holds the function's address and is the third non-special argument.
-	    : this->_regInfo.numMachineRegs() + 2;
+	    : info.nExtra + 2;
       // get base address of cluster and cast to the native int type
 	auto basePtr = this->createPtrToInt (this->_curFn->getArg(baseIx));
 	this->_regState.setBasePtr (basePtr);
@@ -401,11 +784,14 @@ void Context::setupFragEntry (CFG::frag *frag, std::vector<llvm::PHINode *> &phi
 
     arg_info info = this->_getArgInfo (frag->get_kind());
 
-  // initialize the register state
+  // initialize the register state; the stack-allocated registers are written back
+  // at the end of the predecessor fragments, so we reload them on demand
     for (int i = 0;  i < info.nExtra;  ++i) {
 	CMRegInfo const *rInfo = this->_regInfo.machineReg(i);
 	this->_regState.set (rInfo->id(), phiNodes[i]);
     }
+    this->_invalidateMemRegs ();
+    this->_regState.setEntryAllocPtr ();
 
     if (info.basePtr) {
       // we are using a base pointer
@@ -420,6 +806,15 @@ void Context::setupFragEntry (CFG::frag *frag, std::vector<llvm::PHINode *> &phi
 
 } // Context::setupFragEntry
 
+bool Context::_namedValues () const
+{
+#ifdef NO_NAMES
+    return ! this->_symbolFree;
+#else
+    return true;
+#endif
+}
+
 llvm::Constant *Context::createGlobalAlias (
     llvm::Type *ty,
     llvm::Twine const &name,
@@ -429,7 +824,7 @@ llvm::Constant *Context::createGlobalAlias (
 	ty,
 	0,
 	llvm::GlobalValue::PrivateLinkage,
-	name,
+	this->_namedValues() ? name : llvm::Twine(),
 	v,
 	this->_module);
     alias->setUnnamedAddr (llvm::GlobalValue::UnnamedAddr::Global);
@@ -508,20 +903,89 @@ void Context::_initSPAccess ()
 	*this,
 	llvm::MDString::get(*this, this->_target->spName));
 
+  // metadata for accessing the pinned registers
+    if (this->_pinnedRegs) {
+	this->_writeReg = _getIntrinsic (llvm::Intrinsic::write_register, this->intTy);
+	auto names = this->_pinnedRegNames();
+	for (int i = 0;  i < names.size();  ++i) {
+	    this->_pinnedMD[i] = llvm::MDNode::get (
+		*this,
+		llvm::MDString::get(*this, names[i]));
+	}
+    }
+
 }
 
-// private function for loading a special register from memory
+llvm::Value *Context::_pinnedRegMD (CMRegId r)
+{
+    if (this->_readReg == nullptr) {
+	this->_initSPAccess();
+    }
+    int idx = this->_regInfo.info(r)->index();
+    assert ((0 <= idx) && (idx < this->_regInfo.numMachineRegs()));
+    return llvm::MetadataAsValue::get(*this, this->_pinnedMD[idx]);
+
+}
+
+llvm::Value *Context::_stackPtr ()
+{
+    if (this->_spVal == nullptr) {
+	if (this->_readReg == nullptr) {
+	    this->_initSPAccess();
+	}
+      // JWA functions are naked, so the stack pointer is invariant over the body of
+      // the function.  We read it once at the beginning of the entry block, which
+      // dominates all of its uses.
+	llvm::BasicBlock &entryBB = this->_curFn->getEntryBlock();
+	llvm::IRBuilder<> entryBuilder (&entryBB, entryBB.getFirstInsertionPt());
+	this->_spVal = entryBuilder.CreateCall(
+	    this->_readReg->getFunctionType(),
+	    this->_readReg,
+	    { llvm::MetadataAsValue::get(*this, this->_spRegMD) });
+#ifndef NO_NAMES
+	this->_spVal->setName ("sp");
+#endif
+    }
+
+    return this->_spVal;
+
+} // Context::_stackPtr
+
+// private function for loading a special register from memory or from its
+// pinned hardware register
 llvm::Value *Context::_loadMemReg (CMRegId r)
 {
     auto info = this->_regInfo.info(r);
+    if (info->isMachineReg()) {
+	assert (this->_pinnedRegs && "expected pinned register");
+	llvm::Value *v = this->_builder.CreateCall(
+	    this->_readReg->getFunctionType(),
+	    this->_readReg,
+	    { this->_pinnedRegMD(r) });
+	v = this->createIntToPtr (v,
+	    (r <= CMRegId::STORE_PTR) ? this->objPtrTy : this->mlValueTy);
+#ifndef NO_NAMES
+	v->setName (info->name());
+#endif
+	return v;
+    }
     return this->_loadFromStack (info->offset(), info->name());
 
 } // Context::_loadMemReg
 
-// private function for setting a special memory register
+// private function for setting a special memory register or a pinned
+// hardware register
 void Context::_storeMemReg (CMRegId r, llvm::Value *v)
 {
     auto info = this->_regInfo.info(r);
+    if (info->isMachineReg()) {
+	assert (this->_pinnedRegs && "expected pinned register");
+	this->_builder.CreateCall(
+	    this->_writeReg->getFunctionType(),
+	    this->_writeReg,
+	    { this->_pinnedRegMD(r), this->asInt(v) });
+	return;
+    }
     auto stkAddr = this->stkAddr (v->getType()->getPointerTo(), info->offset());
     this->_builder.CreateAlignedStore (
 	v,
@@ -530,6 +994,32 @@ void Context::_storeMemReg (CMRegId r, llvm::Value *v)
 
 } // Context::_storeMemReg
 
+void Context::writeBackMemRegs ()
+{
+    for (int i = 0;  i < CMRegInfo::NUM_REGS;  ++i) {
+	CMRegId r = static_cast<CMRegId>(i);
+	if (this->_regState.isDirty(r)) {
+	    this->_storeMemReg (r, this->_regState.get(r));
+	    this->_regState.clearDirty(r);
+	}
+    }
+
+} // Context::writeBackMemRegs
+
+// private function for discarding the cached values of the stack-allocated
+// and pinned registers, which forces them to be reloaded on their next use
+void Context::_invalidateMemRegs ()
+{
+    for (int i = 0;  i < CMRegInfo::NUM_REGS;  ++i) {
+	CMRegInfo const *info = this->_regInfo.info(static_cast<CMRegId>(i));
+	if (info->isMemReg() || this->_pinnedRegs) {
+	    this->_regState.set (info->id(), nullptr);
+	}
+    }
+    this->_regState.clearDirty ();
+
+} // Context::_invalidateMemRegs
+
 // utility function for allocating a record of ML values (pointers or
 // tagged ints).
 //
@@ -560,6 +1050,29 @@ llvm::Value *Context::allocRecord (llvm::Value *desc, Args_t const & args)
     return obj;
 }
 
+void Context::prefetchAllocPtr ()
+{
+    if (this->_allocPrefetchSzb == 0) {
+	return;
+    }
+
+  // if the fragment did not allocate, then the prefetch for the current
+  // allocation pointer was issued by the fragment's predecessor
+    if (this->_pinnedRegs
+	? !this->_regState.isDirty(CMRegId::ALLOC_PTR)
+	: (this->mlReg (CMRegId::ALLOC_PTR) == this->_regState.getEntryAllocPtr())) {
+	return;
+    }
+    llvm::Value *allocPtr = this->mlReg (CMRegId::ALLOC_PTR);
+
+  // prefetch for writing (1) with maximal temporal locality (3) into the data cache (1)
+    this->_builder.CreateCall (
+	this->prefetch(),
+	{ this->createGEP (this->bytePtrTy, allocPtr, this->_allocPrefetchSzb),
+	  this->i32Const(1), this->i32Const(3), this->i32Const(1) });
+
+} // Context::prefetchAllocPtr
+
 void Context::callGC (
     Args_t const & roots,
     std::vector<LambdaVar::lvar> const & newRoots)
@@ -567,6 +1080,10 @@ void Context::callGC (
     assert ((this->_gcFnTy->getNumParams() == roots.size())
 	&& "arity mismatch in GC call");
 
+  // the GC may update the stack-allocated registers, so we write back any
+  // modified values before the call and reload them on demand after it
+    this->writeBackMemRegs ();
+
   // get the address of the "call-gc" entry
     llvm::Value *callGCFn = this->_loadFromStack (this->_target->callGCOffset, "callGC");
 
@@ -579,18 +1096,24 @@ void Context::callGC (
     call->setCallingConv (llvm::CallingConv::JWA);
     call->setTailCallKind (llvm::CallInst::TCK_NoTail);
 
-  // restore the register state from the return struct
+  // restore the register state from the return struct; the pinned registers
+  // are updated in place by the GC
     for (unsigned i = 0, hwIx = 0;  i < CMRegInfo::NUM_REGS;  ++i) {
 	CMRegInfo const *info = this->_regInfo.info(static_cast<CMRegId>(i));
-	if (info->isMachineReg()) {
+	if (info->isMachineReg() && !this->_pinnedRegs) {
 	    auto reg = this->_builder.CreateExtractValue(call, { hwIx });
 	    this->setMLReg (info->id(), reg);
 	    hwIx++;
 	}
     }
+    this->_invalidateMemRegs ();
+
+  // the allocation pointer returned by the GC has not been bumped, so there is
+  // nothing to prefetch unless the rest of the fragment allocates
+    this->_regState.setEntryAllocPtr ();
 
   // extract the new roots from the return struct
-    unsigned ix = this->_regInfo.numMachineRegs();
+    unsigned ix = this->_numRegArgs();
     for (auto lv : newRoots) {
 	this->insertVal (lv, this->_builder.CreateExtractValue(call, { ix++ }));
     }
@@ -640,34 +1163,80 @@ llvm::Function *Context::_getIntrinsic (llvm::Intrinsic::ID id, llvm::Type *ty)
 std::unique_ptr<CodeObject> Context::compile ()
 {
     /* generate code into the object-file backing store */
+    unsigned int nSpillErrors = this->_stats.numSpillBudgetErrors;
+    if (this->_entryTable != nullptr) {
+      // the entry table must end the text section, so we make it the last
+      // global, since globals are emitted in order after the functions
+	auto &globals = this->_module->getGlobalList();
+	globals.splice (globals.end(), globals, this->_entryTable->getIterator());
+    }
+    auto start = llvm::TimeRecord::getCurrentTime(true);
     this->_gen->compile (this);
+    auto stop = llvm::TimeRecord::getCurrentTime(false);
+    this->_stats.codegenTime += stop.getWallTime() - start.getWallTime();
+    this->_stats.numModules++;
+    this->_stats.objectSzb += this->_objFileOS.str().size();
+  // the machine outliner adds its functions to the module
+    for (auto &fn : *this->_module) {
+	if (fn.getName().startswith("OUTLINED_FUNCTION_")) {
+	    this->_stats.numOutlinedFunctions++;
+	}
+    }
+    if (this->_timePasses) {
+        this->_gen->collectMCPassTimings (this->_stats.mcPasses);
+    }
+  // the code is not usable if a cluster's spill slots overflow the spill area
+    if (this->_stats.numSpillBudgetErrors != nSpillErrors) {
+	return std::unique_ptr<CodeObject>();
+    }
     /* create the code object from the backing store */
     return CodeObject::create (this);
 }
 
-void Context::dumpAsm () const
+bool Context::dumpAsm () const
 {
-    this->_gen->dumpCode (this->_module, "-", true);
+    return this->dumpAsm ("-");
 }
 
-void Context::dumpAsm (std::string const &stem) const
+bool Context::dumpAsm (std::string const &stem) const
 {
-    this->_gen->dumpCode (this->_module, stem, true);
+    unsigned int nSpillErrors = this->_stats.numSpillBudgetErrors;
+    return this->_gen->dumpCode (this->_module, stem, true)
+	&& (this->_stats.numSpillBudgetErrors == nSpillErrors);
 }
 
-void Context::dumpObj (std::string const &stem) const
+bool Context::dumpObj (std::string const &stem) const
 {
-    this->_gen->dumpCode (this->_module, stem, false);
+    unsigned int nSpillErrors = this->_stats.numSpillBudgetErrors;
+    return this->_gen->dumpCode (this->_module, stem, false)
+	&& (this->_stats.numSpillBudgetErrors == nSpillErrors);
 }
 
 // dump the current module to stderr
 void Context::dump () const
 {
-#if defined(_DEBUG) || defined(LLVM_ENABLE_DUMP)
-    this->_module->dump();
-#endif
+  // we use `print`, since `dump` is only available in debug builds of LLVM
+    this->_module->print (llvm::errs(), nullptr);
 }
 
+// read an LLVM assembly file as the current module
+bool Context::readModule (std::string const &file)
+{
+    llvm::SMDiagnostic err;
+    auto module = llvm::parseIRFile (file, err, *this);
+    if (! module) {
+	err.print (file.c_str(), llvm::errs());
+	return false;
+    }
+    this->_module = module.release();
+    this->_gen->beginModule (this->_module);
+    this->_clusterMap.clear();
+    this->_entryFns.clear();
+
+    return true;
+
+} // Context::readModule
+
 // run the LLVM verifier on the module
 bool Context::verify () const
 {
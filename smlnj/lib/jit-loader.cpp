@@ -0,0 +1,336 @@
+/// \file jit-loader.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief Implementation of the `JITLoader` class.
+///
+
+#include "jit-loader.hpp"
+#include "context.hpp"
+
+#include "llvm/ExecutionEngine/JITLink/JITLink.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/Support/Error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace smlnj {
+namespace cfgcg {
+
+namespace jitlink = llvm::jitlink;
+
+using ProtectionFlags = jitlink::JITLinkMemoryManager::ProtectionFlags;
+
+// round `n` up to a multiple of `align`, which must be a power of two
+static inline size_t alignUp (size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+static llvm::Error makeError (llvm::Twine const &msg)
+{
+    return llvm::make_error<llvm::StringError>(msg, llvm::inconvertibleErrorCode());
+}
+
+//==============================================================================
+
+// An allocation that places all of the segments of a link graph contiguously
+// in a code arena.  JITLink fixes up the code in a working buffer, which is
+// copied into the arena when the allocation is finalized.
+//
+class ArenaAllocation : public jitlink::JITLinkMemoryManager::Allocation {
+  public:
+    struct Segment {
+        size_t offset;          // offset of the segment in the code
+        size_t szb;             // size of the segment (including zero fill)
+    };
+
+    ArenaAllocation (
+        CodeArena &arena,
+        CodeArena::Code *code,
+        llvm::DenseMap<unsigned, Segment> segs)
+      : _arena(arena), _code(code), _segs(std::move(segs)), _working(code->size(), 0)
+    { }
+
+    ~ArenaAllocation () override
+    {
+        assert ((this->_code == nullptr) && "allocation was not deallocated");
+    }
+
+    llvm::MutableArrayRef<char> getWorkingMemory (ProtectionFlags seg) override
+    {
+        auto &s = this->_segs[seg];
+        return llvm::MutableArrayRef<char>(this->_working.data() + s.offset, s.szb);
+    }
+
+    llvm::JITTargetAddress getTargetMemory (ProtectionFlags seg) override
+    {
+        return llvm::pointerToJITTargetAddress(
+            static_cast<char *>(this->_code->addr()) + this->_segs[seg].offset);
+    }
+
+    void finalizeAsync (FinalizeContinuation onFinalize) override
+    {
+        bool ok = this->_arena.initialize (this->_code,
+            [this] (unsigned char *addr) {
+                std::memcpy (addr, this->_working.data(), this->_working.size());
+            });
+        // release the working memory
+        std::vector<char>().swap (this->_working);
+        if (ok) {
+            onFinalize (llvm::Error::success());
+        } else {
+            onFinalize (makeError ("unable to protect code memory"));
+        }
+    }
+
+    llvm::Error deallocate () override
+    {
+        this->_arena.release (this->_code);
+        this->_code = nullptr;
+        return llvm::Error::success();
+    }
+
+    CodeArena::Code *code () const { return this->_code; }
+
+  private:
+    CodeArena &_arena;
+    CodeArena::Code *_code;
+    llvm::DenseMap<unsigned, Segment> _segs;
+    std::vector<char> _working;
+
+}; // ArenaAllocation
+
+// A JITLink memory manager that allocates from a code arena
+//
+class ArenaMemoryManager : public jitlink::JITLinkMemoryManager {
+  public:
+    explicit ArenaMemoryManager (CodeArena &arena) : _arena(arena) { }
+
+    llvm::Expected<std::unique_ptr<Allocation>>
+    allocate (const SegmentsRequestMap &request) override
+    {
+      // lay out the segments in order of their protection flags, so that
+      // the layout does not depend on the hash-table order
+        std::vector<unsigned> keys;
+        for (auto &ent : request) {
+            if (ent.first & llvm::sys::Memory::MF_WRITE) {
+                return makeError ("writable segments are not supported");
+            }
+            keys.push_back (ent.first);
+        }
+        std::sort (keys.begin(), keys.end());
+
+        llvm::DenseMap<unsigned, ArenaAllocation::Segment> segs;
+        size_t szb = 0;
+        size_t align = 1;
+        for (auto key : keys) {
+            auto const &req = request.find(key)->second;
+            size_t segAlign = std::max<size_t>(req.getAlignment(), 1);
+            size_t segSzb = req.getContentSize() + req.getZeroFillSize();
+            szb = alignUp (szb, segAlign);
+            segs[key] = ArenaAllocation::Segment{szb, segSzb};
+            szb += segSzb;
+            align = std::max(align, segAlign);
+        }
+
+        CodeArena::Code *code = this->_arena.reserve (std::max<size_t>(szb, 1), align);
+        if (code == nullptr) {
+            return makeError ("unable to allocate code memory");
+        }
+
+        return std::unique_ptr<Allocation>(
+            new ArenaAllocation (this->_arena, code, std::move(segs)));
+    }
+
+  private:
+    CodeArena &_arena;
+
+}; // ArenaMemoryManager
+
+//==============================================================================
+
+// the results of linking a module
+//
+struct LinkResult {
+    std::vector<std::string> entryNames;        // the object-file names of the
+                                                // entry functions
+    std::string sledTblName;                    // the name of the sled table
+                                                // (empty if there is none)
+    std::vector<llvm::JITTargetAddress> entries;
+    llvm::JITTargetAddress sledTbl;
+    std::unique_ptr<jitlink::JITLinkMemoryManager::Allocation> alloc;
+    std::string errMsg;
+
+    bool isRoot (llvm::StringRef name) const
+    {
+        if (!this->sledTblName.empty() && (name == this->sledTblName)) {
+            return true;
+        }
+        return std::find (this->entryNames.begin(), this->entryNames.end(), name)
+            != this->entryNames.end();
+    }
+
+}; // LinkResult
+
+// the context for linking a single module
+//
+class LinkContext : public jitlink::JITLinkContext {
+  public:
+    LinkContext (
+        jitlink::JITLinkMemoryManager &memMngr,
+        llvm::MemoryBufferRef obj,
+        LinkResult &res)
+      : _memMngr(memMngr), _obj(obj), _res(res)
+    { }
+
+    jitlink::JITLinkMemoryManager &getMemoryManager () override
+    {
+        return this->_memMngr;
+    }
+
+    llvm::MemoryBufferRef getObjectBuffer () const override { return this->_obj; }
+
+    void notifyFailed (llvm::Error err) override
+    {
+        this->_res.errMsg = llvm::toString (std::move(err));
+    }
+
+    // SML code objects do not refer to external symbols
+    void lookup (
+        const LookupMap &symbols,
+        std::unique_ptr<jitlink::JITLinkAsyncLookupContinuation> lc) override
+    {
+        if (symbols.empty()) {
+            lc->run (jitlink::AsyncLookupResult());
+        } else {
+            std::string msg = "undefined symbols:";
+            for (auto &sym : symbols) {
+                msg += " " + sym.first.str();
+            }
+            lc->run (makeError (msg));
+        }
+    }
+
+    void notifyResolved (jitlink::LinkGraph &g) override
+    {
+        for (auto sym : g.defined_symbols()) {
+            if (! sym->hasName()) {
+                continue;
+            }
+            auto name = sym->getName();
+            for (size_t i = 0;  i < this->_res.entryNames.size();  ++i) {
+                if (name == this->_res.entryNames[i]) {
+                    this->_res.entries[i] = sym->getAddress();
+                }
+            }
+            if (name == this->_res.sledTblName) {
+                this->_res.sledTbl = sym->getAddress();
+            }
+        }
+    }
+
+    void notifyFinalized (
+        std::unique_ptr<jitlink::JITLinkMemoryManager::Allocation> alloc) override
+    {
+        this->_res.alloc = std::move(alloc);
+    }
+
+    // only the entry functions and the sled table are roots; blocks that
+    // are not reachable from them are pruned from the graph.
+    jitlink::LinkGraphPassFunction getMarkLivePass (llvm::Triple const &) const override
+    {
+        LinkResult const &res = this->_res;
+        return [&res] (jitlink::LinkGraph &g) -> llvm::Error {
+            for (auto sym : g.defined_symbols()) {
+                if (sym->hasName() && res.isRoot(sym->getName())) {
+                    sym->setLive (true);
+                }
+            }
+            return llvm::Error::success();
+        };
+    }
+
+  private:
+    jitlink::JITLinkMemoryManager &_memMngr;
+    llvm::MemoryBufferRef _obj;
+    LinkResult &_res;
+
+}; // LinkContext
+
+//==============================================================================
+
+JITLoader::JITLoader (CodeArena &arena)
+  : _memMngr(new ArenaMemoryManager(arena))
+{
+}
+
+JITLoader::~JITLoader () { }
+
+JITLoader::Code *JITLoader::load (Context *cxt)
+{
+    LinkResult res;
+
+  // get the object-file names of the roots
+    llvm::Mangler mangler;
+    for (auto fn : cxt->entryFunctions()) {
+        llvm::SmallString<64> name;
+        mangler.getNameWithPrefix (name, fn, false);
+        res.entryNames.push_back (name.str());
+    }
+    res.entries.resize (res.entryNames.size(), 0);
+    if (auto tbl = cxt->sledTable()) {
+        llvm::SmallString<64> name;
+        mangler.getNameWithPrefix (name, tbl, false);
+        res.sledTblName = name.str();
+    }
+    res.sledTbl = 0;
+
+  // link the object file; since our lookup and memory manager are synchronous,
+  // the link is complete when `jitLink` returns.
+    auto obj = llvm::MemoryBufferRef(cxt->objectFileOS().str(), "<in-memory object>");
+    jitlink::jitLink (std::make_unique<LinkContext>(*this->_memMngr, obj, res));
+
+    if (! res.alloc) {
+        this->_errMsg = res.errMsg.empty() ? "link failed" : res.errMsg;
+        return nullptr;
+    }
+    for (size_t i = 0;  i < res.entries.size();  ++i) {
+        if (res.entries[i] == 0) {
+            this->_errMsg = "missing entry symbol '" + res.entryNames[i] + "'";
+            llvm::consumeError (res.alloc->deallocate());
+            return nullptr;
+        }
+    }
+
+    Code *code = new Code;
+    auto arenaCode = static_cast<ArenaAllocation *>(res.alloc.get())->code();
+    code->_addr = arenaCode->addr();
+    code->_szb = arenaCode->size();
+    for (auto addr : res.entries) {
+        code->_entries.push_back (llvm::jitTargetAddressToPointer<void *>(addr));
+    }
+    if (res.sledTbl != 0) {
+        code->_sledTbl = llvm::jitTargetAddressToPointer<void *>(res.sledTbl);
+    }
+    code->_alloc = std::move(res.alloc);
+
+    return code;
+
+} // JITLoader::load
+
+void JITLoader::release (Code *code)
+{
+    if (code == nullptr) {
+        return;
+    }
+
+    llvm::consumeError (code->_alloc->deallocate());
+    delete code;
+
+} // JITLoader::release
+
+} // namespace cfgcg
+} // namespace smlnj
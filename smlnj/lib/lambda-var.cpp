@@ -15,12 +15,21 @@
 
 namespace LambdaVar {
 
-    // LVars are represented by positive integers (the Int63.int type on 64-bit
-    // machines).  We use the top 3 bits of the first byte to specify the number
-    // of additional bytes in the representation, and the other 5 bits are the
-    // most-significant bits in the value.
+    // In version 1 pickles, LVars are represented by positive integers (the
+    // Int63.int type on 64-bit machines).  We use the top 3 bits of the first
+    // byte to specify the number of additional bytes in the representation, and
+    // the other 5 bits are the most-significant bits in the value.
     //
-    lvar read_lvar (asdl::instream & is)
+    // In version 2 pickles, an LVar is represented by its signed difference from
+    // the stream's base value, which is the previous LVar in the pickle, since
+    // the variables of a fragment are numbered close to each other.  Tracking
+    // the base here (instead of in the generated CFG readers) keeps the encoding
+    // independent of the structure of the pickle.  The difference is zig-zag
+    // encoded (so that small negative differences are small numbers) and written
+    // as a little-endian sequence of 7-bit groups, where the high bit of each
+    // byte is set when more bytes follow.
+    //
+    static lvar read_lvar_v1 (asdl::instream & is)
     {
         unsigned char b0 = is.getb();
         uint64_t v = b0 & 0x1F;
@@ -38,6 +47,52 @@ namespace LambdaVar {
 	return static_cast<int>(v);
     }
 
+    static lvar read_lvar_v2 (asdl::instream & is)
+    {
+        unsigned char b = is.getb();
+        uint64_t zz = b & 0x7F;
+        for (unsigned int shift = 7;  (b & 0x80) != 0;  shift += 7) {
+            if (shift > 63) {
+                Die ("ASDL decode error: lvar encoding exceeds 64 bits");
+            }
+            b = is.getb();
+            zz |= static_cast<uint64_t>(b & 0x7F) << shift;
+        }
+        int64_t delta = static_cast<int64_t>(zz >> 1) ^ -static_cast<int64_t>(zz & 1);
+        lvar lv = is.base() + delta;
+        is.set_base (lv);
+        return lv;
+    }
+
+    // append the version 2 encoding of an lvar to the transcoder output
+    static void append_lvar_v2 (asdl::transcoder *echo, int64_t base, lvar lv)
+    {
+        int64_t delta = lv - base;
+        uint64_t zz = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+        while (zz >= 0x80) {
+            echo->body.push_back(static_cast<char>(0x80 | (zz & 0x7F)));
+            zz >>= 7;
+        }
+        echo->body.push_back(static_cast<char>(zz));
+    }
+
+    lvar read_lvar (asdl::instream & is)
+    {
+        if (is.version() > 1) {
+            return read_lvar_v2(is);
+        }
+        asdl::transcoder *echo = is.echo();
+        if (echo == nullptr) {
+            return read_lvar_v1(is);
+        }
+        echo->suspended++;
+        lvar lv = read_lvar_v1(is);
+        echo->suspended--;
+        append_lvar_v2 (echo, is.base(), lv);
+        is.set_base (lv);
+        return lv;
+    }
+
     std::vector<lvar> read_lvar_seq (asdl::instream & is)
     {
         unsigned int len = asdl::read_uint(is);
@@ -11,24 +11,110 @@
 #include "target-info.hpp"
 #include "mc-gen.hpp"
 #include "context.hpp"
+#include "sml-heap-aa.hpp"
+
+#include "codegen-stats.hpp"
 
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/OptimizationRemarkEmitter.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Passes/PassBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
-#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/DCE.h"
+#include "llvm/Transforms/Scalar/DeadStoreElimination.h"
+#include "llvm/Transforms/Scalar/EarlyCSE.h"
 #include "llvm/Transforms/Scalar/GVN.h"
+#include "llvm/Transforms/Scalar/InstSimplifyPass.h"
+#include "llvm/Transforms/Scalar/LICM.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include "llvm/Transforms/Scalar/LowerExpectIntrinsic.h"
+#include "llvm/Transforms/Scalar/Reassociate.h"
+#include "llvm/Transforms/Scalar/SCCP.h"
+#include "llvm/Transforms/Scalar/SimplifyCFG.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 
 #include <iostream>
+#include <unordered_map>
 
 namespace smlnj {
 namespace cfgcg {
 
-MCGen::MCGen (llvm::LLVMContext &context, const TargetInfo *info)
-  : _tgtInfo(info)
+// add a pass to a function pass manager
+template <typename PassT>
+static void addPass (llvm::FunctionPassManager &fpm)
+{
+    fpm.addPass (PassT());
+}
+
+// add a loop pass to a function pass manager.  Loop passes can only use the
+// optimization-remark emitter when it has been computed for the function, which
+// is not the case when the loop pass is the first pass of the pipeline.
+template <typename PassT>
+static void addLoopPass (llvm::FunctionPassManager &fpm)
+{
+    fpm.addPass (llvm::RequireAnalysisPass<llvm::OptimizationRemarkEmitterAnalysis, llvm::Function>());
+    fpm.addPass (llvm::createFunctionToLoopPassAdaptor (PassT()));
+}
+
+// the IR passes that can be used in the optimization pipeline
+//
+struct PassDesc {
+    const char *name;                   // the pass's command-line name
+    llvm::StringRef (*passName) ();     // the pass's name in the pass manager
+    void (*add) (llvm::FunctionPassManager &);
+};
+#define PASS(NAME, TY) { NAME, &llvm::TY::name, &addPass<llvm::TY> }
+#define LOOP_PASS(NAME, TY) \
+	{ NAME, &llvm::FunctionToLoopPassAdaptor<llvm::TY>::name, &addLoopPass<llvm::TY> }
+static PassDesc gPasses[] = {
+	PASS("lower-expect", LowerExpectIntrinsicPass),
+	PASS("simplifycfg", SimplifyCFGPass),
+	PASS("instcombine", InstCombinePass),
+	PASS("instsimplify", InstSimplifyPass),
+	PASS("reassociate", ReassociatePass),
+	PASS("early-cse", EarlyCSEPass),
+	PASS("gvn", GVN),
+	PASS("dse", DSEPass),
+	LOOP_PASS("licm", LICMPass),
+	PASS("sccp", SCCPPass),
+	PASS("dce", DCEPass),
+    };
+#undef PASS
+#undef LOOP_PASS
+
+// lookup a pass by name
+static PassDesc const *findPass (std::string const &name)
 {
+    for (auto const &pd : gPasses) {
+	if (name == pd.name) {
+	    return &pd;
+	}
+    }
+    return nullptr;
+}
+
+// the cache of shared target machines; we use weak pointers so that a target
+// machine is deleted once there are no MCGen objects using it.
+//
+static std::mutex gTMCacheLock;
+static std::unordered_map<std::string, std::weak_ptr<MCGen::SharedTargetMachine>> gTMCache;
+
+// create a new target machine
+//
+static std::unique_ptr<llvm::TargetMachine> createTargetMachine (
+    const TargetInfo *info,
+    std::string const &cpu,
+    std::string const &features,
+    llvm::CodeGenOpt::Level optLvl,
+    bool optForSize,
+    bool globalISel)
+{
+  // make sure that the LLVM components for the target have been initialized
+    info->initialize();
+
   // get the LLVM target triple
     llvm::Triple triple = info->getTriple();
 
@@ -44,6 +130,24 @@ MCGen::MCGen (llvm::LLVMContext &context, const TargetInfo *info)
 
     llvm::TargetOptions tgtOptions;
 
+  // select GlobalISel for instruction selection, when requested.  Only the
+  // AArch64 call lowering supports the JWA calling convention, so we use
+  // SelectionDAG for the other targets.  Functions that GlobalISel cannot
+  // handle fall back to SelectionDAG.
+    if (globalISel && (triple.getArch() == llvm::Triple::aarch64)) {
+	tgtOptions.EnableGlobalISel = true;
+	tgtOptions.GlobalISelAbort = llvm::GlobalISelAbortMode::Disable;
+    }
+
+  // when optimizing for size, enable the machine outliner for functions that
+  // are marked `minsize` (see Context::setOptimizeForSize).  Otherwise, we
+  // leave it off so that the code-generation pipeline does not include the
+  // outliner pass.
+    if (optForSize) {
+	tgtOptions.EnableMachineOutliner = true;
+	tgtOptions.SupportsDefaultOutlining = true;
+    }
+
   // make sure that tail calls are optimized
   /* It turns out that setting the GuaranteedTailCallOpt flag to true causes
    * a bug with non-tail JWA calls (the bug is a bogus stack adjustment after
@@ -56,66 +160,217 @@ MCGen::MCGen (llvm::LLVMContext &context, const TargetInfo *info)
 // that are recognized
     std::unique_ptr<llvm::TargetMachine> tgtMachine(target->createTargetMachine(
 	triple.str(),
-	"generic",		/* CPU name */
-	"",			/* features string */
+	cpu,			/* CPU name */
+	features,		/* features string */
 	tgtOptions,
 	llvm::Reloc::PIC_,
 	llvm::None,
-	llvm::CodeGenOpt::Less));
+	optLvl));
 
     if (!tgtMachine) {
 	std::cerr << "**** Fatal error: unable to create target machine\n";
         assert(false);
     }
 
-    this->_tgtMachine = std::move(tgtMachine);
+    return tgtMachine;
+
+} // createTargetMachine
+
+MCGen::MCGen (
+    llvm::LLVMContext &context,
+    const TargetInfo *info,
+    std::string const &cpu,
+    std::string const &features,
+    llvm::CodeGenOpt::Level optLvl)
+  : _tgtInfo(info), _cpu(cpu), _features(features), _optLvl(optLvl),
+    _optForSize(false), _globalISel(false),
+    _pipeline(defaultPipeline()),
+    _timePasses(false),
+    _irTimers("sml-ir-pass", "SML IR pass timing"),
+    _mcTimers("sml-mc-pass", "SML MC pass timing"),
+    _curTimer(nullptr)
+{
+    this->_acquireTargetMachine ();
+
+  // register the analyses with the analysis managers.  We register the
+  // alias-analysis pipeline first, since the pass builder would otherwise
+  // register an empty one.  The pipeline is LLVM's default pipeline extended
+  // with our analysis of the SML heap.
+    llvm::PassBuilder pb(this->_tgtMachine, llvm::PipelineTuningOptions(), llvm::None,
+	&this->_passCallbacks);
+  // the target-transform information comes from the target machine's subtarget
+  // for the function, which the target machine creates on demand and caches.
+  // Since the target machine may be shared with other threads, we hold its lock
+  // while getting the information (the subtarget is never deleted, so using it
+  // afterwards is safe).  This registration takes precedence over the one made
+  // by the pass builder.
+    this->_functionAM.registerPass([this] {
+	    return llvm::TargetIRAnalysis([this] (llvm::Function const &fn) {
+		    std::lock_guard<std::mutex> lock(this->_shared->mu);
+		    return this->_tgtMachine->getTargetTransformInfo(fn);
+		});
+	});
+    this->_functionAM.registerPass([&] {
+	    llvm::AAManager aam = pb.buildDefaultAAPipeline();
+	    aam.registerFunctionAnalysis<SMLHeapAA>();
+	    return aam;
+	});
+    this->_functionAM.registerPass([info] { return SMLHeapAA(info->spName); });
+    pb.registerModuleAnalyses (this->_moduleAM);
+    pb.registerCGSCCAnalyses (this->_cgsccAM);
+    pb.registerFunctionAnalyses (this->_functionAM);
+    pb.registerLoopAnalyses (this->_loopAM);
+    pb.crossRegisterProxies (
+	this->_loopAM, this->_functionAM, this->_cgsccAM, this->_moduleAM);
+
+  // instrumentation to support per-pass timing; we only time the passes that
+  // are part of our pipeline.  A loop pass runs its own passes (e.g., LCSSA and
+  // the loop pass itself) inside of the adaptor, so the timer is stopped by
+  // the pass that started it and not by the inner passes.
+    this->_passCallbacks.registerBeforePassCallback (
+	[this] (llvm::StringRef passID, llvm::Any) {
+	    if (this->_timePasses && (this->_curTimer == nullptr)) {
+		auto it = this->_passNames.find(passID);
+		if (it != this->_passNames.end()) {
+		    this->_curTimer = this->_irTimers.timer(it->second);
+		    this->_curPassID = it->first();
+		    this->_curTimer->startTimer();
+		}
+	    }
+	    return true;
+	});
+    auto stopTimer = [this] (llvm::StringRef passID) {
+	    if ((this->_curTimer != nullptr) && (passID == this->_curPassID)) {
+		this->_curTimer->stopTimer();
+		this->_curTimer = nullptr;
+	    }
+	};
+    this->_passCallbacks.registerAfterPassCallback (
+	[stopTimer] (llvm::StringRef passID, llvm::Any) { stopTimer(passID); });
+    this->_passCallbacks.registerAfterPassInvalidatedCallback (stopTimer);
+
+    this->_buildPipeline ();
 
 } // MCGen constructor
 
+void MCGen::_acquireTargetMachine ()
+{
+  // the code-generation pipeline refers to the current target machine, so we
+  // delete it before we release the machine
+    this->_codeGenPM.reset();
+
+    std::lock_guard<std::mutex> lock(gTMCacheLock);
+
+  // the key must cover every setting that createTargetMachine depends on
+    std::string key = this->_tgtInfo->name + "|" + this->_cpu + "|" + this->_features
+	+ "|" + std::to_string(static_cast<int>(this->_optLvl))
+	+ (this->_optForSize ? "|size" : "")
+	+ (this->_globalISel ? "|gisel" : "");
+
+    this->_shared = gTMCache[key].lock();
+    if (! this->_shared) {
+	this->_shared = std::make_shared<SharedTargetMachine>();
+	this->_shared->tm = createTargetMachine (
+	    this->_tgtInfo, this->_cpu, this->_features, this->_optLvl,
+	    this->_optForSize, this->_globalISel);
+	gTMCache[key] = this->_shared;
+    }
+    this->_tgtMachine = this->_shared->tm.get();
+
+} // MCGen::_acquireTargetMachine
+
+void MCGen::setOptimizeForSize (bool enable)
+{
+    if (this->_optForSize != enable) {
+	this->_optForSize = enable;
+	this->_acquireTargetMachine ();
+    }
+}
+
+void MCGen::setGlobalISel (bool enable)
+{
+    if (this->_globalISel != enable) {
+	this->_globalISel = enable;
+	this->_acquireTargetMachine ();
+    }
+}
+
 void MCGen::beginModule (llvm::Module *module)
 {
   // tell the module about the target machine
     module->setTargetTriple(this->_tgtMachine->getTargetTriple().getTriple());
     module->setDataLayout(this->_tgtMachine->createDataLayout());
 
-  // setup the pass manager
-    this->_passMngr = std::make_unique<llvm::legacy::FunctionPassManager> (module);
-
-  // setup analysis passes
-    this->_passMngr->add(
-	llvm::createTargetTransformInfoWrapperPass(
-	    this->_tgtMachine->getTargetIRAnalysis()));
-/* FIXME: are there other analysis passes that we need? */
-
-  // set up a optimization pipeline following the pattern used in the Manticore
-  // compiler.
-    this->_passMngr->add(llvm::createLowerExpectIntrinsicPass());       /* -lower-expect */
-    this->_passMngr->add(llvm::createCFGSimplificationPass());          /* -simplifycfg */
-    this->_passMngr->add(llvm::createInstructionCombiningPass());       /* -instcombine */
-    this->_passMngr->add(llvm::createReassociatePass());                /* -reassociate */
-    this->_passMngr->add(llvm::createConstantPropagationPass());        /* -constprop */
-    this->_passMngr->add(llvm::createEarlyCSEPass());                   /* -early-cse */
-    this->_passMngr->add(llvm::createGVNPass());                        /* -gvn */
-//    this->_passMngr->add(llvm::createSCCPPass());			/* -sccp */
-    this->_passMngr->add(llvm::createDeadCodeEliminationPass());        /* -dce */
-    this->_passMngr->add(llvm::createCFGSimplificationPass());          /* -simplifycfg */
-    this->_passMngr->add(llvm::createInstructionCombiningPass());       /* -instcombine */
-    this->_passMngr->add(llvm::createCFGSimplificationPass());          /* -simplifycfg */
-
-    this->_passMngr->doInitialization();
-
 } // MCGen::beginModule
 
+void MCGen::_buildPipeline ()
+{
+    this->_passMngr = std::make_unique<llvm::FunctionPassManager>();
+    this->_passNames.clear();
+    for (auto const &name : this->_pipeline) {
+	auto pd = findPass(name);
+	pd->add (*this->_passMngr);
+	this->_passNames[pd->passName()] = name;
+    }
+
+} // MCGen::_buildPipeline
+
+bool MCGen::setPipeline (std::vector<std::string> const &passes)
+{
+    for (auto const &name : passes) {
+	if (findPass(name) == nullptr) {
+	    return false;
+	}
+    }
+    this->_pipeline = passes;
+    this->_buildPipeline ();
+    return true;
+
+}
+
+std::vector<std::string> const &MCGen::defaultPipeline ()
+{
+  // the default optimization pipeline follows the pattern used in the Manticore
+  // compiler.  Note that "instsimplify" replaces the "constprop" pass, which is
+  // not available in the new pass manager.  The "gvn" pass benefits from the
+  // SML heap alias analysis (see sml-heap-aa.hpp), as do the "licm" and "dse"
+  // passes, but the latter two are not in the default pipeline: on the test
+  // pickles they increase the optimization time without changing the code.
+    static std::vector<std::string> pipeline = {
+	    "lower-expect", "simplifycfg", "instcombine", "reassociate",
+	    "instsimplify", "early-cse", "gvn", "dce", "simplifycfg",
+	    "instcombine", "simplifycfg"
+	};
+
+    return pipeline;
+}
+
+std::vector<std::string> MCGen::availablePasses ()
+{
+    std::vector<std::string> names;
+    for (auto const &pd : gPasses) {
+	names.push_back (pd.name);
+    }
+    return names;
+}
+
 void MCGen::endModule ()
 {
-    this->_passMngr.reset();
+  // the cached analysis results refer to the module's functions, which are
+  // about to be deleted
+    this->_loopAM.clear();
+    this->_functionAM.clear();
+    this->_cgsccAM.clear();
+    this->_moduleAM.clear();
 }
 
 void MCGen::optimize (llvm::Module *module)
 {
   // run the function optimizations over every function
     for (auto it = module->begin();  it != module->end();  ++it) {
-        this->_passMngr->run (*it);
+	if (! it->isDeclaration()) {
+	    this->_passMngr->run (*it, this->_functionAM);
+	}
     }
 
 }
@@ -126,19 +381,44 @@ void MCGen::optimize (llvm::Module *module)
 //
 void MCGen::compile (Context *codeBuf)
 {
+    codeBuf->objectFileOS().clear();
+
+  // the code-generation pipeline uses the target machine throughout: building
+  // the pipeline sets the target machine's instruction-selector flags, the
+  // assembly printer initializes the target machine's object-file lowering
+  // with the pipeline's MC context, and the passes create subtargets on demand.
+  // Therefore we must hold the target machine's lock while we build and run
+  // the pipeline.
     {
-        codeBuf->objectFileOS().clear();
-	llvm::legacy::PassManager pass;
-	llvm::MCContext *ctx; /* result parameter */
-	if (this->_tgtMachine->addPassesToEmitMC(pass, ctx, codeBuf->objectFileOS())) {
-	    llvm::report_fatal_error ("unable to add pass to generate code", true);
+	std::lock_guard<std::mutex> lock(this->_shared->mu);
+      // the pipeline is built for the first module and then reused; the legacy
+      // pass manager reinitializes the passes (including the MC context and
+      // the object streamer) at the start of each run (see llc's hidden
+      // "-compile-twice" option, which tests that reuse does not change
+      // the generated code).
+	if (! this->_codeGenPM) {
+	    this->_codeGenPM = std::make_unique<llvm::legacy::PassManager>();
+	    llvm::MCContext *ctx; /* result parameter */
+	    if (this->_tgtMachine->addPassesToEmitMC(
+		*this->_codeGenPM, ctx, codeBuf->objectFileOS()))
+	    {
+		llvm::report_fatal_error ("unable to add pass to generate code", true);
+	    }
+	}
+      // the legacy pass manager gets its pass timers from the thread's source
+	llvm::PassTimerSource *prevTimers = nullptr;
+	if (this->_timePasses) {
+	    prevTimers = llvm::setThreadPassTimerSource (&this->_mcTimers);
+	}
+	this->_codeGenPM->run (*codeBuf->module());
+	if (this->_timePasses) {
+	    llvm::setThreadPassTimerSource (prevTimers);
 	}
-	pass.run (*codeBuf->module());
     }
 
 }
 
-void MCGen::dumpCode (llvm::Module *module, std::string const & stem, bool asmCode) const
+bool MCGen::dumpCode (llvm::Module *module, std::string const & stem, bool asmCode) const
 {
     std::string outFile;
     if (stem != "-") {
@@ -190,20 +470,24 @@ void MCGen::dumpCode (llvm::Module *module, std::string const & stem, bool asmCo
     llvm::raw_fd_ostream outStrm(outFile, EC, llvm::sys::fs::OF_None);
     if (EC) {
         llvm::errs() << "unable to open output file '" << outFile << "'\n";
-        return;
+        return false;
     }
 
+    std::lock_guard<std::mutex> lock(this->_shared->mu);
+
     llvm::legacy::PassManager pass;
     auto outKind = (asmCode ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile);
     if (this->_tgtMachine->addPassesToEmitFile(pass, outStrm, nullptr, outKind)) {
         llvm::errs() << "unable to add pass to generate '" << outFile << "'\n";
-        return;
+        return false;
     }
 
     pass.run(*module);
 
     outStrm.flush();
 
+    return true;
+
 }
 
 } // namespace cfgcg
@@ -12,10 +12,19 @@
 #define _MC_GEN_HPP_
 
 #include "code-object.hpp"
+#include "codegen-stats.hpp"
 
 #include "llvm/IR/Module.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <memory>
+#include <mutex>
 
 namespace smlnj {
 namespace cfgcg {
@@ -23,27 +32,132 @@ namespace cfgcg {
 class MCGen {
   public:
 
-    MCGen (llvm::LLVMContext &context, const TargetInfo *target);
+    MCGen (
+        llvm::LLVMContext &context,
+        const TargetInfo *target,
+        std::string const &cpu,
+        std::string const &features,
+        llvm::CodeGenOpt::Level optLvl);
 
     /// per-module initialization
     void beginModule (llvm::Module *module);
 
-    /// per-module finalization
+    /// per-module finalization; this function discards the cached analysis
+    /// results for the module.
     void endModule ();
 
     /// run the per-function optimizations over the functions of the module
     void optimize (llvm::Module *module);
 
+    /// set the sequence of IR passes used for optimization; the passes are
+    /// specified by their command-line names.  Returns false (and leaves
+    /// the pipeline unchanged) if any of the passes is unknown.  The pass
+    /// manager for the pipeline is constructed once and then reused for
+    /// every module.
+    bool setPipeline (std::vector<std::string> const &passes);
+
+    /// the current IR optimization pipeline
+    std::vector<std::string> const &pipeline () const { return this->_pipeline; }
+
+    /// the default IR optimization pipeline
+    static std::vector<std::string> const &defaultPipeline ();
+
+    /// the names of the IR passes that can be used in a pipeline
+    static std::vector<std::string> availablePasses ();
+
+    /// select GlobalISel (instead of SelectionDAG) for instruction selection.
+    /// This setting only applies to the AArch64 target; it switches to a
+    /// different target machine, so it must not be changed while a module
+    /// is being compiled.
+    void setGlobalISel (bool enable);
+
+    /// is GlobalISel selected?
+    bool globalISel () const { return this->_globalISel; }
+
+    /// enable or disable the machine outliner for functions that are marked
+    /// `minsize`.  This setting switches to a different target machine, so it
+    /// must not be changed while a module is being compiled.
+    void setOptimizeForSize (bool enable);
+
+    /// enable or disable per-pass timing of the pipelines
+    void enablePassTiming (bool enable) { this->_timePasses = enable; }
+
+    /// add the pass timings of the IR optimization pipeline to `passes` and
+    /// reset the timers
+    void collectIRPassTimings (std::vector<PassTiming> &passes)
+    {
+        this->_irTimers.collect (passes);
+    }
+
+    /// add the pass timings of the code-generation pipeline to `passes` and
+    /// reset the timers
+    void collectMCPassTimings (std::vector<PassTiming> &passes)
+    {
+        this->_mcTimers.collect (passes);
+    }
+
     /// dump the code to an output file
-    void dumpCode (llvm::Module *module, std::string const & stem, bool asmCode = true) const;
+    /// \return false if the output file could not be opened or the code could
+    ///         not be generated
+    bool dumpCode (llvm::Module *module, std::string const & stem, bool asmCode = true) const;
 
     /// compile the code into the code buffer's object-file backing store.
+    /// The code-generation pipeline is created by the first call and is reused
+    /// for later calls, so `codeBuf` must always be the context that owns
+    /// this object.
     void compile (class Context *codeBuf);
 
+    /// a target machine that is shared by the MCGen objects that have the
+    /// same target, CPU, features, optimization level, outliner setting, and
+    /// instruction selector.  LLVM target machines are not thread safe, so the
+    /// code-generation pipeline and the queries of the IR optimizer (which
+    /// create subtargets on demand) hold the lock; the rest of the IR
+    /// optimization pipeline runs without it.
+    struct SharedTargetMachine {
+        std::unique_ptr<llvm::TargetMachine> tm;
+        std::mutex mu;
+    };
+
   private:
     const TargetInfo *_tgtInfo;
-    std::unique_ptr<llvm::TargetMachine> _tgtMachine;
-    std::unique_ptr<llvm::legacy::FunctionPassManager> _passMngr;
+    std::string _cpu;
+    std::string _features;
+    llvm::CodeGenOpt::Level _optLvl;
+    bool _optForSize;                   ///< true if the outliner is enabled
+    bool _globalISel;                   ///< true if GlobalISel is selected
+    std::shared_ptr<SharedTargetMachine> _shared;
+    llvm::TargetMachine *_tgtMachine;   ///< == _shared->tm.get()
+    std::vector<std::string> _pipeline; ///< the IR optimization pipeline
+
+    /// the pass manager for the IR optimization pipeline and the analysis
+    /// managers that cache analysis results across the passes
+    std::unique_ptr<llvm::FunctionPassManager> _passMngr;
+    llvm::PassInstrumentationCallbacks _passCallbacks;
+    llvm::LoopAnalysisManager _loopAM;
+    llvm::FunctionAnalysisManager _functionAM;
+    llvm::CGSCCAnalysisManager _cgsccAM;
+    llvm::ModuleAnalysisManager _moduleAM;
+
+    /// per-pass timers for the IR optimization pipeline, which are keyed by
+    /// the pipeline name of the pass, and for the code-generation pipeline
+    bool _timePasses;                           ///< true if pass timing is enabled
+    PassTimers _irTimers;
+    PassTimers _mcTimers;
+    llvm::StringMap<std::string> _passNames;    ///< maps LLVM pass names to
+                                                ///  pipeline names
+    llvm::Timer *_curTimer;                     ///< the currently running timer
+    llvm::StringRef _curPassID;                 ///< the LLVM name of the pass that
+                                                ///  started `_curTimer`
+
+    /// the code-generation pipeline (nullptr until the first call to `compile`)
+    std::unique_ptr<llvm::legacy::PassManager> _codeGenPM;
+
+    /// build the pass manager for the current pipeline
+    void _buildPipeline ();
+
+    /// get the shared target machine for the current settings from the cache
+    /// (creating it if necessary)
+    void _acquireTargetMachine ();
 
 };
 
@@ -27,7 +27,11 @@ namespace cfgcg {
 llvm::BasicBlock *Context::getOverflowBB ()
 {
     auto srcBB = this->_builder.GetInsertBlock ();
-    int nArgs = this->_regInfo.numMachineRegs();
+    int nArgs = this->_numRegArgs();
+
+  // the runtime system expects the stack-allocated registers to be current when
+  // the Overflow exception is raised, so we write them back in the source block
+    this->writeBackMemRegs ();
 
     if (this->_overflowBB == nullptr) {
 	this->_overflowBB = this->newBB ("overflow");
@@ -82,6 +86,37 @@ llvm::BasicBlock *Context::getOverflowBB ()
 
 } // code_buffer::getOverflowBB
 
+void Context::addOverflowCheck (llvm::Value *obit)
+{
+    if (this->_pendingOvflw == nullptr) {
+	this->_pendingOvflw = obit;
+    } else {
+	this->_pendingOvflw = this->_builder.CreateOr (this->_pendingOvflw, obit);
+    }
+    this->_nPendingOvflw++;
+
+} // Context::addOverflowCheck
+
+void Context::flushOverflowCheck ()
+{
+    if (this->_pendingOvflw == nullptr) {
+	return;
+    }
+
+    llvm::BasicBlock *next = this->newBB ("ok");
+    this->_builder.CreateCondBr(
+	this->_pendingOvflw, this->getOverflowBB(), next, this->overflowWeights());
+  // switch to the new block for the continuation
+    this->setInsertPoint (next);
+
+    this->_stats.numOverflowChecks++;
+    this->_stats.numMergedOverflowChecks += this->_nPendingOvflw - 1;
+
+    this->_pendingOvflw = nullptr;
+    this->_nPendingOvflw = 0;
+
+} // Context::flushOverflowCheck
+
 // get the branch-weight meta data for overflow branches
 //
 llvm::MDNode *Context::overflowWeights ()
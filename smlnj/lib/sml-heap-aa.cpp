@@ -0,0 +1,353 @@
+/// \file sml-heap-aa.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief An alias analysis that understands the SML heap
+///
+
+#include "sml-heap-aa.hpp"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CallingConv.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+
+namespace smlnj {
+namespace cfgcg {
+
+// the limit on the depth of the search for the origin of a pointer
+constexpr unsigned kMaxDepth = 6;
+
+llvm::AnalysisKey SMLHeapAA::Key;
+
+SMLHeapAAResult SMLHeapAA::run (llvm::Function &fn, llvm::FunctionAnalysisManager &fam)
+{
+  // when the CMachine registers are pinned, the "jwa.pinned" module flag lists
+  // their hardware registers, starting with the allocation pointer
+    std::string allocName;
+    auto pinned = llvm::dyn_cast_or_null<llvm::MDNode>(
+        fn.getParent()->getModuleFlag("jwa.pinned"));
+    if ((pinned != nullptr) && (pinned->getNumOperands() > 0)) {
+        if (auto name = llvm::dyn_cast<llvm::MDString>(pinned->getOperand(0))) {
+            allocName = name->getString().str();
+        }
+    }
+
+    return SMLHeapAAResult (this->_spName, allocName, immutableFieldTag (fn.getContext()));
+
+} // SMLHeapAA::run
+
+llvm::MDNode *immutableFieldTag (llvm::LLVMContext &cxt)
+{
+    llvm::MDBuilder mdb(cxt);
+    auto root = mdb.createTBAARoot ("SML heap");
+    auto ty = mdb.createTBAAScalarTypeNode ("immutable field", root);
+    return mdb.createTBAAStructTagNode (ty, ty, 0);
+
+}
+
+// get the data layout for the module that contains `v` (or nullptr)
+static const llvm::DataLayout *getDataLayout (const llvm::Value *v)
+{
+    const llvm::Module *module = nullptr;
+    if (auto inst = llvm::dyn_cast<llvm::Instruction>(v)) {
+        module = inst->getModule();
+    }
+    else if (auto arg = llvm::dyn_cast<llvm::Argument>(v)) {
+        module = arg->getParent()->getParent();
+    }
+    return (module != nullptr) ? &module->getDataLayout() : nullptr;
+
+}
+
+// is `v` a parameter of a JWA function?  If so, return its index; otherwise
+// return -1.
+static int jwaParamIndex (const llvm::Value *v)
+{
+    auto arg = llvm::dyn_cast<llvm::Argument>(v);
+    if ((arg != nullptr)
+    && (arg->getParent()->getCallingConv() == llvm::CallingConv::JWA)) {
+        return arg->getArgNo();
+    }
+    return -1;
+
+}
+
+llvm::AliasResult SMLHeapAAResult::alias (
+    const llvm::MemoryLocation &locA,
+    const llvm::MemoryLocation &locB,
+    llvm::AAQueryInfo &aaqi)
+{
+  // the function does not write an immutable field of an object that was
+  // reachable on entry, so such a field does not alias a location that is not
+  // an immutable field.  LICM needs this answer, since it only asks about
+  // constant memory without the load's access tags.
+    if (((locA.AATags.TBAA == this->_immutableTag) != (locB.AATags.TBAA == this->_immutableTag))
+    && (this->_isConstantField (locA) || this->_isConstantField (locB))) {
+        return llvm::NoAlias;
+    }
+
+    Origin a = this->_classify (locA.Ptr, 0);
+    Origin b = this->_classify (locB.Ptr, 0);
+
+    if ((a == Origin::Unknown) || (b == Origin::Unknown)) {
+        return AAResultBase::alias (locA, locB, aaqi);
+    }
+
+  // fresh objects cannot alias objects that were reachable on entry
+    if (((a == Origin::Fresh) && (b == Origin::Reachable))
+    || ((a == Origin::Reachable) && (b == Origin::Fresh))) {
+        return llvm::NoAlias;
+    }
+
+  // stack slots never alias heap memory
+    if ((a == Origin::Stack) != (b == Origin::Stack)) {
+        return llvm::NoAlias;
+    }
+
+  // two stack slots at known offsets from the stack pointer
+    int64_t offA, offB;
+    if ((a == Origin::Stack)
+    && this->_stackOffset (locA.Ptr, offA)
+    && this->_stackOffset (locB.Ptr, offB)
+    && locA.Size.isPrecise() && locB.Size.isPrecise()) {
+        int64_t szA = locA.Size.getValue();
+        int64_t szB = locB.Size.getValue();
+        if ((offA + szA <= offB) || (offB + szB <= offA)) {
+            return llvm::NoAlias;
+        }
+        else if ((offA == offB) && (szA == szB)) {
+            return llvm::MustAlias;
+        }
+    }
+
+    return AAResultBase::alias (locA, locB, aaqi);
+
+} // SMLHeapAAResult::alias
+
+bool SMLHeapAAResult::pointsToConstantMemory (
+    const llvm::MemoryLocation &loc,
+    llvm::AAQueryInfo &aaqi,
+    bool orLocal)
+{
+  // an immutable field of an object that was reachable on entry to the function
+  // was initialized before the function was called
+    if (this->_isConstantField (loc)) {
+        return true;
+    }
+
+    return AAResultBase::pointsToConstantMemory (loc, aaqi, orLocal);
+
+} // SMLHeapAAResult::pointsToConstantMemory
+
+llvm::ModRefInfo SMLHeapAAResult::getModRefInfo (
+    const llvm::CallBase *call,
+    const llvm::MemoryLocation &loc,
+    llvm::AAQueryInfo &aaqi)
+{
+  // reading and writing hardware registers does not touch memory
+    if (auto intr = llvm::dyn_cast<llvm::IntrinsicInst>(call)) {
+        if ((intr->getIntrinsicID() == llvm::Intrinsic::read_register)
+        || (intr->getIntrinsicID() == llvm::Intrinsic::write_register)) {
+            return llvm::ModRefInfo::NoModRef;
+        }
+    }
+
+    return AAResultBase::getModRefInfo (call, loc, aaqi);
+
+} // SMLHeapAAResult::getModRefInfo
+
+SMLHeapAAResult::Origin SMLHeapAAResult::_classify (const llvm::Value *ptr, unsigned depth)
+{
+    int64_t offset;
+    if (this->_stackOffset (ptr, offset)) {
+        return Origin::Stack;
+    }
+
+    const llvm::DataLayout *dl = getDataLayout (ptr);
+    if ((dl == nullptr) || (depth > kMaxDepth)) {
+        return Origin::Unknown;
+    }
+
+  // the underlying objects of the pointer, which includes the incoming values
+  // of PHI nodes (i.e., the fragment parameters)
+    llvm::SmallVector<const llvm::Value *, 4> objs;
+    llvm::GetUnderlyingObjects (ptr, objs, *dl, nullptr, 0);
+    if (objs.empty()) {
+        return Origin::Unknown;
+    }
+
+    bool allFresh = true, allReachable = true, allStack = true;
+    for (auto obj : objs) {
+        bool isStack = false;
+        if (auto cvt = llvm::dyn_cast<llvm::IntToPtrInst>(obj)) {
+            isStack = this->_usesSP (cvt->getOperand(0), 0);
+        }
+        allStack = allStack && isStack;
+        allFresh = allFresh && this->_isEntryAllocPtr (obj);
+        allReachable = allReachable && !isStack && this->_isReachable (obj, depth);
+    }
+
+    if (allStack) {
+        return Origin::Stack;
+    }
+    else if (allFresh) {
+        return Origin::Fresh;
+    }
+    else if (allReachable) {
+        return Origin::Reachable;
+    }
+
+  // if none of the objects comes from the stack pointer, then the pointer
+  // addresses the heap
+    for (auto obj : objs) {
+        if (auto cvt = llvm::dyn_cast<llvm::IntToPtrInst>(obj)) {
+            if (this->_usesSP (cvt->getOperand(0), 0)) {
+                return Origin::Unknown;
+            }
+        }
+    }
+    return Origin::Heap;
+
+} // SMLHeapAAResult::_classify
+
+bool SMLHeapAAResult::_isReachable (const llvm::Value *v, unsigned depth)
+{
+  // the parameters of a JWA function, other than the allocation pointer,
+  // were live on entry to the function
+    int ix = jwaParamIndex(v);
+    if ((ix > 0) || ((ix == 0) && !this->_allocName.empty())) {
+        return true;
+    }
+
+  // a value that is loaded from an immutable field of an object that was
+  // reachable on entry was also reachable on entry.  We assume that a load
+  // that we are already visiting is reachable, which handles loops that
+  // traverse lists and other linked structures.
+    auto load = llvm::dyn_cast<llvm::LoadInst>(v);
+    if ((load != nullptr)
+    && (load->getMetadata(llvm::LLVMContext::MD_tbaa) == this->_immutableTag)) {
+        if (! this->_visiting.insert(load).second) {
+            return true;
+        }
+        bool result = (this->_classify (load->getPointerOperand(), depth+1) == Origin::Reachable);
+        this->_visiting.erase (load);
+        return result;
+    }
+
+    return false;
+
+} // SMLHeapAAResult::_isReachable
+
+bool SMLHeapAAResult::_usesSP (const llvm::Value *v, unsigned depth)
+{
+    if (depth > kMaxDepth) {
+      // be conservative
+        return true;
+    }
+    else if (this->_isSPRead (v)) {
+        return true;
+    }
+    else if (llvm::isa<llvm::BinaryOperator>(v) || llvm::isa<llvm::CastInst>(v)
+    || llvm::isa<llvm::PHINode>(v) || llvm::isa<llvm::SelectInst>(v)) {
+        for (auto &op : llvm::cast<llvm::User>(v)->operands()) {
+            if (this->_usesSP (op.get(), depth+1)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+
+} // SMLHeapAAResult::_usesSP
+
+bool SMLHeapAAResult::_stackOffset (const llvm::Value *ptr, int64_t &offset)
+{
+    const llvm::DataLayout *dl = getDataLayout (ptr);
+    if (dl == nullptr) {
+        return false;
+    }
+
+  // stack addresses have the form `inttoptr (add sp, offset)` (see `Context::stkAddr`),
+  // but the optimizer may have moved part of the offset into GEPs
+    int64_t off = 0;
+    auto cvt = llvm::dyn_cast<llvm::IntToPtrInst>(
+        llvm::GetPointerBaseWithConstantOffset (ptr, off, *dl));
+    if (cvt == nullptr) {
+        return false;
+    }
+
+    const llvm::Value *v = cvt->getOperand(0);
+    while (auto add = llvm::dyn_cast<llvm::BinaryOperator>(v)) {
+        auto c = llvm::dyn_cast<llvm::ConstantInt>(add->getOperand(1));
+        if ((add->getOpcode() != llvm::Instruction::Add) || (c == nullptr)) {
+            return false;
+        }
+        off += c->getSExtValue();
+        v = add->getOperand(0);
+    }
+
+    if (this->_isSPRead (v)) {
+        offset = off;
+        return true;
+    }
+
+    return false;
+
+} // SMLHeapAAResult::_stackOffset
+
+bool SMLHeapAAResult::_isEntryAllocPtr (const llvm::Value *v)
+{
+    if (this->_allocName.empty()) {
+        return (jwaParamIndex(v) == 0);
+    }
+
+  // with pinned registers, the entry allocation pointer is a read of the
+  // register that precedes any other call in the entry block
+    auto cvt = llvm::dyn_cast<llvm::IntToPtrInst>(v);
+    if (cvt == nullptr) {
+        return false;
+    }
+    auto rd = llvm::dyn_cast<llvm::Instruction>(cvt->getOperand(0));
+    if ((rd == nullptr) || !this->_isRegRead (rd, this->_allocName)) {
+        return false;
+    }
+    const llvm::BasicBlock *bb = rd->getParent();
+    if (bb != &bb->getParent()->getEntryBlock()) {
+        return false;
+    }
+    for (auto &inst : *bb) {
+        if (&inst == rd) {
+            return true;
+        }
+        else if (auto call = llvm::dyn_cast<llvm::CallBase>(&inst)) {
+            auto intr = llvm::dyn_cast<llvm::IntrinsicInst>(call);
+            if ((intr == nullptr) || (intr->getIntrinsicID() != llvm::Intrinsic::read_register)) {
+                return false;
+            }
+        }
+    }
+    return false;
+
+} // SMLHeapAAResult::_isEntryAllocPtr
+
+bool SMLHeapAAResult::_isRegRead (const llvm::Value *v, std::string const &name)
+{
+    auto call = llvm::dyn_cast<llvm::IntrinsicInst>(v);
+    if ((call == nullptr) || (call->getIntrinsicID() != llvm::Intrinsic::read_register)) {
+        return false;
+    }
+
+    auto md = llvm::dyn_cast<llvm::MetadataAsValue>(call->getArgOperand(0));
+    auto node = llvm::dyn_cast<llvm::MDNode>(md->getMetadata());
+    auto regName = llvm::dyn_cast<llvm::MDString>(node->getOperand(0));
+
+    return (regName != nullptr) && (regName->getString() == name);
+
+} // SMLHeapAAResult::_isRegRead
+
+} // namespace cfgcg
+} // namespace smlnj
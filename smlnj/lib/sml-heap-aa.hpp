@@ -0,0 +1,156 @@
+/// \file sml-heap-aa.hpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (https://smlnj.org)
+/// All rights reserved.
+///
+/// \brief An alias analysis that understands the SML heap
+///
+
+#ifndef _SML_HEAP_AA_HPP_
+#define _SML_HEAP_AA_HPP_
+
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/PassManager.h"
+
+#include <string>
+
+namespace smlnj {
+namespace cfgcg {
+
+/// The TBAA access tag that the code generator attaches to loads from the
+/// immutable fields of records and vectors (see `Context::createImmutableLoad`).
+/// The tag does not have the TBAA "constant" flag, since a freshly allocated
+/// record is initialized in the same function that reads it; `SMLHeapAA` decides
+/// when the location is actually constant.
+llvm::MDNode *immutableFieldTag (llvm::LLVMContext &cxt);
+
+/// Alias analysis for the code generated from CFG.  The analysis exploits the
+/// following properties of the SML heap in JWA functions, whose first parameter
+/// is the value of the allocation pointer on entry to the function (when the
+/// CMachine registers are pinned, the entry value of the allocation pointer is
+/// instead read from its hardware register at the start of the function):
+///
+///   1. objects that are addressed off of the allocation pointer are fresh, so
+///      they do not alias any object that was reachable on entry to the function;
+///
+///   2. the fields of records are immutable once they are initialized, so a
+///      field of an object that was reachable on entry cannot be modified;
+///
+///   3. the stack-allocated CMachine registers (and the other stack slots of the
+///      runtime) are only addressed off of the stack pointer, so they do not alias
+///      heap memory.
+///
+/// In addition, the `llvm.read_register` and `llvm.write_register` intrinsics
+/// that we use to access the stack pointer and the pinned registers do not
+/// touch memory.
+///
+class SMLHeapAAResult : public llvm::AAResultBase<SMLHeapAAResult> {
+    friend llvm::AAResultBase<SMLHeapAAResult>;
+
+  public:
+    SMLHeapAAResult (
+        std::string const &spName,
+        std::string const &allocName,
+        const llvm::MDNode *immutableTag)
+      : _spName(spName), _allocName(allocName), _immutableTag(immutableTag)
+    { }
+
+    /// the result only depends on the IR, so it is never invalidated
+    bool invalidate (llvm::Function &, const llvm::PreservedAnalyses &,
+        llvm::FunctionAnalysisManager::Invalidator &)
+    {
+        return false;
+    }
+
+    llvm::AliasResult alias (
+        const llvm::MemoryLocation &locA,
+        const llvm::MemoryLocation &locB,
+        llvm::AAQueryInfo &aaqi);
+
+    bool pointsToConstantMemory (
+        const llvm::MemoryLocation &loc,
+        llvm::AAQueryInfo &aaqi,
+        bool orLocal);
+
+    using AAResultBase::getModRefInfo;
+    llvm::ModRefInfo getModRefInfo (
+        const llvm::CallBase *call,
+        const llvm::MemoryLocation &loc,
+        llvm::AAQueryInfo &aaqi);
+
+  private:
+    std::string _spName;        ///< the name of the stack-pointer register
+    std::string _allocName;     ///< the name of the pinned allocation-pointer
+                                ///  register; empty when the registers are not
+                                ///  pinned
+    const llvm::MDNode *_immutableTag;
+                                ///< == immutableFieldTag(...)
+    llvm::SmallPtrSet<const llvm::Value *, 8> _visiting;
+                                ///< the loads that `_isReachable` is visiting
+
+    /// the classification of the objects that underlie a pointer
+    enum class Origin {
+        Unknown,                ///< we do not know where the pointer comes from
+        Heap,                   ///< some object in the heap
+        Fresh,                  ///< allocated off of the entry allocation pointer
+        Reachable,              ///< reachable on entry to the function
+        Stack                   ///< a stack slot
+    };
+
+    /// classify the objects that underlie the pointer `ptr`
+    Origin _classify (const llvm::Value *ptr, unsigned depth);
+
+    /// is `v` a pointer that was reachable on entry to the function?
+    bool _isReachable (const llvm::Value *v, unsigned depth);
+
+    /// is `loc` an immutable field of an object that was reachable on entry
+    /// to the function (i.e., a location that the function does not write)?
+    bool _isConstantField (const llvm::MemoryLocation &loc)
+    {
+        return (loc.AATags.TBAA == this->_immutableTag)
+            && (this->_classify (loc.Ptr, 0) == Origin::Reachable);
+    }
+
+    /// is `v` an integer that is computed from the stack pointer?
+    bool _usesSP (const llvm::Value *v, unsigned depth);
+
+    /// if `ptr` is the address of a stack slot, then return true and set
+    /// `offset` to its offset from the stack pointer.
+    bool _stackOffset (const llvm::Value *ptr, int64_t &offset);
+
+    /// is `v` the allocation pointer on entry to the function?
+    bool _isEntryAllocPtr (const llvm::Value *v);
+
+    /// is `v` a read of the stack-pointer register?
+    bool _isSPRead (const llvm::Value *v)
+    {
+        return this->_isRegRead (v, this->_spName);
+    }
+
+    /// is `v` a read of the register `name`?
+    bool _isRegRead (const llvm::Value *v, std::string const &name);
+
+};
+
+/// Analysis pass that provides the `SMLHeapAAResult`
+class SMLHeapAA : public llvm::AnalysisInfoMixin<SMLHeapAA> {
+    friend llvm::AnalysisInfoMixin<SMLHeapAA>;
+    static llvm::AnalysisKey Key;
+
+  public:
+    using Result = SMLHeapAAResult;
+
+    explicit SMLHeapAA (std::string const &spName) : _spName(spName) { }
+
+    SMLHeapAAResult run (llvm::Function &fn, llvm::FunctionAnalysisManager &fam);
+
+  private:
+    std::string _spName;
+
+};
+
+} // namespace cfgcg
+} // namespace smlnj
+
+#endif // !_SML_HEAP_AA_HPP_
@@ -10,6 +10,8 @@
 
 #include "target-info.hpp"
 
+#include <mutex>
+
 namespace smlnj {
 namespace cfgcg {
 
@@ -60,6 +62,8 @@ static TargetInfo Arm64Info = {
 	8232,				// call-gc offset
 	8224,				// raise_overflow offset
 	8*1024,				// allocation slop
+	256,				// allocation prefetch distance
+	8*1024,				// spill-area size
         false,                          // initialized
 	LLVMInitializeAArch64TargetInfo,// initTargetInfo
 	LLVMInitializeAArch64Target,	// initTarget
@@ -93,6 +97,8 @@ static TargetInfo X86_64Info = {
 	8240,				// call-gc offset
 	8248,				// raise_overflow offset
 	8*1024,				// allocation slop
+	256,				// allocation prefetch distance
+	8*1024,				// spill-area size
         false,                          // initialized
 	LLVMInitializeX86TargetInfo,	// initTargetInfo
 	LLVMInitializeX86Target,	// initTarget
@@ -132,6 +138,32 @@ std::vector<std::string> TargetInfo::targetNames ()
     return targetNames;
 }
 
+// lock to protect target initialization
+static std::mutex gInitLock;
+
+void TargetInfo::initialize () const
+{
+    std::lock_guard<std::mutex> lock(gInitLock);
+
+    if (! this->initialized) {
+        this->initTargetInfo();
+        this->initTarget();
+        this->initMC();
+        this->initAsmPrinter();
+        this->initialized = true;
+    }
+
+}
+
+void TargetInfo::initializeAsmParser () const
+{
+    this->initialize ();
+
+    std::lock_guard<std::mutex> lock(gInitLock);
+    this->initAsmParser();
+
+}
+
 TargetInfo const *TargetInfo::infoForTarget (std::string const &name)
 {
     for (int i = 0;  i < kNumTargets;  i++) {
@@ -148,5 +180,38 @@ llvm::Triple TargetInfo::getTriple() const
     return llvm::Triple(this->name, kVendor, kOS);
 }
 
+std::vector<std::string> TargetInfo::jwaRegisters () const
+{
+  // this list must agree with CC_X86_64_JWA in llvm/lib/Target/X86/X86CallingConv.td
+    if (this->arch == llvm::Triple::x86_64) {
+	return std::vector<std::string>{
+		"rdi", "r14", "r15",	// ALLOC, LIMIT, STORE
+		"r8", "r9", "rsi",	// LINK, CLOS, CONT
+		"rbx", "rcx", "rdx",	// MISC0-MISC2 (CALLEE SAVES)
+		"rbp", "r10", "r11",	// ARG, MISC3, MISC4
+		"r12", "r13"		// MISC5, MISC6
+	    };
+    }
+    return std::vector<std::string>();
+
+}
+
+std::vector<std::string> TargetInfo::pinnedRegisters () const
+{
+  // these lists must agree with the JWA calling conventions in LLVM
+    if (this->arch == llvm::Triple::x86_64) {
+	return std::vector<std::string>{
+		"rdi", "r14", "r15"		// ALLOC, LIMIT, STORE
+	    };
+    }
+    else if (this->arch == llvm::Triple::aarch64) {
+	return std::vector<std::string>{
+		"x24", "x25", "x26", "x27", "x28"	// ALLOC, LIMIT, STORE, EXN, VAR
+	    };
+    }
+    return std::vector<std::string>();
+
+}
+
 } // namespace cfgcg
 } // namespace smlnj
@@ -0,0 +1,38 @@
+# -*- Python -*-
+
+# Configuration file for the regression tests of the cfgc tool, which compile
+# the CFG pickles in this directory (the ".test" files) and hand-written LLVM
+# assembly (the ".ll" files).  The tests use the cfgc of a build, whose
+# directory is given by the "cfgc_dir" parameter, and the tools of an LLVM
+# build (FileCheck, count, opt, ...), whose location is given by the
+# "llvm_tools_dir" parameter:
+#
+#   llvm-lit -Dcfgc_dir=<build>/smlnj/cfgc -Dllvm_tools_dir=<build>/llvm/bin smlnj/tests
+
+import os
+import platform
+
+import lit.formats
+
+config.name = 'cfgc'
+config.test_format = lit.formats.ShTest(not lit_config.isWindows)
+config.suffixes = ['.test', '.ll']
+config.test_source_root = os.path.dirname(__file__)
+
+cfgc_dir = lit_config.params.get('cfgc_dir')
+if not cfgc_dir:
+    lit_config.fatal('set the cfgc directory with -Dcfgc_dir=<dir>')
+tools_dir = lit_config.params.get('llvm_tools_dir')
+if not tools_dir:
+    lit_config.fatal('set the LLVM tools directory with -Dllvm_tools_dir=<dir>')
+config.environment['PATH'] = os.path.pathsep.join(
+    [cfgc_dir, tools_dir, config.environment.get('PATH', os.environ.get('PATH', ''))])
+
+# cfgc writes its "-S" and "-o" output next to the pickle, so the tests copy
+# the pickles to their output directory, which is the "tests" directory of the
+# build (i.e., next to the cfgc directory).
+config.test_exec_root = os.path.join(os.path.dirname(cfgc_dir), 'tests')
+
+# the host operating system (e.g., "linux" or "darwin") determines the object
+# file format
+config.available_features.add(platform.system().lower())
@@ -0,0 +1,121 @@
+; RUN: cfgc --target x86_64 --passes gvn --emit-opt-llvm %s 2>&1 >/dev/null | FileCheck --check-prefix=GVN %s
+; RUN: cfgc --target x86_64 --passes dse --emit-opt-llvm %s 2>&1 >/dev/null | FileCheck --check-prefix=DSE %s
+; RUN: cfgc --target x86_64 --passes licm --emit-opt-llvm %s 2>&1 >/dev/null | FileCheck --check-prefix=LICM %s
+; RUN: opt -S -passes='gvn,dse,require<opt-remark-emit>,loop(licm)' %s | FileCheck --check-prefix=NOAA %s
+
+; Tests for the SML heap alias analysis (see lib/sml-heap-aa.hpp).  The
+; functions follow the conventions of the generated code: the first parameter
+; is the allocation pointer on entry, so objects addressed off of it are fresh,
+; while the other parameters (here, the closure) were reachable on entry.  The
+; last RUN line checks that LLVM's own alias analyses do not enable any of the
+; optimizations.
+
+; A store to a fresh object does not clobber a field of the closure, so the
+; second load of the field is redundant.
+;
+; GVN-LABEL: define cc20 void @fresh_load(
+; GVN:         [[X:%.*]] = load i64*, i64** %f
+; GVN-NOT:     load
+; GVN:         tail call cc20 void %k({{.*}}, i64* [[X]], i64* [[X]])
+;
+; NOAA-LABEL: define cc20 void @fresh_load(
+; NOAA:         %y = load i64*, i64** %f
+define cc20 void @fresh_load(i64** %ap, i64** %lim, i64** %st, i64* %link, i64* %clos) {
+  %c = bitcast i64* %clos to i64**
+  %f = getelementptr inbounds i64*, i64** %c, i32 1
+  %x = load i64*, i64** %f, align 8
+  store i64* %x, i64** %ap, align 8
+  %y = load i64*, i64** %f, align 8
+  %ap1 = getelementptr inbounds i64*, i64** %ap, i32 1
+  %k = bitcast i64* %link to void (i64**, i64**, i64**, i64*, i64*)*
+  tail call cc20 void %k(i64** %ap1, i64** %lim, i64** %st, i64* %x, i64* %y)
+  ret void
+}
+
+; A load from the closure does not read a fresh object, so the first store to
+; the object is dead.
+;
+; DSE-LABEL: define cc20 void @fresh_store(
+; DSE-NOT:     store i64* inttoptr (i64 130 to i64*)
+; DSE:         store i64* %x, i64** %ap
+;
+; NOAA-LABEL: define cc20 void @fresh_store(
+; NOAA:         store i64* inttoptr (i64 130 to i64*), i64** %ap
+define cc20 void @fresh_store(i64** %ap, i64** %lim, i64** %st, i64* %link, i64* %clos) {
+  store i64* inttoptr (i64 130 to i64*), i64** %ap, align 8
+  %c = bitcast i64* %clos to i64**
+  %x = load i64*, i64** %c, align 8
+  store i64* %x, i64** %ap, align 8
+  %ap1 = getelementptr inbounds i64*, i64** %ap, i32 1
+  %k = bitcast i64* %link to void (i64**, i64**, i64**, i64*)*
+  tail call cc20 void %k(i64** %ap1, i64** %lim, i64** %st, i64* %x)
+  ret void
+}
+
+; The loop stores into a mutable object (a ref cell whose address is loaded
+; from the closure), which cannot modify an immutable field of the closure,
+; so LICM hoists the load of the field out of the loop.
+;
+; LICM-LABEL: define cc20 void @immutable_licm(
+; LICM:         load i64*, i64** %f, align 8, !tbaa
+; LICM:       loop:
+; LICM-NOT:     load
+; LICM:       exit:
+;
+; NOAA-LABEL: define cc20 void @immutable_licm(
+; NOAA:       loop:
+; NOAA:         load i64*, i64** %f, align 8, !tbaa
+define cc20 void @immutable_licm(i64** %ap, i64** %lim, i64** %st, i64* %link, i64* %clos, i64 %n) {
+entry:
+  %c = bitcast i64* %clos to i64**
+  %rp = load i64*, i64** %c, align 8
+  %r = bitcast i64* %rp to i64**
+  %f = getelementptr inbounds i64*, i64** %c, i32 1
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i1, %loop ]
+  %v = load i64*, i64** %f, align 8, !tbaa !2
+  %vi = ptrtoint i64* %v to i64
+  %w = add i64 %vi, %i
+  %wp = inttoptr i64 %w to i64*
+  store i64* %wp, i64** %r, align 8
+  %i1 = add i64 %i, 2
+  %done = icmp eq i64 %i1, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %k = bitcast i64* %link to void (i64**, i64**, i64**, i64*)*
+  tail call cc20 void %k(i64** %ap, i64** %lim, i64** %st, i64* %rp)
+  ret void
+}
+
+; A store to the heap does not clobber a stack slot, so the reload of the slot
+; is replaced by the stored value.
+;
+; GVN-LABEL: define cc20 void @stack_heap(
+; GVN-NOT:     load
+; GVN:         tail call cc20 void %k({{.*}}, i64* %x)
+;
+; NOAA-LABEL: define cc20 void @stack_heap(
+; NOAA:         %y = load i64*, i64** %s
+define cc20 void @stack_heap(i64** %ap, i64** %lim, i64** %st, i64* %link, i64* %clos, i64* %x) {
+  %sp = call i64 @llvm.read_register.i64(metadata !3)
+  %sa = add i64 %sp, 8
+  %s = inttoptr i64 %sa to i64**
+  store i64* %x, i64** %s, align 8
+  %c = bitcast i64* %clos to i64**
+  store i64* %link, i64** %c, align 8
+  %y = load i64*, i64** %s, align 8
+  %k = bitcast i64* %link to void (i64**, i64**, i64**, i64*)*
+  tail call cc20 void %k(i64** %ap, i64** %lim, i64** %st, i64* %y)
+  ret void
+}
+
+declare i64 @llvm.read_register.i64(metadata)
+
+; the access tag for immutable fields (see `immutableFieldTag`)
+!0 = !{!"SML heap"}
+!1 = !{!"immutable field", !0, i64 0}
+!2 = !{!1, !1, i64 0}
+!3 = !{!"rsp"}
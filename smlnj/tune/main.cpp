@@ -0,0 +1,238 @@
+/// \file main.cpp
+///
+/// \copyright 2024 The Fellowship of SML/NJ (http://www.smlnj.org)
+/// All rights reserved.
+///
+/// \brief An autotuner for the IR optimization pipeline used by the code generator
+///
+/// This tool compiles a corpus of CFG pickles with a collection of candidate
+/// optimization pipelines (pass subsets and orderings) and reports the
+/// candidates that are Pareto optimal with respect to compile time and the
+/// size of the generated code.
+///
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+
+#include "cfg.hpp"
+#include "context.hpp"
+#include "target-info.hpp"
+
+#if defined(ARCH_AMD64)
+#define HOST_ARCH "x86_64"
+#elif defined(ARCH_ARM64)
+#define HOST_ARCH "aarch64"
+#else
+#  error unknown architeture
+#endif
+
+using smlnj::cfgcg::Context;
+
+extern "C" {
+void Die (const char *fmt, ...)
+{
+    va_list	ap;
+
+    va_start (ap, fmt);
+    fprintf (stderr, "cfgtune: Fatal error -- ");
+    vfprintf (stderr, fmt, ap);
+    fprintf (stderr, "\n");
+    va_end(ap);
+
+    ::exit (1);
+}
+} // extern "C"
+
+[[noreturn]] void usage ()
+{
+    std::cerr << "usage: cfgtune [ --target <target> ] [ --trials <n> ] [ --repeat <n> ]\n";
+    std::cerr << "               [ --seed <n> ] <pkl-file> ...\n";
+    std::cerr << "options:\n";
+    std::cerr << "    -target <target>  -- specify the target architecture (default "
+              << HOST_ARCH << ")\n";
+    std::cerr << "    -trials <n>       -- number of random pipelines to try (default 50)\n";
+    std::cerr << "    -repeat <n>       -- number of times to compile the corpus for each\n";
+    std::cerr << "                         pipeline; the minimum time is used (default 3)\n";
+    std::cerr << "    -seed <n>         -- seed for generating random pipelines\n";
+    exit (1);
+}
+
+/// the measurements for a candidate pipeline
+struct Result {
+    std::vector<std::string> passes;    ///< the pipeline
+    double compileTime;                 ///< compile time in seconds (optimization
+                                        ///  plus machine-code generation)
+    size_t codeSzb;                     ///< total size of the generated code
+};
+
+// format a pipeline as a comma-separated list
+static std::string pipelineToString (std::vector<std::string> const &passes)
+{
+    if (passes.empty()) {
+	return "<none>";
+    }
+    std::string s = passes[0];
+    for (int i = 1;  i < passes.size();  i++) {
+	s += "," + passes[i];
+    }
+    return s;
+}
+
+// compile the corpus using the given pipeline and return the measurements
+static Result measure (
+    Context *cxt,
+    std::vector<std::string> const &srcs,
+    std::vector<std::string> const &passes,
+    int repeat)
+{
+    Result res = { passes, 0.0, 0 };
+
+    cxt->setOptPipeline (passes);
+
+    for (int r = 0;  r < repeat;  r++) {
+	double t = 0.0;
+	size_t szb = 0;
+	for (auto const &src : srcs) {
+	  // we read the pickle for each compilation, since code generation
+	  // annotates the CFG
+	    asdl::file_instream inS(src);
+	    CFG::comp_unit *cu = CFG::comp_unit::read (inS);
+
+	    cxt->stats().clear();
+	    cu->codegen (cxt);
+	    cxt->optimize ();
+	    auto obj = cxt->compile ();
+	    t += cxt->stats().optimizeTime + cxt->stats().codegenTime;
+	    if (obj) {
+		szb += obj->size();
+	    }
+	    cxt->endModule ();
+
+	    delete cu;
+	}
+	if ((r == 0) || (t < res.compileTime)) {
+	    res.compileTime = t;
+	}
+	res.codeSzb = szb;
+    }
+
+    return res;
+
+}
+
+int main (int argc, char **argv)
+{
+    std::string targetArch = HOST_ARCH;
+    int nTrials = 50;
+    int repeat = 3;
+    unsigned int seed = 17;
+    std::vector<std::string> srcs;
+
+    std::vector<std::string> args(argv+1, argv+argc);
+
+    for (int i = 0;  i < args.size();  i++) {
+	if (args[i][0] == '-') {
+	    if (i+1 >= args.size()) {
+		usage();
+	    }
+	    if (args[i] == "--target") {
+		targetArch = args[++i];
+	    } else if (args[i] == "--trials") {
+		nTrials = atoi(args[++i].c_str());
+	    } else if (args[i] == "--repeat") {
+		repeat = std::max(1, atoi(args[++i].c_str()));
+	    } else if (args[i] == "--seed") {
+		seed = atoi(args[++i].c_str());
+	    } else {
+		usage();
+	    }
+	}
+	else {
+	    srcs.push_back (args[i]);
+	}
+    }
+    if (srcs.empty()) {
+        usage();
+    }
+
+    Context *cxt = Context::create (targetArch);
+    if (cxt == nullptr) {
+	std::cerr << "cfgtune: unknown target \"" << targetArch << "\"\n";
+	return 1;
+    }
+
+  // generate the candidate pipelines: the default pipeline, the empty pipeline,
+  // the default pipeline with each pass removed, and random pipelines
+    auto dflt = Context::defaultOptPipeline();
+    std::vector<std::vector<std::string>> candidates;
+    candidates.push_back (dflt);
+    candidates.push_back (std::vector<std::string>());
+    for (int i = 0;  i < dflt.size();  i++) {
+	auto p = dflt;
+	p.erase (p.begin() + i);
+	candidates.push_back (p);
+    }
+    auto avail = Context::availableOptPasses();
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> lenDist(1, dflt.size());
+    std::uniform_int_distribution<int> passDist(0, avail.size() - 1);
+    for (int i = 0;  i < nTrials;  i++) {
+	std::vector<std::string> p;
+	int len = lenDist(rng);
+	for (int j = 0;  j < len;  j++) {
+	    p.push_back (avail[passDist(rng)]);
+	}
+	candidates.push_back (p);
+    }
+
+  // measure the candidates
+    std::vector<Result> results;
+    for (auto const &p : candidates) {
+	results.push_back (measure (cxt, srcs, p, repeat));
+	std::cerr << "." << std::flush;
+    }
+    std::cerr << "\n";
+
+  // compute the Pareto front; i.e., the results that are not dominated by
+  // some other result
+    std::vector<Result> front;
+    for (auto const &r : results) {
+	bool dominated = false;
+	for (auto const &q : results) {
+	    if ((q.compileTime <= r.compileTime) && (q.codeSzb <= r.codeSzb)
+	    && ((q.compileTime < r.compileTime) || (q.codeSzb < r.codeSzb))) {
+		dominated = true;
+		break;
+	    }
+	}
+	if (! dominated) {
+	    front.push_back (r);
+	}
+    }
+    std::sort (front.begin(), front.end(),
+	[] (Result const &a, Result const &b) { return a.compileTime < b.compileTime; });
+
+    Result const &base = results[0];
+    std::cout << "target: " << targetArch << "; " << srcs.size() << " files; "
+	<< candidates.size() << " pipelines\n";
+    std::cout << "default: " << std::fixed << std::setprecision(3)
+	<< 1000.0 * base.compileTime << "ms, " << base.codeSzb << " bytes\n";
+    std::cout << "Pareto-optimal pipelines:\n";
+    for (auto const &r : front) {
+	std::cout << "  " << std::setw(10) << 1000.0 * r.compileTime << "ms "
+	    << std::setw(8) << r.codeSzb << " bytes  "
+	    << pipelineToString(r.passes) << "\n";
+    }
+
+    delete cxt;
+
+    return 0;
+
+}